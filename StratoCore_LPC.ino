@@ -12,25 +12,42 @@
 
 #define LOOP_TENTHS     5 // defines loop period in 0.1s
 
+// Event-driven loop: sleep (WFI) between passes, and run a pass as soon as
+// Zephyr bytes arrive, a PHA frame completes, RS41 bytes arrive, an action
+// deadline passes or the second rolls over for the scheduler, as well as on
+// the LOOP_TENTHS tick. Set to false for the original fixed LOOP_TENTHS polling loop.
+#define EVENT_DRIVEN_LOOP true
+// A PHA frame is considered complete when OPCSERIAL has been quiet for this
+// long (about 50 byte times at 500 kbaud)
+#define PHA_IDLE_US     1000
+// How often to report the fraction of time spent asleep (debug log)
+#define LOOP_STATS_SECS 60
+
+// Loop wake-up reasons
+#define EVENT_TICK      0x01 // LOOP_TENTHS period: watchdog and mode polling
+#define EVENT_ZEPHYR    0x02 // bytes waiting for the router
+#define EVENT_PHA       0x04 // a complete PHA frame is waiting
+#define EVENT_SECOND    0x08 // second boundary: StratoCore scheduler
+#define EVENT_ACTION    0x10 // an LPC action deadline has passed
+#define EVENT_RS41      0x20 // RS41 reply bytes to collect
+
 StratoLPC strato;
 
 // timer control variables
 volatile uint8_t timer_counter = 0;
 volatile bool loop_flag = false;
- // Serial Buffers for T4.1
-uint8_t Zephyr_serial_TX_buffer[ZEPHYR_SERIAL_BUFFER_SIZE];
-uint8_t Zephyr_serial_RX_buffer[ZEPHYR_SERIAL_BUFFER_SIZE];
-// ISR for Zephyr port (on LPC)
-// void serialEvent2()
-// {
-//   if (ZEPHYR_SERIAL.available()) {
-//     while (ZEPHYR_SERIAL.available()) {
-//       uint8_t rx_char;
-//       rx_char = ZEPHYR_SERIAL.read();
-//       strato.TakeZephyrByte(rx_char);
-//     }
-//   }
-// }
+
+// event loop state
+int pha_last_available = 0;
+uint32_t pha_last_change_us = 0;
+time_t last_second = 0;
+uint32_t sleep_us = 0;
+uint32_t stats_start_ms = 0;
+ // Serial Buffers for T4.1, in OCRAM (see LPCMemory.h)
+DMAMEM uint8_t Zephyr_serial_TX_buffer[ZEPHYR_SERIAL_BUFFER_SIZE];
+DMAMEM uint8_t Zephyr_serial_RX_buffer[ZEPHYR_SERIAL_BUFFER_SIZE];
+// Zephyr RX bytes are moved out in the UART interrupt by LPCZephyrRx,
+// and handed to strato.TakeZephyrByte() by strato.DrainZephyrRx()
 
 // ISR for timer
 void ControlLoopTimer(void) {
@@ -47,9 +64,95 @@ void WaitForControlTimer(void) {
   loop_flag = false;
 }
 
+// Collect pending loop events without blocking
+uint8_t PollEvents(void) {
+  uint8_t events = 0;
+
+  if (loop_flag) {
+    loop_flag = false;
+    events |= EVENT_TICK;
+  }
+
+  if (LPCZephyrRx::Available() || ZEPHYR_SERIAL.available()) {
+    events |= EVENT_ZEPHYR;
+  }
+
+  // FL_MEASURE reads a whole frame in one go, so wait for the line to go
+  // quiet rather than waking on the first byte and spinning on the rest.
+  // Bytes left while the PHA is off are not read, so they must not wake
+  // the loop.
+  int pha_available = strato.PHAListening() ? OPCSERIAL.available() : 0;
+  if (pha_available != pha_last_available) {
+    pha_last_available = pha_available;
+    pha_last_change_us = micros();
+  } else if (pha_available && (micros() - pha_last_change_us >= PHA_IDLE_US)) {
+    events |= EVENT_PHA;
+  }
+
+  if (RS41_SERIAL.available()) {
+    events |= EVENT_RS41;
+  }
+
+  if (strato.ActionDue()) {
+    events |= EVENT_ACTION;
+  }
+
+  if (now() != last_second) {
+    last_second = now();
+    events |= EVENT_SECOND;
+  }
+
+  return events;
+}
+
+// Sleep until there is work to do. Any interrupt (Timer1, UART RX, SysTick)
+// ends the WFI; interrupts are masked while checking so that one arriving
+// between the check and the WFI still wakes the core.
+uint8_t WaitForEvent(void) {
+  uint8_t events;
+  while (true) {
+    __disable_irq();
+    events = PollEvents();
+    if (events) {
+      __enable_irq();
+      break;
+    }
+    uint32_t sleep_start = micros();
+    asm volatile("wfi");
+    __enable_irq();
+    sleep_us += micros() - sleep_start;
+  }
+
+  if (millis() - stats_start_ms >= LOOP_STATS_SECS * 1000UL) {
+    uint32_t elapsed_ms = millis() - stats_start_ms;
+    log_debug((String("Loop idle ") + (sleep_us / 10UL / elapsed_ms) + "%").c_str());
+    sleep_us = 0;
+    stats_start_ms = millis();
+  }
+
+  return events;
+}
+
+// Single character commands on the debug port:
+//   m  log the stack and heap statistics
+void DebugCommand(void) {
+#ifndef LOG_ZEPHYR_COMMS_SHARED
+  // (the debug port carries Zephyr traffic when shared)
+  while (Serial.available()) {
+    if (Serial.read() == 'm') {
+      strato.LogMemory();
+    }
+  }
+#endif
+}
+
 // Standard Arduino setup function
 void setup()
 {
+  // before anything else uses the stack
+  LPCMemStats::PaintStack();
+  LPCBoot::Begin();
+
   Serial.begin(115200);
   Serial.println(String("StratoCore_LPC build ") + __DATE__ + " " + __TIME__);
 
@@ -59,6 +162,7 @@ void setup()
     // Zephyr serial is on digital I/O pins
     ZEPHYR_SERIAL.addMemoryForRead(&Zephyr_serial_RX_buffer, sizeof(Zephyr_serial_RX_buffer));
     ZEPHYR_SERIAL.addMemoryForWrite(&Zephyr_serial_TX_buffer, sizeof(Zephyr_serial_TX_buffer));
+    LPCZephyrRx::Begin(ZEPHYR_SERIAL, ZEPHYR_SERIAL_IRQ);
     log_nominal("Configured for standard Zephyr port");
 #else
     // Zephyr serial is on USB so buffer doesn't need to be increased
@@ -69,25 +173,65 @@ void setup()
   Timer1.initialize(100000); // 0.1 s
   Timer1.attachInterrupt(ControlLoopTimer);
 
+#if !LPC_FAST_BOOT
   // Wait two cycles to align timing
   WaitForControlTimer();
   WaitForControlTimer();
+#endif
+  LPCBoot::Mark(LPC_BOOT_PORTS);
 
   strato.InitializeCore();
+  LPCBoot::Mark(LPC_BOOT_CORE);
   strato.InstrumentSetup();
+
+  stats_start_ms = millis();
 }
 
+#if EVENT_DRIVEN_LOOP
+// Standard Arduino loop function
+void loop()
+{
+  uint8_t events = WaitForEvent();
+
+  // StratoCore loop functions. The mode functions are safe to call more
+  // often than LOOP_TENTHS, so every event runs them.
+  if (events & EVENT_TICK) {
+    strato.KickWatchdog();
+  }
+  if (events & (EVENT_TICK | EVENT_SECOND)) {
+    strato.RunScheduler();
+  }
+  strato.DrainZephyrRx();
+  strato.RunRouter();
+  strato.RunMode();
+  strato.InstrumentLoop();
+  DebugCommand();
+  if (LPCBoot::Mark(LPC_BOOT_RUNMODE)) {
+    strato.LogBoot();
+  }
+
+  // queued log records go out in what is left of the pass
+  LPCLog::Drain();
+}
+#else
 // Standard Arduino loop function
 void loop()
 {
   // StratoCore loop functions
   strato.KickWatchdog();
   strato.RunScheduler();
+  strato.DrainZephyrRx();
   strato.RunRouter();
   strato.RunMode();
   strato.InstrumentLoop();
+  DebugCommand();
+  if (LPCBoot::Mark(LPC_BOOT_RUNMODE)) {
+    strato.LogBoot();
+  }
+  LPCLog::Drain();
 
   // Wait for loop timer
   WaitForControlTimer();
 }
+#endif
 
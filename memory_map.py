@@ -0,0 +1,146 @@
+"""Report Teensy 4.1 memory usage by region after a build.
+
+Run by PlatformIO as a post-build script (see platformio.ini), or by hand
+on any firmware ELF, e.g. one from the Arduino IDE build directory:
+
+    python3 memory_map.py path/to/firmware.elf [--top N] [--prefix arm-none-eabi-]
+
+For each region this prints used bytes, headroom, and the largest symbols.
+The placement policy is described in src/LPCMemory.h.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+KB = 1024
+
+# (name, start, size) of the i.MX RT1062 memory regions
+REGIONS = [
+    ("ITCM", 0x00000000, 512 * KB),
+    ("DTCM", 0x20000000, 512 * KB),
+    ("OCRAM", 0x20200000, 512 * KB),
+    ("FLASH", 0x60000000, 8 * KB * KB),
+    ("EXTMEM", 0x70000000, 16 * KB * KB),
+]
+# ITCM and DTCM share RAM1, which is handed out to ITCM in 32 KB banks
+RAM1_SIZE = 512 * KB
+ITCM_BANK = 32 * KB
+# Warn when less than this is left in DTCM for the stack
+MIN_STACK_HEADROOM = 32 * KB
+
+
+def region_of(addr):
+    for name, start, size in REGIONS:
+        if start <= addr < start + size:
+            return name
+    return None
+
+
+def run(tool, *args):
+    return subprocess.check_output([tool] + list(args), universal_newlines=True)
+
+
+def section_usage(prefix, elf):
+    """Bytes allocated in each region, from the section headers."""
+    used = {name: 0 for name, _, _ in REGIONS}
+    for line in run(prefix + "readelf", "-S", "-W", elf).splitlines():
+        # [Nr] Name Type Address Off Size ES Flg ...
+        if "]" not in line:
+            continue
+        fields = line.split("]", 1)[1].split()
+        if len(fields) < 7 or "A" not in fields[6]:
+            continue
+        try:
+            addr = int(fields[2], 16)
+            size = int(fields[4], 16)
+        except ValueError:
+            continue
+        region = region_of(addr)
+        if region and size:
+            used[region] += size
+    return used
+
+
+def flash_image(prefix, elf):
+    """Bytes of the flash image: everything loaded, including initialized data."""
+    total = 0
+    for line in run(prefix + "readelf", "-l", "-W", elf).splitlines():
+        fields = line.split()
+        if fields and fields[0] == "LOAD":
+            total += int(fields[4], 16)
+    return total
+
+
+def largest_symbols(prefix, elf, top):
+    by_region = {}
+    for line in run(prefix + "nm", "-S", "-C", "--size-sort", "-r", elf).splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue
+        addr, size, name = int(fields[0], 16), int(fields[1], 16), fields[3]
+        region = region_of(addr)
+        if region and len(by_region.setdefault(region, [])) < top:
+            by_region[region].append((size, name))
+    return by_region
+
+
+def report(elf, prefix="arm-none-eabi-", top=8):
+    used = section_usage(prefix, elf)
+    itcm_banks = (used["ITCM"] + ITCM_BANK - 1) // ITCM_BANK
+    dtcm_size = RAM1_SIZE - itcm_banks * ITCM_BANK
+    flash = flash_image(prefix, elf)
+
+    sizes = {
+        "ITCM": itcm_banks * ITCM_BANK,
+        "DTCM": dtcm_size,
+        "OCRAM": 512 * KB,
+        "FLASH": 8 * KB * KB,
+    }
+    used["FLASH"] = flash
+
+    print("Memory map: %s" % elf)
+    print("  %-6s %10s %10s %10s" % ("region", "used", "size", "free"))
+    for name in ("ITCM", "DTCM", "OCRAM", "FLASH"):
+        print("  %-6s %10d %10d %10d" % (name, used[name], sizes[name], sizes[name] - used[name]))
+    if used["EXTMEM"]:
+        print("  %-6s %10d" % ("EXTMEM", used["EXTMEM"]))
+    print("  RAM1: %d ITCM bank(s) of 32 KB; DTCM free for the stack: %d" % (itcm_banks, dtcm_size - used["DTCM"]))
+    print("  OCRAM free is shared by the heap")
+
+    for region, symbols in sorted(largest_symbols(prefix, elf, top).items()):
+        if region == "FLASH":
+            continue
+        print("  Largest in %s:" % region)
+        for size, name in symbols:
+            print("    %8d  %s" % (size, name))
+
+    if dtcm_size - used["DTCM"] < MIN_STACK_HEADROOM:
+        print("WARNING: less than %d KB of DTCM left for the stack" % (MIN_STACK_HEADROOM // KB))
+        return False
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--top", type=int, default=8, help="largest symbols to list per region")
+    parser.add_argument("--prefix", default="arm-none-eabi-", help="toolchain prefix")
+    args = parser.parse_args()
+    return 0 if report(args.elf, args.prefix, args.top) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+else:
+    from SCons.Script import DefaultEnvironment
+
+    env = DefaultEnvironment()
+
+    def memory_map(source, target, env):
+        # $CC may be a bare name on the PATH or a full path to the toolchain
+        prefix = os.path.join(os.path.dirname(env.subst("$CC")), "arm-none-eabi-")
+        report(str(target[0]), prefix)
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", memory_map)
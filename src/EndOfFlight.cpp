@@ -24,11 +24,12 @@ void StratoLPC::EndOfFlightMode()
     case EF_ENTRY:
         // perform setup
         log_nominal("Entering EF");
+        LogTcLatency("EF mode");
         inst_substate = EF_LOOP;
         break;
     case EF_LOOP:
         // nominal ops
-        log_debug("EF loop");
+        LPC_LOG(LOG_EF_LOOP);
         break;
     case EF_SHUTDOWN:
         // prep for shutdown
@@ -35,29 +35,42 @@ void StratoLPC::FlightMode()
     if (inst_substate == FL_ENTRY) {
         _rs41.init();
         log_nominal((String("RS41: ")+_rs41.banner()).c_str());
+        _rate_policy.Reset();
+        if (RS41_AGGREGATE_TM_WITH_LPC) {
+            rs41SetAggregateTm(RS41_AGGREGATE_TM);
+        }
         rs41Start();
+        _action_scheduler.Schedule(RATE_POLICY, 0, LPC_RATE_UPDATE_SECS * 1000UL);
     } else {
         rs41Action();
+        phaCommandLoop();
+        if (CheckAction(RATE_POLICY)) {
+            rateUpdate();
+        }
     }
     switch (inst_substate) {
     case FL_ENTRY:
         // perform setup
         log_nominal("Entering FL");
+        LogTcLatency("FL mode");
         inst_substate = FL_GPS_WAIT;
         break;
     case FL_GPS_WAIT:
         // wait for a Zephyr GPS message to set the time before moving on
-        log_debug("FL Wait for GPS Time");
+        LPC_LOG(LOG_FL_WAIT_GPS);
         if (time_valid)
         //if(true)
         {
-            // On the first call for flight mode we set the nexr warmup period to occur on the next
-            // hour.   After that the measurements occur every x minutes after the hour
-            StartTime = Get_Next_Hour(); // Get the next whole hour
+            // The measurements occur every Set_cycleTime minutes, on a grid
+            // aligned to the epoch (and so to the hour)
+            _cycle_planned_start = 0;
+            _cycles_run = 0;
+            _cycles_skipped = 0;
             if (!OPC_IMMEDIATE_START) {
-                scheduler.AddAction(START_WARMUP, StartTime);  //start the measurement on the next whole hour
+                ScheduleNextCycle();
             } else {
-                scheduler.AddAction(START_WARMUP, 10); //For testing start in 10 seconds
+                _cycle_planned_start = now() + 10;
+                _action_scheduler.Schedule(START_WARMUP, 10000); //For testing start in 10 seconds
             }
             inst_substate = FL_IDLE; // automatically go to idle
             log_nominal("Entering FL_IDLE");
@@ -65,31 +78,30 @@ void StratoLPC::FlightMode()
         break;
             
     case FL_IDLE:
+        // continuous sampling starts now rather than at the next grid point
+        if (_rate_start_pending) {
+            _rate_start_pending = false;
+            if ((_rate_policy.Mode() == LPC_RATE_CONTINUOUS) && (_cycle_planned_start > now())) {
+                _cycle_planned_start = now();
+                _action_scheduler.Schedule(START_WARMUP, 0);
+            }
+        }
         // some logic here to determine when to leave idle and go to FL_WARMUP, e.g.:
         if (CheckAction(START_WARMUP))
         {
             //ZephyrLogFine("Starting warmup");
             /* Set the instrument for warm up mode */
             StartTimeSeconds = now();
-            Serial.print("StartTimeSeconds Updated to: ");
-            Serial.println(StartTimeSeconds);
+            _cycle_start_error = (int32_t)(StartTimeSeconds - _cycle_planned_start);
+            LPC_LOG(LOG_FL_START_TIME, StartTimeSeconds);
             digitalWrite(PHA_POWER, HIGH); //turn on the optical head
-            if( OPC.MeasureLTC2983(4) < PumpMinTemp || OPC.MeasureLTC2983(6) < PumpMinTemp) //check pumps are above min temp
+            if (!PumpsWarm()) //check pumps are above min temp
             {
                 ZephyrLogWarn("Pump Temp too low");
-                Serial.println("Shutting down LPC");
+                LPC_LOG(LOG_LPC_SHUTDOWN);
                 LPC_Shutdown();
-                Serial.print("Last Measurement at: ");
-                Serial.println(StartTimeSeconds);
-                TimeElements nextMeasurement;
-                breakTime(StartTimeSeconds + (time_t)Set_cycleTime * 60l,nextMeasurement);
-                scheduler.AddAction(START_WARMUP, nextMeasurement);
-                Serial.print("Next Measurement schedueled for: ");
-                Serial.print(nextMeasurement.Hour);
-                Serial.print(":");
-                Serial.print(nextMeasurement.Minute);
-                Serial.print(":");
-                Serial.println(nextMeasurement.Second);
+                _cycles_skipped++;
+                ScheduleNextCycle();
                 inst_substate = FL_IDLE;
                 log_nominal("Entering FL_IDLE");
                 break;
@@ -100,11 +112,11 @@ void StratoLPC::FlightMode()
                 digitalWrite(HEATER1, HIGH);  //Laser heater on heater channel 1
             if (TempLaser > (Set_LaserTemp + DeadBand))
                 digitalWrite(HEATER1, LOW);
-            scheduler.AddAction(START_FLUSH, Set_warmUpTime);
+            _action_scheduler.Schedule(START_FLUSH, Set_warmUpTime * 1000UL);
             inst_substate = FL_WARMUP;
             log_nominal("Entering FL_WARMUP");
         }
-        log_debug("FL Idle");
+        LPC_LOG(LOG_FL_IDLE);
         break;
             
     case FL_WARMUP:
@@ -120,33 +132,42 @@ void StratoLPC::FlightMode()
             analogWrite(PUMP1_PWR, BEMF1_pwm);
             delay(200);
             analogWrite(PUMP2_PWR, BEMF2_pwm);
-            OPCSERIAL.begin(500000);  //PHA serial speed = 0.5Mb
+            OPCSERIAL.begin(PHA_BAUD_BASE);  //PHA serial speed = 0.5Mb, raised by _pha_baud
             delay(500);
             OPCSERIAL.setTimeout(2000); //Set the serial timout to 2s
-            // See if the PHA needs to be configured
-            phaConfig();
-            scheduler.AddAction(START_MEASUREMENT, Set_FlushingTime);
+            // The PHA can take commands now; phaCommandLoop() sends any
+            // configuration while flushing, or later if commanded mid-flight
+            _pha_cmd.Start();
+            _pha_baud.Start();
+            _action_scheduler.Schedule(START_MEASUREMENT, Set_FlushingTime * 1000UL);
             inst_substate = FL_FLUSH;
             log_nominal("Entering FL_FLUSH");
             
         }
-        log_debug("FL Warmup");
+        LPC_LOG(LOG_FL_WARMUP);
         break;
     
     case FL_FLUSH:
+        // collect command replies, and drop the frames from the flush
+        _pha_cmd.Listen();
 
         if (CheckAction(START_MEASUREMENT))
         {
+            // measure at the last good rate if the negotiation is not done
+            if (_pha_baud.Abort()) {
+                phaLinkReport();
+            }
             //ZephyrLogFine("Starting Measurement");
 
             inst_substate = FL_MEASURE;
             Frame = 0;
+            StartCycle();
             OPCSERIAL.flush();
             log_nominal("Entering FL_MEASURE");
             MeasurementStartTime = now(); //record the time when we start to difference subsequent times from
 
         }
-        log_debug("FL Flush");
+        LPC_LOG(LOG_FL_FLUSH);
         break;
             
     case FL_MEASURE:
@@ -167,54 +188,53 @@ void StratoLPC::FlightMode()
                 }
                 if(millis() > TimeOut)
                 {
-                    log_error("PHA Read Timeout");
+                    LPC_LOG(LOG_PHA_TIMEOUT);
                     break;
                 }
             }
-            log_debug("Received PHA Bytes: ");
-            Serial.println(indx);
+            LPC_LOG(LOG_PHA_BYTES, indx);
             
             if(inByte != '\n')  //if we exited due to a timeout
             {
                 ErrorCount++;
                 OPCSERIAL.flush();
             }
-           
+            else if(_pha_cmd.TakeLine(PHAArray, indx))
+            {
+                // a reply to a PHA command, not a frame
+            }
             else
             {
                 /* Process the PHA Data */
                 PHAArray[indx+1] ='\0'; //add a null after the data to end the string
                 parsePHA(indx); //Parse the PHA data to int array
+                _pha_cmd.FrameThreshold(PHA_Threshold);
                 fillBins(Frame,Set_samplesToAverage); //Downsample array into defined bins
 
-                Serial.print("Pulse Count: ");
-                Serial.println(PHA_PulseCount);
+                LPC_LOG(LOG_PHA_PULSES, PHA_PulseCount);
                 
                 /*Adjust the Pump Back EMF */
                 AdjustPumps();
                 /* Get the HK Data once for every averaged sample */
                 if(Frame%Set_samplesToAverage == 0)
                 {
-                    log_debug("collecting HK");
+                    LPC_LOG(LOG_HK_COLLECT);
 
                     Flow = getFlow();  //get flow from MFS
-                    Serial.print("Flow: ");
-                    Serial.println(Flow);
+                    LPC_LOG(LOG_HK_FLOW, Flow);
                     ReadHK(Frame/Set_samplesToAverage);  //read the HK and put in array (note integer division)
-                    Serial.print("Pump1 T: ");
-                    Serial.println(TempPump1);
-                    Serial.print("Pump2 T: ");
-                    Serial.println(TempPump2);
-                    Serial.print("Inlet T: ");
-                    Serial.println(TempInlet);
+                    LPC_LOG(LOG_HK_TEMPS, TempPump1, TempPump2, TempInlet);
                     CheckTemps();
 
                 }
                 Frame++;  //increment the measurement frame counter
+                if (Frame % Set_samplesToAverage == 0) {
+                    RecordComplete(Frame/Set_samplesToAverage - 1);
+                }
             }
         }
          
-        if( Frame >= Set_numberSamples)
+        if( Frame >= Set_numberSamples || CycleFull())
         {
             //ZephyrLogFine("Finished measurement");
             ErrorCount = 0;
@@ -229,34 +249,54 @@ void StratoLPC::FlightMode()
             inst_substate = FL_ERROR;
         }
         
-        log_debug("FL Measure");
+        LPC_LOG(LOG_FL_MEASURE);
         break;
             
-    case FL_SEND_TELEMETRY:
-        Serial.println("Shutting down LPC");
-        LPC_Shutdown();
-        PackageTelemetry(Frame/Set_samplesToAverage);
+    case FL_SEND_TELEMETRY: {
+        // Hand over once the next record buffer is free; RunArchive()
+        // frees it in the background, rather than QueueRecords() waiting
+        if (!RecordBufferFree()) {
+            break;
+        }
+        bool continuous = _rate_policy.Mode() == LPC_RATE_CONTINUOUS;
+        // a continuous cycle skips FL_IDLE, so check the pumps here
+        if (continuous && !PumpsWarm()) {
+            ZephyrLogWarn("Pump Temp too low");
+            continuous = false;
+        }
+        if (!continuous) {
+            LPC_LOG(LOG_LPC_SHUTDOWN);
+            LPC_Shutdown();
+        }
+        _cycles_run++;
+        _rate_policy.AddMeasurement(_cycle_rate_mode, now() - MeasurementStartTime);
+        // the TM and SD file are produced in the background by RunArchive()
+        FinishCycle(Frame/Set_samplesToAverage);
         Frame = 0;
-        Serial.print("Last Measurement at: ");
-        Serial.println(StartTimeSeconds);
-        TimeElements nextMeasurement;
-        breakTime(StartTimeSeconds + (time_t)Set_cycleTime * 60l,nextMeasurement);
-        scheduler.AddAction(START_WARMUP, nextMeasurement);
-        Serial.print("Next Measurement schedueled for: ");
-        Serial.print(nextMeasurement.Hour);
-        Serial.print(":");
-        Serial.print(nextMeasurement.Minute);
-        Serial.print(":");
-        Serial.println(nextMeasurement.Second);
+        LPC_LOG(LOG_FL_LAST_MEASUREMENT, StartTimeSeconds);
+        if (continuous) {
+            // the next cycle follows straight on, with the instrument still on
+            StartTimeSeconds = now();
+            _cycle_planned_start = StartTimeSeconds;
+            _cycle_start_error = 0;
+            StartCycle();
+            MeasurementStartTime = now();
+            inst_substate = FL_MEASURE;
+            log_nominal("Entering FL_MEASURE");
+            break;
+        }
+        ScheduleNextCycle();
+        ReportActionJitter();
         inst_substate = FL_IDLE;
         log_nominal("Entering FL_IDLE");
         break;
+    }
             
     case FL_ERROR:
         // generic error state for flight mode to go to if any error is detected
         // this state can make sure the ground is informed, and wait for ground intervention
         LPC_Shutdown();
-        log_debug("In Error Sub State");
+        LPC_LOG(LOG_FL_ERROR);
         break;
     case FL_SHUTDOWN:
         LPC_Shutdown();
@@ -265,6 +305,15 @@ void StratoLPC::FlightMode()
     case FL_EXIT:
         LPC_Shutdown();
         _rs41.pwr_off();
+        _rs41_reader.Cancel();
+        _action_scheduler.Cancel(RS41_SAMPLE);
+        _action_scheduler.Cancel(RATE_POLICY);
+        rateReport();
+        // finish sending and archiving the last cycle before closing files
+        while (_archive_pending || _archive_state != ARCHIVE_IDLE) {
+            RunArchive();
+        }
+        OPC.CloseAllFiles();
         _rs41_filename = "";
         _rs41_file_n_samples = 0;
         log_nominal("Exiting FL");
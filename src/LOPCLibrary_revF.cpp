@@ -12,21 +12,36 @@
 */
 
 #include "LOPCLibrary_revF.h"
+#include "LPCMemory.h"
+
+//SD sector buffers for the file cache slots, and one for BenchmarkSD(), in OCRAM (see LPCMemory.h)
+DMAMEM static uint8_t sd_contig_buffers[SD_CACHE_SIZE + 1][SD_CONTIG_BUFFER_BYTES] __attribute__((aligned(LPC_CACHE_LINE)));
 
 //this function creates the library's constructor
 LOPCLibrary::LOPCLibrary(int pin)
 {
   pinMode(pin, OUTPUT);
   _pin = pin;
+  for (int i = 0; i < SD_CACHE_SIZE; i++) {
+    _cache[i].name[0] = '\0';
+    _cache[i].last_use = 0;
+    _cache[i].dirty = false;
+    _cache[i].compressed = false;
+    _cache[i].contig.SetBuffer(sd_contig_buffers[i]);
+  }
+  memset(_catalog, 0, sizeof(_catalog));
+  memset(_dir_cache, 0, sizeof(_dir_cache));
   //Serial.begin(115200);
+#if !LPC_FAST_BOOT
   delay(1000);//while (!Serial); // Wait until Serial is ready
+#endif
 //  Serial.println("SD Card Setup");
 //  if(!SD.begin(BUILTIN_SDCARD)){
 //   Serial.println("Warning,SD card not inserted");
 //  }
 }                                              
 
-void LOPCLibrary::SetUp(){
+FLASHMEM void LOPCLibrary::SetUp(){
    //DIO Setup
    pinMode(PUMP1_PWR, OUTPUT);
    pinMode(PUMP2_PWR, OUTPUT);
@@ -40,14 +55,20 @@ void LOPCLibrary::SetUp(){
    pinMode(I_PUMP1, INPUT_DISABLE);
    pinMode(I_PUMP2, INPUT_DISABLE);
          
+#if !LPC_FAST_BOOT
    delay(1000);
+#endif
    //LTC2983 Setup
+   //The part initializes itself once out of reset; with LPC_FAST_BOOT the
+   //caller brings up the rest of the board meanwhile, then WaitLTC2983()
    
    pinMode(CHIP_SELECT, OUTPUT); // Configure chip select pin on Linduino
    pinMode(RESET,OUTPUT);
    pinMode(INTERUPT, INPUT);
    digitalWrite(RESET, HIGH);
+#if !LPC_FAST_BOOT
    delay(100);
+#endif
    SPI.begin();
    //SPI.setClockDivider(SPI_CLOCK_DIV128);
     
@@ -61,7 +82,25 @@ void LOPCLibrary::SetUp(){
 
 }
 
-void LOPCLibrary::configure_memory_table() 
+bool LOPCLibrary::LTC2983Ready()
+{
+  //Start clear and Done set (0x40) once initialization is complete
+  uint8_t status = transfer_byte(CHIP_SELECT, READ_FROM_RAM, COMMAND_STATUS_REGISTER, 0);
+  return (status & 0xC0) == 0x40;
+}
+
+FLASHMEM bool LOPCLibrary::WaitLTC2983(uint32_t timeout_ms)
+{
+  uint32_t start = millis();
+  while (!LTC2983Ready()) {
+    if (millis() - start >= timeout_ms)
+      return false;
+    delayMicroseconds(200);
+  }
+  return true;
+}
+
+FLASHMEM void LOPCLibrary::configure_memory_table() 
 {
   uint16_t start_address;
   //uint16_t table_length;
@@ -103,7 +142,7 @@ void LOPCLibrary::configure_memory_table()
 }
 
 
-void LOPCLibrary::ConfigureChannels()
+FLASHMEM void LOPCLibrary::ConfigureChannels()
 {
    //configure_channels(); 
    //uint8_t channel_number;
@@ -293,77 +332,49 @@ int LOPCLibrary::SerialNumber()
 */
 }
 
-int LOPCLibrary::FileNumber()             //reads the file number (16 bit int) from EEPROM
+int LOPCLibrary::FileNumber()             //returns the file number (16 bit int)
 {
-  //Gets what is currently written to EEPROM (File Counter)
+  LoadFileNumber();
   Serial.print("Current file counter is: ");
-  char Hi_val = EEPROM.read(2);
-  char Lo_val = EEPROM.read(3);
-  uint16_t int_val = Hi_val*256 + Lo_val; //recombine bytes into 16 bit int
-  Serial.println((int)int_val);
-  return int_val;
-  /*
-  //
-  bool UserEnteredInput = true;
-  Serial.println("Enter file counter (0-65535): ");
-   
-   int type;
-   type = Serial.parseInt();
-         
-  if((type>=0) && (type<65535)){
-    uint16_t TwoBytes = (unsigned int)type;  //recast type as an unsigned int
-    uint8_t LowByte = TwoBytes & 0xFF; //get the low byte
-    uint8_t HiByte = TwoBytes >> 8; //get the high byte
-    
-     EEPROM.write(2, (char)HiByte);  //Write high byte first
-     delay(100);  //EEPROM writes take a while
-     EEPROM.write(3, (char)LowByte);  //Write low byte
+  Serial.println((int)_filenum);
+  return _filenum;
+}
 
-    delay(100);
-   
-  char Hi_val = EEPROM.read(2);
-  char Lo_val = EEPROM.read(3);
-  uint16_t val = Hi_val*256 + Lo_val; //recombine bytes into 16 bit int
-  
-  
-  
-  Serial.print("Stored value is:  ");
-  Serial.println((int)type);
-  int value = (int)type;
-  Serial.println();
-  
-  return (int)type;
-  }
-  else
-  {
-    Serial.println("Invalid entry! File counter not updated");
-    Serial.println();
-    return int_val;
-  }
-  */
+void LOPCLibrary::LoadFileNumber()
+{
+  // The EEPROM holds a reservation: every number below it may already have been
+  // used, so after a reset we continue from the reservation and never reuse a name.
+  if (_filenum_loaded)
+    return;
+
+  uint8_t Hi_val = EEPROM.read(2);
+  uint8_t Lo_val = EEPROM.read(3);
+  _filenum = Hi_val*256 + Lo_val; //recombine bytes into 16 bit int
+  _filenum_loaded = true;
+  ReserveFileNumbers();
+}
+
+void LOPCLibrary::ReserveFileNumbers()
+{
+  // On the Teensy 4.1 the EEPROM is emulated in flash, so no delay is needed
+  // between the byte writes, and update() skips bytes that are unchanged.
+  _filenum_reserved = _filenum + FILE_COUNTER_BATCH;
+  EEPROM.update(2, (uint8_t)(_filenum_reserved >> 8));  //Write high byte first
+  EEPROM.update(3, (uint8_t)(_filenum_reserved & 0xFF));  //Write low byte
 }
 
 int LOPCLibrary::IncrementFile() //increases the file number by one each time a file is written.
 {
-  //Get current file counter.
-  char Hi_val = EEPROM.read(2);
-  char Lo_val = EEPROM.read(3);
-  uint16_t int_val = Hi_val*256 + Lo_val; //recombine bytes into 16 bit int
-  
-  //Get incremented file counter.
-  uint16_t inc_int_val = int_val + 1; //add one to 16 bit int
-  
-  uint16_t TwoBytes = (unsigned int)inc_int_val;  //recast type as an unsigned int
-    uint8_t LowByte = TwoBytes & 0xFF; //get the low byte
-    uint8_t HiByte = TwoBytes >> 8; //get the high byte
-    
-     EEPROM.write(2, (char)HiByte);  //Write high byte first
-     delay(100);  //EEPROM writes take a while
-     EEPROM.write(3, (char)LowByte);  //Write low byte
-     
+  LoadFileNumber();
+  _filenum++;
+
+  // Only touch the EEPROM when the reserved block of numbers is used up
+  if (_filenum == _filenum_reserved)
+    ReserveFileNumbers();
+
   _filecount++;
-  
-  return inc_int_val;
+
+  return _filenum;
 }
 
 String LOPCLibrary::CreateFileName()
@@ -374,9 +385,8 @@ String LOPCLibrary::CreateFileName()
   //Get file number from EEPROM to use as an extension
   int type = EEPROM.read(0);
   int serial = EEPROM.read(1);
-  char Hi_val = EEPROM.read(2);
-  char Lo_val = EEPROM.read(3);
-  uint16_t filenum = Hi_val*256 + Lo_val;
+  LoadFileNumber();
+  uint16_t filenum = _filenum;
   
   //First two letters of file name are generated
   if(type == 0)
@@ -418,17 +428,12 @@ String LOPCLibrary::CreateFileName()
 
 bool LOPCLibrary::FileExists(String FileName)
 {
-   char filename[100];
-     FileName.toCharArray(filename, 100);
-   if(SD.exists(filename))
-   {
-      Serial.println("File name already exists. Returning true");
-      Serial.println();
+   // A cached handle or a catalog hit means the file exists without asking the card
+   if(FindCached(FileName.c_str()) || InCatalog(FileName.c_str()))
       return true;
-   }
-   Serial.println("File name does not already exist. Returning false");
-   Serial.println();
-   return false;
+   if(!BeginSD())
+      return false;
+   return SD.exists(FileName.c_str());
 }
 
 String LOPCLibrary::GetNewFileName()
@@ -439,9 +444,8 @@ String LOPCLibrary::GetNewFileName()
   //Get file number from EEPROM to use as an extension
   int type = EEPROM.read(0);
   int serial = EEPROM.read(1);
-  char Hi_val = EEPROM.read(2);
-  char Lo_val = EEPROM.read(3);
-  uint16_t filenum = Hi_val*256 + Lo_val;
+  LoadFileNumber();
+  uint16_t filenum = _filenum;
   
   //First two letters of file name are generated
   if(type == 0)
@@ -483,36 +487,332 @@ String LOPCLibrary::GetNewFileName()
 }
 
 
-bool LOPCLibrary::WriteData(String FileName, String Data)
+bool LOPCLibrary::BeginSD()
 {
-File myFile;
+  // The card is initialized once per session. A missing card is retried,
+  // but not on every write.
+  if (_sd_ready)
+    return true;
+  if (_sd_last_attempt && (millis() - _sd_last_attempt < SD_RETRY_INTERVAL_MS))
+    return false;
 
-//Serial.print("Initializing SD card...");
-  if (!SD.begin(BUILTIN_SDCARD)) {
-    Serial.println("initialization failed!");
+  _sd_last_attempt = millis();
+  _sd_ready = SD.begin(BUILTIN_SDCARD);
+  if (!_sd_ready)
+    Serial.println("SD initialization failed!");
+  return _sd_ready;
+}
+
+LOPCLibrary::CachedFile* LOPCLibrary::FindCached(const char* FileName)
+{
+  for (int i = 0; i < SD_CACHE_SIZE; i++) {
+    if (InUse(_cache[i]) && !strcmp(_cache[i].name, FileName))
+      return &_cache[i];
+  }
+  return NULL;
+}
+
+LOPCLibrary::CachedFile* LOPCLibrary::TakeSlot()
+{
+  // Take a free slot, or evict the least recently used handle
+  CachedFile* entry = &_cache[0];
+  for (int i = 0; i < SD_CACHE_SIZE; i++) {
+    if (!InUse(_cache[i]))
+      return &_cache[i];
+    if (_cache[i].last_use < entry->last_use)
+      entry = &_cache[i];
+  }
+  Release(entry);
+  return entry;
+}
+
+void LOPCLibrary::Release(CachedFile* entry)
+{
+  // The block still in RAM goes out as a final, short block
+  if (entry->compressed && !entry->stream.Empty()) {
+    const uint8_t* frame;
+    size_t frame_len = entry->stream.Finish(&frame);
+    WriteRaw(entry, frame, frame_len);
+  }
+
+  // Closing an extent sets the file size, so a later append through an
+  // ordinary handle picks up where the extent left off.
+  if (entry->contig.IsOpen())
+    entry->contig.Close();
+  if (entry->file)
+    entry->file.close();
+  entry->name[0] = '\0';
+  entry->dirty = false;
+}
+
+LOPCLibrary::CachedFile* LOPCLibrary::OpenCached(const char* FileName)
+{
+  CachedFile* entry = FindCached(FileName);
+
+  if (!entry) {
+    if (!BeginSD() || strlen(FileName) >= SD_MAX_NAME)
+      return NULL;
+
+    entry = TakeSlot();
+    entry->file = SD.open(FileName, FILE_WRITE);
+    if (!entry->file)
+      return NULL;
+    strcpy(entry->name, FileName);
+    entry->compressed = IsCompressed(FileName);
+  }
+
+  entry->last_use = ++_cache_stamp;
+  return entry;
+}
+
+void LOPCLibrary::CloseFile(const char* FileName)
+{
+  CachedFile* entry = FindCached(FileName);
+  if (entry)
+    Release(entry);
+}
+
+void LOPCLibrary::CloseAllFiles()
+{
+  for (int i = 0; i < SD_CACHE_SIZE; i++) {
+    if (InUse(_cache[i]))
+      Release(&_cache[i]);
+  }
+}
+
+uint32_t LOPCLibrary::PathHash(const char* Path)
+{
+  // FNV-1a; zero is reserved for empty slots
+  uint32_t hash = 2166136261u;
+  while (*Path) {
+    hash ^= (uint8_t)*Path++;
+    hash *= 16777619u;
+  }
+  return hash ? hash : 1;
+}
+
+bool LOPCLibrary::InCatalog(const char* FileName)
+{
+  uint32_t hash = PathHash(FileName);
+  return _catalog[hash & (SD_CATALOG_SIZE - 1)] == hash;
+}
+
+bool LOPCLibrary::EnsureDirectory(const char* Dir)
+{
+  // New shard directories appear once per day (or hour), so a handful of
+  // remembered directories means the card is only asked when one is new.
+  uint32_t hash = PathHash(Dir);
+  for (int i = 0; i < SD_DIR_CACHE_SIZE; i++) {
+    if (_dir_cache[i] == hash)
+      return true;
+  }
+  if (!BeginSD())
+    return false;
+  if (!SD.exists(Dir) && !SD.mkdir(Dir)) {
+    Serial.print("Unable to create directory ");
+    Serial.println(Dir);
     return false;
   }
-  //Serial.println("initialization done.");
-
-  // open a new file, write to file and immediately close it:
-  //Serial.println("Writing to File: " + FileName);
-  char filename[100];
-     FileName.toCharArray(filename, 100);
-     
-  myFile = SD.open(filename, FILE_WRITE);
-  
-  // if the file opened okay, write to it:
-  if (myFile) {
-    //Serial.print("Writing to file...");
-    myFile.print(Data + " ");
-	// close the file:
-    myFile.close();
-    //Serial.println("done.");
-  } else {
-    // if the file didn't open, print an error:
-    Serial.println("error opening test.txt");
+  _dir_cache[_dir_cache_next] = hash;
+  _dir_cache_next = (_dir_cache_next + 1) % SD_DIR_CACHE_SIZE;
+  return true;
+}
+
+bool LOPCLibrary::CreateFile(const char* FileName, uint32_t Preallocate)
+{
+  if (!BeginSD() || strlen(FileName) >= SD_MAX_NAME)
     return false;
+
+  CachedFile* entry = FindCached(FileName);
+  if (entry)
+    Release(entry);
+  entry = TakeSlot();
+
+  // With an extent, appends go straight to contiguous sectors as multi-sector
+  // writes, and the FAT is only updated when the file is closed. Without one
+  // (or if no contiguous space is left) fall back to an ordinary handle.
+  if (!Preallocate || !entry->contig.Create(FileName, Preallocate)) {
+    entry->file = SD.open(FileName, FILE_WRITE);
+    if (!entry->file)
+      return false;
   }
+  strcpy(entry->name, FileName);
+  entry->last_use = ++_cache_stamp;
+  entry->compressed = IsCompressed(FileName);
+  if (entry->compressed)
+    WriteRaw(entry, LPC_COMPRESS_MAGIC, strlen(LPC_COMPRESS_MAGIC));
+
+  uint32_t hash = PathHash(FileName);
+  _catalog[hash & (SD_CATALOG_SIZE - 1)] = hash;
   return true;
 }
 
+bool LOPCLibrary::IsCompressed(const char* FileName)
+{
+  size_t n = strlen(FileName);
+  size_t suffix = strlen(LPC_COMPRESS_SUFFIX);
+  return (n > suffix) && !strcmp(FileName + n - suffix, LPC_COMPRESS_SUFFIX);
+}
+
+void LOPCLibrary::SyncFiles(bool force)
+{
+  if (!force && (millis() - _last_sync < SD_SYNC_INTERVAL_MS))
+    return;
+
+  _last_sync = millis();
+  for (int i = 0; i < SD_CACHE_SIZE; i++) {
+    if (!_cache[i].dirty)
+      continue;
+    // A compressed file's partial block stays in RAM until it fills, as
+    // short blocks would cost ratio; at most one block is at risk.
+    if (_cache[i].contig.IsOpen())
+      _cache[i].contig.Sync();
+    else if (_cache[i].file)
+      _cache[i].file.flush();
+    _cache[i].dirty = false;
+  }
+}
+
+bool LOPCLibrary::WriteData(const char* FileName, const void* Data, size_t Length)
+{
+  CachedFile* entry = OpenCached(FileName);
+  if (!entry) {
+    Serial.print("error opening ");
+    Serial.println(FileName);
+    return false;
+  }
+
+  // Data stays in RAM until SyncFiles() or CloseFile()
+  entry->dirty = true;
+  if (!entry->compressed)
+    return WriteRaw(entry, Data, Length);
+
+  // Compressed blocks are written as each one fills
+  const uint8_t* src = (const uint8_t*)Data;
+  bool ok = true;
+  while (Length) {
+    size_t n = entry->stream.Append(src, Length);
+    src += n;
+    Length -= n;
+    if (entry->stream.Full()) {
+      const uint8_t* frame;
+      size_t frame_len = entry->stream.Finish(&frame);
+      ok = WriteRaw(entry, frame, frame_len) && ok;
+    }
+  }
+  return ok;
+}
+
+bool LOPCLibrary::WriteRaw(CachedFile* entry, const void* Data, size_t Length)
+{
+  if (entry->contig.IsOpen()) {
+    size_t written = entry->contig.Write(Data, Length);
+    if (written == Length)
+      return true;
+
+    // The extent is full: close it and carry on with an ordinary handle
+    entry->contig.Close();
+    entry->file = SD.open(entry->name, FILE_WRITE);
+    if (!entry->file)
+      return false;
+    Data = (const uint8_t*)Data + written;
+    Length -= written;
+  }
+  return entry->file.write(Data, Length) == Length;
+}
+
+bool LOPCLibrary::WriteData(String FileName, String Data)
+{
+  Data += " ";
+  return WriteData(FileName.c_str(), Data.c_str(), Data.length());
+}
+
+// Per-write latency statistics for BenchmarkSD()
+struct SDBenchStats {
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint32_t writes;
+
+  void reset() { min_us = UINT32_MAX; max_us = 0; total_us = 0; writes = 0; }
+  void add(uint32_t us) {
+    if (us < min_us) min_us = us;
+    if (us > max_us) max_us = us;
+    total_us += us;
+    writes++;
+  }
+  void print(const char* path, uint32_t record_bytes, uint32_t elapsed_us) {
+    Serial.printf("%-10s %6lu B x %4lu: %8.1f KB/s, write us min %6lu mean %6lu max %6lu\n",
+      path, (unsigned long)record_bytes, (unsigned long)writes,
+      (record_bytes * (float)writes / 1024.0) / (elapsed_us / 1e6),
+      (unsigned long)min_us, (unsigned long)(total_us / writes), (unsigned long)max_us);
+  }
+};
+
+FLASHMEM void LOPCLibrary::BenchmarkSD()
+{
+  // Record sizes of an RS41 CSV row and of a 60 record LPC cycle
+  static const uint32_t record_bytes[] = {120, 5832};
+  static const uint32_t records[] = {300, 20};
+  DMAMEM static uint8_t data[5832];
+  SDBenchStats stats;
+  LPCContigFile contig;
+  contig.SetBuffer(sd_contig_buffers[SD_CACHE_SIZE]);
+
+  if (!BeginSD())
+    return;
+  for (uint32_t i = 0; i < sizeof(data); i++)
+    data[i] = 'a' + i % 26;
+  SD.mkdir("/BENCH");
+
+  Serial.println("SD benchmark: open/close per record (original), cached handle, contiguous extent");
+  for (int t = 0; t < 2; t++) {
+    uint32_t n = record_bytes[t];
+    uint32_t start;
+
+    // Original path: open, write, close for every record
+    SD.remove("/BENCH/OPEN.DAT");
+    stats.reset();
+    start = micros();
+    for (uint32_t r = 0; r < records[t]; r++) {
+      uint32_t t0 = micros();
+      File f = SD.open("/BENCH/OPEN.DAT", FILE_WRITE);
+      f.write(data, n);
+      f.close();
+      stats.add(micros() - t0);
+    }
+    stats.print("open/close", n, micros() - start);
+
+    // Cached handle, flushed at the end as SyncFiles() would
+    SD.remove("/BENCH/CACHED.DAT");
+    stats.reset();
+    start = micros();
+    File f = SD.open("/BENCH/CACHED.DAT", FILE_WRITE);
+    for (uint32_t r = 0; r < records[t]; r++) {
+      uint32_t t0 = micros();
+      f.write(data, n);
+      stats.add(micros() - t0);
+    }
+    f.close();
+    stats.print("cached", n, micros() - start);
+
+    // Contiguous extent, FAT updated once at close
+    stats.reset();
+    start = micros();
+    if (contig.Create("/BENCH/CONTIG.DAT", n * records[t])) {
+      for (uint32_t r = 0; r < records[t]; r++) {
+        uint32_t t0 = micros();
+        contig.Write(data, n);
+        stats.add(micros() - t0);
+      }
+      contig.Close();
+      stats.print("contiguous", n, micros() - start);
+    } else {
+      Serial.println("contiguous: unable to allocate extent");
+    }
+  }
+
+  SD.remove("/BENCH/OPEN.DAT");
+  SD.remove("/BENCH/CACHED.DAT");
+  SD.remove("/BENCH/CONTIG.DAT");
+}
@@ -21,6 +21,8 @@
 
 #include <SD.h>
 //#include <SdFatConfig.h>
+#include "LPCContigFile.h"
+#include "LPCCompress.h"
 
 //Teensy 3.6 specific SD card config
 //#define USE_SDIO 1
@@ -87,14 +89,29 @@
 #define PHA_THERM 16
 #define OAT_THERM 20
 
+//Boot
+#define LPC_FAST_BOOT true              //Poll for readiness instead of the fixed startup delays
+#define LTC2983_READY_TIMEOUT_MS 1100   //Longest wait for the LTC2983 to initialize after reset (the delays it replaces)
+
 //MFS i2c Address
 #define sensor 0x49 //Define airflow sensor
 
+//SD card file handling
+#define SD_CACHE_SIZE 4             //Number of file handles kept open between writes
+#define SD_MAX_NAME 64              //Longest path that can be cached
+#define SD_SYNC_INTERVAL_MS 5000    //Dirty cached files are flushed to the card at this interval
+#define SD_RETRY_INTERVAL_MS 10000  //Minimum time between attempts to initialize a missing card
+#define FILE_COUNTER_BATCH 16       //File numbers reserved per EEPROM write of the file counter
+#define SD_CATALOG_SIZE 64          //Slots in the RAM catalog of files created this session (power of 2)
+#define SD_DIR_CACHE_SIZE 4         //Recently used directories known to exist
+
 class LOPCLibrary
 {
   public:
     LOPCLibrary(int pin);
-    void SetUp();//Configures Teensy to LTC2983
+    void SetUp();//Configures Teensy to LTC2983, and releases the LTC2983 from reset
+    bool LTC2983Ready(); //true once the LTC2983 has initialized after power up or reset
+    bool WaitLTC2983(uint32_t timeout_ms); //Poll LTC2983Ready() for up to timeout_ms, return false on timeout
     void ConfigureChannels(); //Configure LTC2983 Channel settings
     void configure_memory_table(); // Configure custom thermistor parameters
     void SleepLTC2983(); //put the LTC2983 to sleep
@@ -103,20 +120,67 @@ class LOPCLibrary
     void printTemps();
     int InstrumentType(); //reads/writes the instrument type (1,2 or 3) from EEPROM, error checking as above.
     int SerialNumber(); //reads/writes the instrument serial number from flash and returns it as an int. Returns -1 if error occured
-    int FileNumber(); //reads/writes the file number from EEPROM, error checking as above. Returns -1 if error occured
-    int IncrementFile(); //increments the file number
+    int FileNumber(); //returns the file number, loaded once from EEPROM and then kept in RAM
+    int IncrementFile(); //increments the file number, persisting to EEPROM once every FILE_COUNTER_BATCH files
     int ErrorCheck(int serial, int type, int file); //checks to see if errors occured. Returns # of errors found.   
     String CreateFileName();
     bool FileExists(String FileName); //Check to make sure the file name doesn't already exist, return False if it doesn't exist, true exist.
     String GetNewFileName(); //would create an alternative filename 'OPxxyyyy.1' using the first available extension.
-    bool WriteData(String FileName, String Data); //Open the file, write the data, close the file, return true on success.
+    bool WriteData(String FileName, String Data); //Write the data (plus a trailing space) to a cached file handle, return true on success.
+    bool WriteData(const char* FileName, const void* Data, size_t Length); //Write raw bytes to a cached file handle, return true on success.
+    bool BeginSD(); //Initialize the SD card once; returns true if the card is ready.
+    void CloseFile(const char* FileName); //Close a cached file, e.g. when it is complete.
+    void CloseAllFiles(); //Close all cached files.
+    void SyncFiles(bool force = false); //Flush dirty cached files every SD_SYNC_INTERVAL_MS, or now if force.
+    bool EnsureDirectory(const char* Dir); //Create Dir if needed; only touches the card the first time a directory is seen.
+    bool CreateFile(const char* FileName, uint32_t Preallocate); //Create a new file and catalog it. With Preallocate, writes go to a contiguous extent of that size.
+                                                                 //Files named *LPC_COMPRESS_SUFFIX are written as compressed blocks.
+    void BenchmarkSD(); //Compare per-record open/close, cached handle and contiguous extent writes, printing the results. Destructive to /BENCH.
     float ReadAnalog(int channel);
     
   private:
+    struct CachedFile {
+      File file;              //append handle, for files without an extent
+      LPCContigFile contig;   //raw extent writer, for files created with Preallocate
+      LPCCompressStream stream; //block compressor, for files named *LPC_COMPRESS_SUFFIX
+      bool compressed;
+      char name[SD_MAX_NAME];
+      uint32_t last_use;      //LRU stamp
+      bool dirty;             //written since the last flush
+    };
+
+    void LoadFileNumber();
+    void ReserveFileNumbers();
+    CachedFile* FindCached(const char* FileName);
+    CachedFile* OpenCached(const char* FileName);
+    CachedFile* TakeSlot();
+    void Release(CachedFile* entry);
+    bool WriteRaw(CachedFile* entry, const void* Data, size_t Length);
+    static bool IsCompressed(const char* FileName);
+    bool InCatalog(const char* FileName);
+    static bool InUse(CachedFile& entry) { return entry.contig.IsOpen() || entry.file; }
+    static uint32_t PathHash(const char* Path);
+
     int _pin;
     int _filecount;
     //Sd2Card _SD;
 
+    bool _sd_ready = false;
+    uint32_t _sd_last_attempt = 0;
+    CachedFile _cache[SD_CACHE_SIZE];
+    uint32_t _cache_stamp = 0;
+    uint32_t _last_sync = 0;
+
+    //Direct mapped catalog of files created this session, keyed by path hash.
+    //A miss (or a collision) just falls back to asking the card.
+    uint32_t _catalog[SD_CATALOG_SIZE];
+    uint32_t _dir_cache[SD_DIR_CACHE_SIZE];
+    int _dir_cache_next = 0;
+
+    bool _filenum_loaded = false;
+    uint16_t _filenum = 0;          //next file number
+    uint16_t _filenum_reserved = 0; //value stored in EEPROM; numbers below it may be in use
+
 };
 
 #endif
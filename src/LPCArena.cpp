@@ -0,0 +1,40 @@
+/*
+ *  LPCArena.cpp
+ *  Created: October 2026
+ *
+ *  Bump allocator over a fixed block of RAM, for the measurement buffers.
+ *  See LPCArena.h.
+ */
+
+#include "LPCArena.h"
+
+LPCArena::LPCArena(uint8_t* memory, size_t size)
+    : _memory(memory),
+    _size(size),
+    _used(0),
+    _peak(0),
+    _failures(0)
+{
+}
+
+void* LPCArena::Alloc(size_t bytes, size_t align)
+{
+    size_t start = (_used + align - 1) & ~(align - 1);
+    if (start > _size || bytes > _size - start) {
+        _failures++;
+        return nullptr;
+    }
+
+    _used = start + bytes;
+    if (_used > _peak) {
+        _peak = _used;
+    }
+    return _memory + start;
+}
+
+void LPCArena::Release(size_t mark)
+{
+    if (mark < _used) {
+        _used = mark;
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ *  LPCArena.h
+ *  Created: October 2026
+ *
+ *  Bump allocator over a fixed block of RAM, for the measurement buffers.
+ *
+ *  Buffers are carved off the front of the block and are never freed one
+ *  by one. Mark() and Release() bracket a group of allocations, so that
+ *  buffers which last for the whole flight can be allocated once below the
+ *  mark, and the per cycle buffers above it are released and carved again,
+ *  sized from the configuration, at the start of each measurement cycle.
+ *
+ *  The arena does not own its memory and has no failure path beyond
+ *  returning nullptr: callers check Fits() first (e.g. when a TC changes
+ *  the configuration), so a failed Alloc() indicates a sizing bug.
+ */
+
+#ifndef LPCARENA_H
+#define LPCARENA_H
+
+#include <Arduino.h>
+
+class LPCArena {
+public:
+    LPCArena(uint8_t* memory, size_t size);
+
+    /// @brief Allocate bytes aligned to align (a power of two), or nullptr
+    void* Alloc(size_t bytes, size_t align = 4);
+    /// @brief Allocate an array of n T
+    template <typename T> T* AllocArray(size_t n) { return (T*)Alloc(n * sizeof(T), alignof(T)); }
+
+    /// @brief The current top of the arena, for Release()
+    size_t Mark() const { return _used; }
+    /// @brief Free everything allocated since mark was taken
+    void Release(size_t mark);
+    /// @brief Free everything
+    void Reset() { Release(0); }
+
+    /// @brief True if bytes more (at the worst case alignment) would fit
+    bool Fits(size_t bytes) const { return bytes + 8 <= Free(); }
+
+    size_t Size() const { return _size; }
+    size_t Used() const { return _used; }
+    size_t Free() const { return _size - _used; }
+    /// @brief Highest Used() since boot
+    size_t Peak() const { return _peak; }
+    /// @brief Number of Alloc() calls that did not fit
+    uint16_t Failures() const { return _failures; }
+
+private:
+    uint8_t* _memory;
+    size_t _size;
+    size_t _used;
+    size_t _peak;
+    uint16_t _failures;
+};
+
+#endif /* LPCARENA_H */
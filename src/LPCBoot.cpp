@@ -0,0 +1,61 @@
+/*
+ *  LPCBoot.cpp
+ *  Created: October 2026
+ *
+ *  Boot time breakdown and reset cause. See LPCBoot.h.
+ */
+
+#include "LPCBoot.h"
+
+uint32_t LPCBoot::_marks[LPC_BOOT_N_STAGES] = {0};
+uint32_t LPCBoot::_reset_cause = 0;
+
+static const char* const STAGE_NAMES[LPC_BOOT_N_STAGES] = {
+    "setup", "ports", "core", "sd", "ltc2983", "runmode",
+};
+
+FLASHMEM void LPCBoot::Begin()
+{
+    // The bits are sticky until written back
+    _reset_cause = SRC_SRSR;
+    SRC_SRSR = _reset_cause;
+    Mark(LPC_BOOT_SETUP);
+}
+
+bool LPCBoot::Mark(LPCBootStage stage)
+{
+    if (_marks[stage]) {
+        return false;
+    }
+    // 0 means not reached
+    _marks[stage] = micros() | 1;
+    return true;
+}
+
+uint32_t LPCBoot::StageUs(LPCBootStage stage)
+{
+    if (!_marks[stage]) {
+        return 0;
+    }
+    for (int prev = stage - 1; prev >= 0; prev--) {
+        if (_marks[prev]) {
+            return _marks[stage] - _marks[prev];
+        }
+    }
+    return _marks[stage];
+}
+
+uint32_t LPCBoot::TotalMs()
+{
+    for (int stage = LPC_BOOT_N_STAGES - 1; stage >= 0; stage--) {
+        if (_marks[stage]) {
+            return _marks[stage] / 1000;
+        }
+    }
+    return 0;
+}
+
+const char* LPCBoot::StageName(LPCBootStage stage)
+{
+    return stage < LPC_BOOT_N_STAGES ? STAGE_NAMES[stage] : "?";
+}
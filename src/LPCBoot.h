@@ -0,0 +1,65 @@
+/*
+ *  LPCBoot.h
+ *  Created: October 2026
+ *
+ *  Boot time breakdown and reset cause.
+ *
+ *  Every watchdog reset in flight is dead time until the first RunMode()
+ *  pass, so the boot is timed in stages: Mark() records micros() the
+ *  first time each stage is reached, and the breakdown is logged and sent
+ *  in the MEM TM (see StratoLPC::LogBoot()). The reset cause comes from
+ *  the i.MX RT SRC_SRSR register, which is cleared once read so that each
+ *  boot reports only its own cause.
+ */
+
+#ifndef LPCBOOT_H
+#define LPCBOOT_H
+
+#include <Arduino.h>
+
+/// Boot stages, in order. Each one's time runs from the previous mark
+/// (or the reset, for the first).
+enum LPCBootStage : uint8_t {
+    LPC_BOOT_SETUP,     // setup() entered: core startup and constructors
+    LPC_BOOT_PORTS,     // Debug and Zephyr ports, loop timer
+    LPC_BOOT_CORE,      // StratoCore initialized
+    LPC_BOOT_SD,        // Board I/O, buffers, SD card (LTC2983 starting up meanwhile)
+    LPC_BOOT_LTC2983,   // LTC2983 ready and configured
+    LPC_BOOT_RUNMODE,   // First pass of the loop
+    LPC_BOOT_N_STAGES
+};
+
+/// SRC_SRSR reset cause bits
+#define LPC_RESET_POWER_ON  0x001   // IPP_RESET_B: power on (cold)
+#define LPC_RESET_SOFTWARE  0x002   // LOCKUP_SYSRESETREQ: lockup or software reset
+#define LPC_RESET_WDOG      0x010   // WDOG1 or WDOG2
+#define LPC_RESET_WDOG3     0x080
+#define LPC_RESET_TEMPSENSE 0x100   // Over temperature
+
+class LPCBoot {
+public:
+    /// @brief Read and clear the reset cause, and mark LPC_BOOT_SETUP;
+    /// call first thing in setup()
+    static void Begin();
+    /// @brief Record reaching a stage
+    /// @return true the first time the stage is marked
+    static bool Mark(LPCBootStage stage);
+    /// @brief Whether the stage has been reached
+    static bool Reached(LPCBootStage stage) { return _marks[stage] != 0; }
+    /// @brief Time spent in a stage, since the previous one, in microseconds
+    static uint32_t StageUs(LPCBootStage stage);
+    /// @brief Time from reset to the last stage reached, in milliseconds
+    static uint32_t TotalMs();
+    /// @brief The SRC_SRSR bits of this boot (LPC_RESET_*)
+    static uint32_t ResetCause() { return _reset_cause; }
+    /// @brief Anything but a power on reset, e.g. the watchdog
+    static bool WarmReset() { return !(_reset_cause & LPC_RESET_POWER_ON); }
+    /// @brief Short name of a stage, for the log
+    static const char* StageName(LPCBootStage stage);
+
+private:
+    static uint32_t _marks[LPC_BOOT_N_STAGES];
+    static uint32_t _reset_cause;
+};
+
+#endif /* LPCBOOT_H */
@@ -0,0 +1,232 @@
+/*
+ *  LPCCompress.cpp
+ *  Created: October 2026
+ *
+ *  Block LZ77 compressor and streaming framer. See LPCCompress.h.
+ */
+
+#include "LPCCompress.h"
+
+#include <string.h>
+
+// Also built for the host tools, which have no memory placement
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#define DMAMEM
+#endif
+
+#define HASH_BITS 10
+#define MIN_MATCH 4
+
+// Shared by all streams: the table only lives for one LPCCompressBlock() call
+static uint16_t hash_table[1 << HASH_BITS];
+// Shared output buffer for LPCCompressStream::Finish(), in OCRAM on the
+// instrument (see LPCMemory.h)
+DMAMEM static uint8_t frame_buffer[LPC_COMPRESS_FRAME_MAX];
+
+static inline uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/// @brief Write a length continuation (for counts of 15 or more)
+static inline bool putLength(uint8_t** op, const uint8_t* end, uint32_t n)
+{
+    while (n >= 255) {
+        if (*op >= end) {
+            return false;
+        }
+        *(*op)++ = 255;
+        n -= 255;
+    }
+    if (*op >= end) {
+        return false;
+    }
+    *(*op)++ = (uint8_t)n;
+    return true;
+}
+
+/// @brief Emit literals [lit, lit + lit_len) followed by an optional match
+static bool putSequence(uint8_t** op, const uint8_t* end, const uint8_t* lit, uint32_t lit_len,
+                        uint16_t offset, uint32_t match_len)
+{
+    if (*op >= end) {
+        return false;
+    }
+    uint32_t ml = match_len ? match_len - MIN_MATCH : 0;
+    uint8_t* token = (*op)++;
+    *token = (uint8_t)(((lit_len < 15 ? lit_len : 15) << 4) | (ml < 15 ? ml : 15));
+    if (lit_len >= 15 && !putLength(op, end, lit_len - 15)) {
+        return false;
+    }
+    if ((uint32_t)(end - *op) < lit_len) {
+        return false;
+    }
+    memcpy(*op, lit, lit_len);
+    *op += lit_len;
+    if (!match_len) {
+        return true;
+    }
+    if (end - *op < 2) {
+        return false;
+    }
+    *(*op)++ = (uint8_t)(offset & 0xFF);
+    *(*op)++ = (uint8_t)(offset >> 8);
+    return (ml < 15) || putLength(op, end, ml - 15);
+}
+
+uint16_t LPCCompressBlock(const uint8_t* src, uint16_t len, uint8_t* dst, uint16_t dst_cap)
+{
+    if (len < 2 * MIN_MATCH) {
+        return 0;
+    }
+    if (dst_cap > len) {
+        dst_cap = len;  // Only worth it if it is smaller
+    }
+
+    memset(hash_table, 0, sizeof(hash_table));
+    uint8_t* op = dst;
+    const uint8_t* end = dst + dst_cap;
+    uint32_t ip = 0;
+    uint32_t anchor = 0;
+    const uint32_t limit = len - MIN_MATCH;
+
+    while (ip <= limit) {
+        uint32_t v = read32(src + ip);
+        uint32_t h = hash4(v);
+        uint32_t ref = hash_table[h];  // position + 1, 0 = empty
+        hash_table[h] = (uint16_t)(ip + 1);
+
+        if (ref && read32(src + ref - 1) == v) {
+            ref--;
+            uint32_t match_len = MIN_MATCH;
+            while (ip + match_len < len && src[ref + match_len] == src[ip + match_len]) {
+                match_len++;
+            }
+            if (!putSequence(&op, end, src + anchor, ip - anchor, (uint16_t)(ip - ref), match_len)) {
+                return 0;
+            }
+            ip += match_len;
+            anchor = ip;
+        } else {
+            // Skip faster through data that is not matching
+            ip += 1 + ((ip - anchor) >> 5);
+        }
+    }
+
+    if (!putSequence(&op, end, src + anchor, len - anchor, 0, 0)) {
+        return 0;
+    }
+    uint16_t n = (uint16_t)(op - dst);
+    return (n < len) ? n : 0;
+}
+
+int LPCDecompressBlock(const uint8_t* src, uint16_t len, uint8_t* dst, uint16_t dst_cap)
+{
+    const uint8_t* ip = src;
+    const uint8_t* end = src + len;
+    uint32_t op = 0;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+
+        uint32_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) {
+                    return -1;
+                }
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+        if ((uint32_t)(end - ip) < lit_len || dst_cap - op < lit_len) {
+            return -1;
+        }
+        memcpy(dst + op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return -1;
+        }
+        uint32_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        uint32_t match_len = token & 0x0F;
+        if (match_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) {
+                    return -1;
+                }
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += MIN_MATCH;
+        if (!offset || offset > op || dst_cap - op < match_len) {
+            return -1;
+        }
+        // Byte copy, since a match may overlap its own output
+        for (uint32_t i = 0; i < match_len; i++, op++) {
+            dst[op] = dst[op - offset];
+        }
+    }
+    return (int)op;
+}
+
+LPCCompressStream::LPCCompressStream()
+    : _used(0),
+    _raw_bytes(0),
+    _compressed_bytes(0)
+{
+}
+
+size_t LPCCompressStream::Append(const void* data, size_t len)
+{
+    size_t n = LPC_COMPRESS_BLOCK_SIZE - _used;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(_block + _used, data, n);
+    _used += n;
+    return n;
+}
+
+size_t LPCCompressStream::Finish(const uint8_t** frame)
+{
+    if (!_used) {
+        *frame = frame_buffer;
+        return 0;
+    }
+
+    uint8_t* payload = frame_buffer + LPC_COMPRESS_FRAME_HEADER;
+    uint16_t comp_len = LPCCompressBlock(_block, _used, payload, LPC_COMPRESS_BLOCK_SIZE);
+    if (!comp_len) {
+        memcpy(payload, _block, _used);  // Stored
+    }
+
+    frame_buffer[0] = (uint8_t)(_used & 0xFF);
+    frame_buffer[1] = (uint8_t)(_used >> 8);
+    frame_buffer[2] = (uint8_t)(comp_len & 0xFF);
+    frame_buffer[3] = (uint8_t)(comp_len >> 8);
+
+    size_t frame_len = LPC_COMPRESS_FRAME_HEADER + (comp_len ? comp_len : _used);
+    _raw_bytes += _used;
+    _compressed_bytes += frame_len;
+    _used = 0;
+    *frame = frame_buffer;
+    return frame_len;
+}
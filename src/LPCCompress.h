@@ -0,0 +1,81 @@
+/*
+ *  LPCCompress.h
+ *  Created: October 2026
+ *
+ *  Small, static memory streaming compressor for SD archives.
+ *
+ *  Data is collected into blocks of up to LPC_COMPRESS_BLOCK_SIZE bytes,
+ *  and each block is compressed independently with an LZ4 style byte
+ *  oriented LZ77 coder. Independent blocks mean that a file cut short by a
+ *  reset loses at most the block that was still in RAM.
+ *
+ *  Compressed file layout (all integers little-endian):
+ *    "LZB1"
+ *    repeated: u16 raw_len, u16 comp_len, comp_len bytes
+ *              (comp_len == 0: the block is stored, raw_len bytes follow)
+ *  A raw_len of 0 or 0xFFFF (erased card sectors) ends the stream.
+ *
+ *  Block encoding: a sequence of
+ *    token (literal count << 4 | (match length - 4)), with a count of 15
+ *    continued in following bytes (255 = keep adding), the literals,
+ *    then (unless the block ends after the literals) a u16 match offset
+ *    and any match length continuation bytes.
+ *
+ *  This file has no Arduino dependencies, and is also built by the host
+ *  tools in tools/.
+ */
+
+#ifndef LPCCOMPRESS_H
+#define LPCCOMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Uncompressed bytes per block
+#define LPC_COMPRESS_BLOCK_SIZE 2048
+/// Bytes of framing in front of each block
+#define LPC_COMPRESS_FRAME_HEADER 4
+/// Worst case size of a framed block
+#define LPC_COMPRESS_FRAME_MAX (LPC_COMPRESS_FRAME_HEADER + LPC_COMPRESS_BLOCK_SIZE)
+/// File name suffix of compressed files
+#define LPC_COMPRESS_SUFFIX ".lzb"
+/// Magic at the start of a compressed file
+#define LPC_COMPRESS_MAGIC "LZB1"
+
+/// @brief Compress one block.
+/// The hash table is static and shared, so calls must not be concurrent.
+/// @return The compressed length, or 0 if it would not be smaller than len
+uint16_t LPCCompressBlock(const uint8_t* src, uint16_t len, uint8_t* dst, uint16_t dst_cap);
+
+/// @brief Decompress one block
+/// @return The decompressed length, or -1 if the block is corrupt
+int LPCDecompressBlock(const uint8_t* src, uint16_t len, uint8_t* dst, uint16_t dst_cap);
+
+/// @brief Collects a byte stream into blocks and frames them.
+/// Append() until Full(), then Finish() yields the framed block to write.
+class LPCCompressStream {
+public:
+    LPCCompressStream();
+
+    /// @brief Buffer up to len bytes
+    /// @return The number of bytes taken, short when the block fills
+    size_t Append(const void* data, size_t len);
+    bool Full() const { return _used == LPC_COMPRESS_BLOCK_SIZE; }
+    bool Empty() const { return _used == 0; }
+    /// @brief Compress and frame the buffered bytes, and empty the buffer
+    /// @param frame Set to the framed block, valid until the next Finish()
+    /// @return The framed length, 0 if nothing was buffered
+    size_t Finish(const uint8_t** frame);
+
+    /// Totals for reporting the achieved ratio
+    uint32_t RawBytes() const { return _raw_bytes; }
+    uint32_t CompressedBytes() const { return _compressed_bytes; }
+
+private:
+    uint16_t _used;
+    uint32_t _raw_bytes;
+    uint32_t _compressed_bytes;
+    uint8_t _block[LPC_COMPRESS_BLOCK_SIZE];
+};
+
+#endif /* LPCCOMPRESS_H */
@@ -0,0 +1,97 @@
+/*
+ *  LPCConfigJournal.cpp
+ *  Created: October 2026
+ *
+ *  Append-only EEPROM configuration journal. See LPCConfigJournal.h.
+ */
+
+#include "LPCConfigJournal.h"
+#include <EEPROM.h>
+
+LPCConfigJournal::LPCConfigJournal(uint16_t start, uint16_t bytes, uint8_t payload_len)
+    : _start(start)
+{
+    if (payload_len > LPC_JOURNAL_MAX_PAYLOAD) {
+        payload_len = LPC_JOURNAL_MAX_PAYLOAD;
+    }
+    _payload_len = payload_len;
+    _slot_bytes = 4 + payload_len + 2;
+    _slots = bytes / _slot_bytes;
+    _write_pos = _slot_bytes;
+}
+
+bool LPCConfigJournal::Restore(void* payload)
+{
+    uint8_t slot_data[sizeof(_staged)];
+    bool found = false;
+
+    for (uint16_t slot = 0; slot < _slots; slot++) {
+        uint16_t address = SlotAddress(slot);
+        for (uint16_t i = 0; i < _slot_bytes; i++) {
+            slot_data[i] = EEPROM.read(address + i);
+        }
+        if (slot_data[0] != LPC_JOURNAL_MAGIC || slot_data[1] != _payload_len) {
+            continue;
+        }
+        uint16_t crc = slot_data[_slot_bytes - 2] | (slot_data[_slot_bytes - 1] << 8);
+        if (Crc(slot_data, _slot_bytes - 2) != crc) {
+            continue;
+        }
+        uint16_t seq = slot_data[2] | (slot_data[3] << 8);
+        // Sequence numbers wrap, and there are far fewer slots than numbers
+        if (!found || (int16_t)(seq - _seq) > 0) {
+            found = true;
+            _seq = seq;
+            _next_slot = (slot + 1) % _slots;
+            memcpy(payload, slot_data + 4, _payload_len);
+        }
+    }
+    return found;
+}
+
+void LPCConfigJournal::Save(const void* payload)
+{
+    if (!_slots) {
+        return;
+    }
+    // A record cut short is invalid anyway, so rewrite the same slot
+    if (!Busy()) {
+        _write_slot = _next_slot;
+        _next_slot = (_next_slot + 1) % _slots;
+    }
+    _seq++;
+
+    _staged[0] = LPC_JOURNAL_MAGIC;
+    _staged[1] = _payload_len;
+    _staged[2] = _seq & 0xFF;
+    _staged[3] = _seq >> 8;
+    memcpy(_staged + 4, payload, _payload_len);
+    uint16_t crc = Crc(_staged, _slot_bytes - 2);
+    _staged[_slot_bytes - 2] = crc & 0xFF;
+    _staged[_slot_bytes - 1] = crc >> 8;
+    _write_pos = 0;
+}
+
+void LPCConfigJournal::Poll()
+{
+    if (!Busy()) {
+        return;
+    }
+    uint16_t address = SlotAddress(_write_slot);
+    for (int n = 0; n < LPC_JOURNAL_BYTES_PER_POLL && _write_pos < _slot_bytes; n++, _write_pos++) {
+        // update() leaves bytes that already hold the value alone
+        EEPROM.update(address + _write_pos, _staged[_write_pos]);
+    }
+}
+
+uint16_t LPCConfigJournal::Crc(const void* data, size_t len, uint16_t crc)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    while (len--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
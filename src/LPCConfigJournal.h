@@ -0,0 +1,71 @@
+/*
+ *  LPCConfigJournal.h
+ *  Created: October 2026
+ *
+ *  Append-only, CRC protected journal of a configuration record in EEPROM.
+ *
+ *  The region is divided into slots of one record each. Each save goes in
+ *  the slot after the newest, round robin, so the writes are spread over
+ *  the whole region rather than wearing one place, and the previous record
+ *  stays intact until the new one is complete. Restore() reads the region
+ *  once, and keeps the valid record with the newest sequence number.
+ *
+ *  Save() only stages the record in RAM; Poll(), called on every loop
+ *  pass, writes it out a few bytes at a time so that no pass waits on the
+ *  EEPROM. A record cut short by a reset fails its CRC and is ignored.
+ *
+ *  Slot layout: u8 LPC_JOURNAL_MAGIC, u8 payload length, u16 sequence
+ *  number, the payload, then the CRC-16/CCITT of all of those (multi-byte
+ *  integers little-endian).
+ */
+
+#ifndef LPCCONFIGJOURNAL_H
+#define LPCCONFIGJOURNAL_H
+
+#include <Arduino.h>
+
+#define LPC_JOURNAL_MAGIC 0xC7
+/// Largest payload of a record
+#define LPC_JOURNAL_MAX_PAYLOAD 120
+/// Bytes written to the EEPROM per Poll()
+#define LPC_JOURNAL_BYTES_PER_POLL 8
+
+class LPCConfigJournal {
+public:
+    /// @brief A journal of payload_len byte records in the EEPROM bytes
+    /// [start, start + bytes)
+    LPCConfigJournal(uint16_t start, uint16_t bytes, uint8_t payload_len);
+
+    /// @brief Find the newest valid record, and continue the journal after it
+    /// @return true, with the record in payload, if there is one
+    bool Restore(void* payload);
+    /// @brief Stage a record for Poll() to write, replacing any that is
+    /// still being written
+    void Save(const void* payload);
+    /// @brief Write the next bytes of a staged record
+    void Poll();
+    /// @brief A staged record has not been completely written yet
+    bool Busy() const { return _write_pos < _slot_bytes; }
+    uint16_t Slots() const { return _slots; }
+    uint16_t Sequence() const { return _seq; }
+
+    /// @brief CRC-16/CCITT (polynomial 0x1021, initial 0xFFFF)
+    static uint16_t Crc(const void* data, size_t len, uint16_t crc = 0xFFFF);
+
+private:
+    uint16_t SlotAddress(uint16_t slot) const { return _start + slot * _slot_bytes; }
+
+    uint16_t _start;
+    uint16_t _slots;
+    uint8_t _payload_len;
+    uint16_t _slot_bytes;
+
+    uint16_t _next_slot = 0;    // Where the next record goes
+    uint16_t _seq = 0;          // Of the newest record
+
+    uint8_t _staged[4 + LPC_JOURNAL_MAX_PAYLOAD + 2];
+    uint16_t _write_slot = 0;
+    uint16_t _write_pos;        // Next byte of _staged to write
+};
+
+#endif /* LPCCONFIGJOURNAL_H */
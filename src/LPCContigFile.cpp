@@ -0,0 +1,135 @@
+/*
+ *  LPCContigFile.cpp
+ *  Created: October 2026
+ *
+ *  Contiguous, preallocated SD file with multi-sector writes.
+ *  See LPCContigFile.h.
+ */
+
+#include "LPCContigFile.h"
+#include "LPCMemory.h"
+
+LPCContigFile::LPCContigFile()
+    : _open(false),
+    _first_sector(0),
+    _sector(0),
+    _capacity(0),
+    _size(0),
+    _used(0),
+    _buf(nullptr)
+{
+}
+
+bool LPCContigFile::Create(const char* path, uint32_t max_bytes)
+{
+    if (_open) {
+        Close();
+    }
+    if (!max_bytes || !_buf) {
+        return false;
+    }
+
+    _file = SD.sdfs.open(path, O_RDWR | O_CREAT | O_TRUNC);
+    if (!_file) {
+        return false;
+    }
+
+    // preAllocate() finds contiguous clusters and syncs the FAT and
+    // directory entry, so the card is consistent before raw writes begin.
+    uint32_t first_sector;
+    uint32_t last_sector;
+    if (!_file.preAllocate(max_bytes) || !_file.contiguousRange(&first_sector, &last_sector)) {
+        _file.close();
+        SD.sdfs.remove(path);
+        return false;
+    }
+
+    // Stale card contents in the extent would look like data after a reset
+    SD.sdfs.card()->erase(first_sector, last_sector);
+
+    _first_sector = first_sector;
+    _sector = first_sector;
+    _capacity = (last_sector - first_sector + 1) * SD_SECTOR_SIZE;
+    _size = 0;
+    _used = 0;
+    _open = true;
+    return true;
+}
+
+size_t LPCContigFile::Write(const void* data, size_t len)
+{
+    if (!_open) {
+        return 0;
+    }
+    if (len > _capacity - _size) {
+        len = _capacity - _size;
+    }
+
+    const uint8_t* src = (const uint8_t*)data;
+    size_t remaining = len;
+    while (remaining) {
+        size_t n = SD_CONTIG_BUFFER_BYTES - _used;
+        if (n > remaining) {
+            n = remaining;
+        }
+        memcpy(_buf + _used, src, n);
+        _used += n;
+        _size += n;
+        src += n;
+        remaining -= n;
+
+        if (_used == SD_CONTIG_BUFFER_BYTES && !WriteBuffer()) {
+            return len - remaining;
+        }
+    }
+    return len;
+}
+
+bool LPCContigFile::WriteBuffer()
+{
+    if (!_used) {
+        return true;
+    }
+
+    uint16_t n_sectors = (_used + SD_SECTOR_SIZE - 1) / SD_SECTOR_SIZE;
+    uint16_t full_sectors = _used / SD_SECTOR_SIZE;
+    uint16_t tail = _used % SD_SECTOR_SIZE;
+    if (tail) {
+        memset(_buf + _used, 0, n_sectors * SD_SECTOR_SIZE - _used);
+    }
+
+    // The card may be read from the buffer by DMA
+    LPCDmaBeforeTransmit(_buf, n_sectors * SD_SECTOR_SIZE);
+    if (!SD.sdfs.card()->writeSectors(_sector, _buf, n_sectors)) {
+        return false;
+    }
+
+    // Retire the whole sectors; the partial one stays in RAM, so appending
+    // to it never needs a read-modify-write of the card sector.
+    if (full_sectors) {
+        memmove(_buf, _buf + full_sectors * SD_SECTOR_SIZE, tail);
+        _sector += full_sectors;
+        _used = tail;
+    }
+    return true;
+}
+
+bool LPCContigFile::Sync()
+{
+    return _open ? WriteBuffer() : true;
+}
+
+bool LPCContigFile::Close()
+{
+    if (!_open) {
+        return true;
+    }
+    bool ok = WriteBuffer();
+
+    // The only FAT/directory update since Create(): shrink the file from the
+    // preallocated size to what was written, freeing the remaining clusters.
+    ok = _file.seekSet(_size) && _file.truncate() && ok;
+    ok = _file.close() && ok;
+    _open = false;
+    return ok;
+}
@@ -0,0 +1,70 @@
+/*
+ *  LPCContigFile.h
+ *  Created: October 2026
+ *
+ *  A write-only SD file backed by a preallocated contiguous extent.
+ *
+ *  The extent is reserved (and erased) when the file is created. Appended
+ *  data is collected in a sector aligned RAM buffer and written to the card
+ *  as multi-sector blocks straight to the extent, bypassing the file system.
+ *  The FAT and directory entry are only touched at Create() and Close(),
+ *  where the file is truncated to the bytes actually written.
+ *
+ *  If the instrument resets before Close(), the file keeps its preallocated
+ *  size: the data up to the last Sync() is followed by erased (0x00 or 0xFF)
+ *  sectors.
+ *
+ *  The sector buffer belongs to the owner (see SetBuffer()), so that it can
+ *  be placed in OCRAM with the other bulk buffers (see LPCMemory.h).
+ */
+
+#ifndef LPCCONTIGFILE_H
+#define LPCCONTIGFILE_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+/// Sectors buffered before a multi-sector write to the card
+#define SD_CONTIG_BUFFER_SECTORS 4
+#define SD_SECTOR_SIZE 512
+#define SD_CONTIG_BUFFER_BYTES (SD_CONTIG_BUFFER_SECTORS * SD_SECTOR_SIZE)
+
+class LPCContigFile {
+public:
+    LPCContigFile();
+
+    /// @brief Set the sector buffer, SD_CONTIG_BUFFER_BYTES aligned to a
+    /// cache line. Must be called before Create().
+    void SetBuffer(uint8_t* buf) { _buf = buf; }
+    /// @brief Create (or replace) a file with a contiguous extent of max_bytes
+    /// @return false if the extent could not be allocated
+    bool Create(const char* path, uint32_t max_bytes);
+    /// @brief Append to the file
+    /// @return The number of bytes accepted; short if the extent is full
+    size_t Write(const void* data, size_t len);
+    /// @brief Put all buffered bytes on the card, without updating the FAT
+    bool Sync();
+    /// @brief Sync, then set the file size and release the unused extent
+    bool Close();
+
+    bool IsOpen() const { return _open; }
+    uint32_t Size() const { return _size; }
+    uint32_t Capacity() const { return _capacity; }
+
+private:
+    /// @brief Write the buffered sectors to the card.
+    /// Whole sectors are retired from the buffer; a trailing partial sector
+    /// is written (zero padded) but kept, to be rewritten when it fills.
+    bool WriteBuffer();
+
+    FsFile _file;
+    bool _open;
+    uint32_t _first_sector;   // First sector of the extent
+    uint32_t _sector;         // Sector that _buf[0] maps to
+    uint32_t _capacity;       // Extent size in bytes
+    uint32_t _size;           // Bytes appended
+    uint16_t _used;           // Bytes in _buf
+    uint8_t* _buf;            // SD_CONTIG_BUFFER_BYTES
+};
+
+#endif /* LPCCONTIGFILE_H */
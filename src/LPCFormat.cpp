@@ -0,0 +1,119 @@
+/*
+ *  LPCFormat.cpp
+ *  Created: October 2026
+ *
+ *  Allocation-free number formatting. See LPCFormat.h.
+ */
+
+#include "LPCFormat.h"
+
+#include <string.h>
+
+static const uint32_t POW10[LPC_FORMAT_MAX_DECIMALS + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+/// @brief Write exactly width digits of value, with leading zeros
+static char* digits(char* out, uint32_t value, int width)
+{
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = '0' + value % 10;
+        value /= 10;
+    }
+    return out + width;
+}
+
+char* LPCFormatUInt(char* out, uint32_t value)
+{
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) {
+        *out++ = tmp[--n];
+    }
+    return out;
+}
+
+char* LPCFormatInt(char* out, int32_t value)
+{
+    if (value < 0) {
+        *out++ = '-';
+        return LPCFormatUInt(out, 0u - (uint32_t)value);
+    }
+    return LPCFormatUInt(out, (uint32_t)value);
+}
+
+char* LPCFormatFixed(char* out, float value, uint8_t decimals)
+{
+    if (decimals > LPC_FORMAT_MAX_DECIMALS) {
+        decimals = LPC_FORMAT_MAX_DECIMALS;
+    }
+
+    // value = mantissa * 2^exponent
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative = bits >> 31;
+    int biased = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (biased == 0xFF) {
+        if (mantissa) {
+            return LPCFormatText(out, "nan");
+        }
+        return LPCFormatText(out, negative ? "-inf" : "inf");
+    }
+    if (biased) {
+        mantissa |= 0x800000;
+    } else {
+        biased = 1;  // subnormal
+    }
+    int exponent = biased - 150;
+    if (exponent > 8) {
+        // 2^32 or more
+        return LPCFormatText(out, "ovf");
+    }
+
+    // Split into the whole part and the fraction, rounded half up to the
+    // last decimal
+    uint32_t whole;
+    uint32_t frac = 0;
+    if (exponent >= 0) {
+        uint64_t v = (uint64_t)mantissa << exponent;
+        if (v >> 32) {
+            return LPCFormatText(out, "ovf");
+        }
+        whole = (uint32_t)v;
+    } else {
+        int shift = -exponent;
+        whole = shift < 32 ? mantissa >> shift : 0;
+        if (shift < 64) {
+            uint64_t frac_bits = mantissa & ((1ULL << (shift < 32 ? shift : 32)) - 1);
+            frac = (uint32_t)((frac_bits * POW10[decimals] + (1ULL << (shift - 1))) >> shift);
+        }
+        if (frac == POW10[decimals]) {
+            frac = 0;
+            if (whole == UINT32_MAX) {
+                return LPCFormatText(out, "ovf");
+            }
+            whole++;
+        }
+    }
+
+    if (negative) {
+        *out++ = '-';
+    }
+    out = LPCFormatUInt(out, whole);
+    if (decimals) {
+        *out++ = '.';
+        out = digits(out, frac, decimals);
+    }
+    return out;
+}
+
+char* LPCFormatText(char* out, const char* text)
+{
+    while (*text) {
+        *out++ = *text++;
+    }
+    return out;
+}
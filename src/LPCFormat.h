@@ -0,0 +1,41 @@
+/*
+ *  LPCFormat.h
+ *  Created: October 2026
+ *
+ *  Allocation-free number formatting for the CSV and XML text written to
+ *  the SD card and the TM state messages.
+ *
+ *  String(float) and String concatenation cost a heap allocation and a
+ *  dtostrf() per field. These write the decimal text straight into the
+ *  caller's buffer, using integer arithmetic only, and return the end of
+ *  what they wrote (the text is not terminated). The output is the same
+ *  as String(value) for integers, and String(value, decimals) for floats,
+ *  with exact ties rounded away from zero.
+ *
+ *  This file has no Arduino dependencies, and is also built by the host
+ *  tools in tools/ (see lpc_fmtbench).
+ */
+
+#ifndef LPCFORMAT_H
+#define LPCFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Longest text of LPCFormatInt() / LPCFormatUInt()
+#define LPC_FORMAT_INT_MAX 11
+/// Longest text of LPCFormatFixed()
+#define LPC_FORMAT_FIXED_MAX 20
+/// Most decimals LPCFormatFixed() supports
+#define LPC_FORMAT_MAX_DECIMALS 6
+
+char* LPCFormatUInt(char* out, uint32_t value);
+char* LPCFormatInt(char* out, int32_t value);
+/// @brief Fixed point decimal with the given number of decimals, rounded
+/// half away from zero. NaN and infinity give "nan" and "inf", and
+/// magnitudes of 2^32 or more "ovf".
+char* LPCFormatFixed(char* out, float value, uint8_t decimals = 2);
+/// @brief Copy a terminated string, without its terminator
+char* LPCFormatText(char* out, const char* text);
+
+#endif /* LPCFORMAT_H */
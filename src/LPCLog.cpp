@@ -0,0 +1,100 @@
+/*
+ *  LPCLog.cpp
+ *  Created: October 2026
+ *
+ *  Deferred binary logging. See LPCLog.h.
+ */
+
+#include "LPCLog.h"
+#include "StratoCore.h"
+
+LPCRing<uint8_t, LPC_LOG_RING_SIZE> LPCLog::_ring;
+uint32_t LPCLog::_dropped = 0;
+uint32_t LPCLog::_dropped_total = 0;
+
+void LPCLog::Put(LPCLogId id, const uint32_t* args, uint8_t nargs)
+{
+    if (_dropped) {
+        // report the gap first, if there is now room for it
+        uint32_t count = _dropped;
+        if (_ring.Free() < LPC_LOG_HEADER_BYTES + 4 + LPC_LOG_HEADER_BYTES + 4 * nargs
+            || !PutRecord(LOG_DROPPED, &count, 1)) {
+            _dropped++;
+            _dropped_total++;
+            return;
+        }
+        _dropped = 0;
+    }
+    if (!PutRecord(id, args, nargs)) {
+        _dropped++;
+        _dropped_total++;
+    }
+}
+
+FASTRUN bool LPCLog::PutRecord(LPCLogId id, const uint32_t* args, uint8_t nargs)
+{
+    if (_ring.Free() < LPC_LOG_HEADER_BYTES + 4 * nargs) {
+        return false;
+    }
+
+    uint32_t ms = millis();
+    _ring.Push(LPC_LOG_SYNC);
+    _ring.Push(id);
+    _ring.Push(nargs);
+    for (int b = 0; b < 4; b++) {
+        _ring.Push((uint8_t)(ms >> (8 * b)));
+    }
+    for (uint8_t i = 0; i < nargs; i++) {
+        for (int b = 0; b < 4; b++) {
+            _ring.Push((uint8_t)(args[i] >> (8 * b)));
+        }
+    }
+    return true;
+}
+
+void LPCLog::Drain()
+{
+#if LPC_LOG_BINARY
+    // Whole records only, so that StratoCore's text log on the same port
+    // never lands inside one
+    uint8_t record[LPC_LOG_MAX_RECORD];
+    while (!_ring.Empty()) {
+        uint16_t len = LPC_LOG_HEADER_BYTES + 4 * _ring.Peek(2);
+        if (LPC_LOG_PORT.availableForWrite() < len) {
+            return;
+        }
+        for (uint16_t i = 0; i < len; i++) {
+            _ring.Pop(record[i]);
+        }
+        LPC_LOG_PORT.write(record, len);
+    }
+#else
+    for (int n = 0; n < LPC_LOG_TEXT_PER_DRAIN && !_ring.Empty(); n++) {
+        uint8_t header[LPC_LOG_HEADER_BYTES];
+        for (int i = 0; i < LPC_LOG_HEADER_BYTES; i++) {
+            _ring.Pop(header[i]);
+        }
+        uint8_t nargs = header[2];
+        uint32_t args[LPC_LOG_MAX_ARGS];
+        for (uint8_t a = 0; a < nargs; a++) {
+            args[a] = 0;
+            for (int b = 0; b < 4; b++) {
+                uint8_t byte;
+                _ring.Pop(byte);
+                args[a] |= (uint32_t)byte << (8 * b);
+            }
+        }
+
+        char text[128];
+        LPCLogExpand(text, sizeof(text), header[1], args, nargs);
+        uint8_t level = header[1] < LPC_LOG_NUM_IDS ? LPCLogLevel((LPCLogId)header[1]) : LPC_LOG_ERROR;
+        if (level == LPC_LOG_DEBUG) {
+            log_debug(text);
+        } else if (level == LPC_LOG_NOMINAL) {
+            log_nominal(text);
+        } else {
+            log_error(text);
+        }
+    }
+#endif
+}
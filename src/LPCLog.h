@@ -0,0 +1,87 @@
+/*
+ *  LPCLog.h
+ *  Created: October 2026
+ *
+ *  Deferred binary logging for the per-frame and per-loop messages.
+ *
+ *  LPC_LOG(id, args...) records the message id, the time and up to
+ *  LPC_LOG_MAX_ARGS numeric arguments into a RAM ring, which takes a few
+ *  hundred nanoseconds and never waits for the debug port. Drain() sends
+ *  whole records to the port when it has room, from the end of each loop
+ *  pass. The text is only produced on the ground, by tools/lpc_logdump,
+ *  from the table in LPCLogFormats.h. If the ring fills, records are
+ *  dropped and counted rather than delaying the measurement.
+ *
+ *  Messages below LPC_LOG_LEVEL are compiled out, arguments included.
+ *
+ *  When the debug port is shared with Zephyr (LOG_ZEPHYR_COMMS_SHARED),
+ *  binary records would disturb the OBC simulator, so Drain() expands them
+ *  to text on the instrument and writes them through the StratoCore log.
+ */
+
+#ifndef LPCLOG_H
+#define LPCLOG_H
+
+#include <Arduino.h>
+#include "LPCLogTable.h"
+#include "LPCRing.h"
+
+/// Messages below this level are compiled out
+#ifndef LPC_LOG_LEVEL
+#define LPC_LOG_LEVEL LPC_LOG_NOMINAL
+#endif
+/// Ring size in bytes (a power of two)
+#define LPC_LOG_RING_SIZE 4096
+/// Records expanded per Drain() call when logging as text
+#define LPC_LOG_TEXT_PER_DRAIN 4
+#define LPC_LOG_PORT Serial
+
+#ifndef LOG_ZEPHYR_COMMS_SHARED
+#define LPC_LOG_BINARY true
+#else
+#define LPC_LOG_BINARY false
+#endif
+
+#define LPC_LOG(id, ...) \
+    do { \
+        if (LPCLogLevel(id) >= LPC_LOG_LEVEL) { \
+            LPCLog::Write(id, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+class LPCLog {
+public:
+    template <typename... Args>
+    static void Write(LPCLogId id, Args... args)
+    {
+        static_assert(sizeof...(Args) <= LPC_LOG_MAX_ARGS, "Too many log arguments");
+        const uint32_t words[sizeof...(Args) + 1] = {Pack(args)..., 0};
+        Put(id, words, sizeof...(Args));
+    }
+
+    /// @brief Send queued records to the debug port, as far as it has room
+    static void Drain();
+
+    /// @brief Records dropped because the ring was full, since boot
+    static uint32_t Dropped() { return _dropped_total; }
+
+private:
+    static uint32_t Pack(float value)
+    {
+        uint32_t word;
+        memcpy(&word, &value, sizeof(word));
+        return word;
+    }
+    static uint32_t Pack(double value) { return Pack((float)value); }
+    template <typename T> static uint32_t Pack(T value) { return (uint32_t)(int32_t)value; }
+    static uint32_t Pack(const char* value) = delete;
+
+    static void Put(LPCLogId id, const uint32_t* args, uint8_t nargs);
+    static bool PutRecord(LPCLogId id, const uint32_t* args, uint8_t nargs);
+
+    static LPCRing<uint8_t, LPC_LOG_RING_SIZE> _ring;
+    static uint32_t _dropped;        // Not yet reported with LOG_DROPPED
+    static uint32_t _dropped_total;
+};
+
+#endif /* LPCLOG_H */
@@ -0,0 +1,42 @@
+/*
+ *  LPCLogFormats.h
+ *  Created: October 2026
+ *
+ *  The deferred log message table: LPC_LOG_FORMAT(id, level, format).
+ *  Included several times by LPCLogTable.h, with LPC_LOG_FORMAT defined
+ *  differently each time, so it has no include guard.
+ *
+ *  The host expander (tools/lpc_logdump) is built from the same table, so
+ *  an entry's position is its wire id: add new entries at the end, and
+ *  rebuild the tool with the firmware.
+ *
+ *  Formats may use the conversions d, i, u, x, X, c (passed as 32 bit
+ *  integers) and f, e, g (passed as float), with flags, width and
+ *  precision, but no length modifiers. There are at most
+ *  LPC_LOG_MAX_ARGS arguments.
+ */
+
+LPC_LOG_FORMAT(LOG_DROPPED,             LPC_LOG_ERROR,   "Log ring full, %u records dropped")
+LPC_LOG_FORMAT(LOG_FL_WAIT_GPS,         LPC_LOG_DEBUG,   "FL Wait for GPS Time")
+LPC_LOG_FORMAT(LOG_FL_START_TIME,       LPC_LOG_NOMINAL, "StartTimeSeconds Updated to: %u")
+LPC_LOG_FORMAT(LOG_LPC_SHUTDOWN,        LPC_LOG_NOMINAL, "Shutting down LPC")
+LPC_LOG_FORMAT(LOG_FL_IDLE,             LPC_LOG_DEBUG,   "FL Idle")
+LPC_LOG_FORMAT(LOG_FL_WARMUP,           LPC_LOG_DEBUG,   "FL Warmup")
+LPC_LOG_FORMAT(LOG_FL_FLUSH,            LPC_LOG_DEBUG,   "FL Flush")
+LPC_LOG_FORMAT(LOG_PHA_TIMEOUT,         LPC_LOG_ERROR,   "PHA Read Timeout")
+LPC_LOG_FORMAT(LOG_PHA_BYTES,           LPC_LOG_DEBUG,   "Received PHA Bytes: %d")
+LPC_LOG_FORMAT(LOG_PHA_PULSES,          LPC_LOG_DEBUG,   "Pulse Count: %d")
+LPC_LOG_FORMAT(LOG_HK_COLLECT,          LPC_LOG_DEBUG,   "collecting HK")
+LPC_LOG_FORMAT(LOG_HK_FLOW,             LPC_LOG_DEBUG,   "Flow: %.2f")
+LPC_LOG_FORMAT(LOG_HK_TEMPS,            LPC_LOG_DEBUG,   "Pump1 T: %.2f Pump2 T: %.2f Inlet T: %.2f")
+LPC_LOG_FORMAT(LOG_FL_MEASURE,          LPC_LOG_DEBUG,   "FL Measure")
+LPC_LOG_FORMAT(LOG_FL_LAST_MEASUREMENT, LPC_LOG_NOMINAL, "Last Measurement at: %u")
+LPC_LOG_FORMAT(LOG_FL_ERROR,            LPC_LOG_DEBUG,   "In Error Sub State")
+LPC_LOG_FORMAT(LOG_LPC_TM_SENT,         LPC_LOG_NOMINAL, "Sending Records: %d Bytes: %d")
+LPC_LOG_FORMAT(LOG_RS41_TM_SENT,        LPC_LOG_NOMINAL, "Sending RS41 samples: %d Bytes: %d")
+LPC_LOG_FORMAT(LOG_SB_LOOP,             LPC_LOG_DEBUG,   "SB loop")
+LPC_LOG_FORMAT(LOG_SA_WAIT_ACK,         LPC_LOG_DEBUG,   "Waiting on safety ack")
+LPC_LOG_FORMAT(LOG_SA_LOOP,             LPC_LOG_DEBUG,   "SA loop")
+LPC_LOG_FORMAT(LOG_LP_LOOP,             LPC_LOG_DEBUG,   "LP loop")
+LPC_LOG_FORMAT(LOG_EF_LOOP,             LPC_LOG_DEBUG,   "EF loop")
+LPC_LOG_FORMAT(LOG_RS41_AGG_SENT,        LPC_LOG_NOMINAL, "Sending RS41 windows: %d Bytes: %d")
@@ -0,0 +1,102 @@
+/*
+ *  LPCLogTable.cpp
+ *  Created: October 2026
+ *
+ *  Message table and text expansion for the deferred binary log.
+ *  See LPCLogTable.h.
+ */
+
+#include "LPCLogTable.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char* const formats[] = {
+#define LPC_LOG_FORMAT(id, level, format) format,
+#include "LPCLogFormats.h"
+#undef LPC_LOG_FORMAT
+};
+
+const char* LPCLogFormat(uint8_t id)
+{
+    return id < LPC_LOG_NUM_IDS ? formats[id] : nullptr;
+}
+
+char LPCLogLevelName(uint8_t level)
+{
+    switch (level) {
+    case LPC_LOG_DEBUG:
+        return 'D';
+    case LPC_LOG_NOMINAL:
+        return 'N';
+    default:
+        return 'E';
+    }
+}
+
+size_t LPCLogExpand(char* out, size_t size, uint8_t id, const uint32_t* args, uint8_t nargs)
+{
+    const char* f = LPCLogFormat(id);
+    if (!f) {
+        return snprintf(out, size, "<unknown log id %u>", id);
+    }
+
+    size_t n = 0;
+    uint8_t arg = 0;
+    char spec[16];
+    while (*f && n + 1 < size) {
+        if (*f != '%') {
+            out[n++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[n++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // copy one conversion: flags, width and precision, then the type
+        size_t len = strspn(f + 1, "-+ #0123456789.") + 2;
+        if (len >= sizeof(spec) || !f[len - 1]) {
+            break;
+        }
+        memcpy(spec, f, len);
+        spec[len] = '\0';
+        f += len;
+
+        uint32_t value = arg < nargs ? args[arg] : 0;
+        arg++;
+        int written;
+        switch (spec[len - 1]) {
+        case 'f':
+        case 'e':
+        case 'g': {
+            float real;
+            memcpy(&real, &value, sizeof(real));
+            written = snprintf(out + n, size - n, spec, (double)real);
+            break;
+        }
+        case 'd':
+        case 'i':
+        case 'c':
+            written = snprintf(out + n, size - n, spec, (int)(int32_t)value);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            written = snprintf(out + n, size - n, spec, (unsigned)value);
+            break;
+        default:
+            // not a conversion the log supports (e.g. %s)
+            written = snprintf(out + n, size - n, "?");
+            break;
+        }
+        if (written < 0) {
+            break;
+        }
+        n += (size_t)written < size - n ? (size_t)written : size - n - 1;
+    }
+    out[n] = '\0';
+    return n;
+}
@@ -0,0 +1,58 @@
+/*
+ *  LPCLogTable.h
+ *  Created: October 2026
+ *
+ *  Message ids, levels and text expansion for the deferred binary log
+ *  (see LPCLog.h). This part has no Arduino dependencies, so that the host
+ *  expander tools/lpc_logdump is built from it as well.
+ *
+ *  A log record on the wire is, little-endian:
+ *    u8 LPC_LOG_SYNC, u8 id, u8 nargs, u32 millis, nargs x u32 argument
+ *  Integer arguments are sent as int32, floating point ones as float bits.
+ */
+
+#ifndef LPCLOGTABLE_H
+#define LPCLOGTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LPC_LOG_DEBUG   0
+#define LPC_LOG_NOMINAL 1
+#define LPC_LOG_ERROR   2
+#define LPC_LOG_NONE    3
+
+/// Marks the start of a record. Not ASCII, so the text log on the same
+/// port can be told apart.
+#define LPC_LOG_SYNC 0xA5
+#define LPC_LOG_HEADER_BYTES 7
+#define LPC_LOG_MAX_ARGS 4
+#define LPC_LOG_MAX_RECORD (LPC_LOG_HEADER_BYTES + 4 * LPC_LOG_MAX_ARGS)
+
+enum LPCLogId : uint8_t {
+#define LPC_LOG_FORMAT(id, level, format) id,
+#include "LPCLogFormats.h"
+#undef LPC_LOG_FORMAT
+    LPC_LOG_NUM_IDS
+};
+
+constexpr uint8_t LPC_LOG_LEVELS[] = {
+#define LPC_LOG_FORMAT(id, level, format) level,
+#include "LPCLogFormats.h"
+#undef LPC_LOG_FORMAT
+};
+
+/// @brief Level of a message id, at compile time
+constexpr uint8_t LPCLogLevel(LPCLogId id) { return LPC_LOG_LEVELS[id]; }
+
+/// @brief Format string of a message id, or nullptr if unknown
+const char* LPCLogFormat(uint8_t id);
+
+/// @brief One letter name of a level: D, N or E
+char LPCLogLevelName(uint8_t level);
+
+/// @brief Expand a record's arguments into its text, like snprintf()
+/// @return The length of the text (truncated to size - 1)
+size_t LPCLogExpand(char* out, size_t size, uint8_t id, const uint32_t* args, uint8_t nargs);
+
+#endif /* LPCLOGTABLE_H */
@@ -0,0 +1,159 @@
+/*
+ *  LPCMemStats.cpp
+ *  Created: October 2026
+ *
+ *  Stack and heap high-water instrumentation. See LPCMemStats.h.
+ */
+
+#include "LPCMemStats.h"
+#include <malloc.h>
+
+// Teensy 4 linker script and startup symbols
+extern unsigned long _ebss;
+extern unsigned long _estack;
+extern unsigned long _heap_end;
+extern "C" char* __brkval;
+
+#define STACK_PAINT 0xA5A5A5A5UL
+
+uint32_t LPCMemStats::_heap_peak = 0;
+uint32_t LPCMemStats::_last_sample_ms = 0;
+
+#if LPC_HEAP_COUNTERS
+static volatile uint32_t heap_allocs = 0;
+static volatile uint32_t heap_frees = 0;
+static volatile uint32_t heap_failures = 0;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size)
+{
+    void* ptr = __real_malloc(size);
+    if (ptr) {
+        heap_allocs++;
+    } else {
+        heap_failures++;
+    }
+    return ptr;
+}
+
+void* __wrap_calloc(size_t n, size_t size)
+{
+    void* ptr = __real_calloc(n, size);
+    if (ptr) {
+        heap_allocs++;
+    } else {
+        heap_failures++;
+    }
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    void* moved = __real_realloc(ptr, size);
+    if (!moved && size) {
+        heap_failures++;
+    } else if (!ptr) {
+        heap_allocs++;
+    } else if (!size) {
+        heap_frees++;
+    }
+    return moved;
+}
+
+void __wrap_free(void* ptr)
+{
+    if (ptr) {
+        heap_frees++;
+    }
+    __real_free(ptr);
+}
+}
+
+// The probe in LargestFreeBlock() is not counted
+#define PROBE_MALLOC __real_malloc
+#define PROBE_FREE __real_free
+#else
+#define PROBE_MALLOC malloc
+#define PROBE_FREE free
+#endif
+
+void LPCMemStats::PaintStack()
+{
+    uint32_t marker;
+    uint32_t* p = (uint32_t*)&_ebss;
+    uint32_t* end = (uint32_t*)((uintptr_t)&marker - LPC_STACK_PAINT_GUARD);
+    while (p < end) {
+        *p++ = STACK_PAINT;
+    }
+}
+
+uint32_t LPCMemStats::StackUsed()
+{
+    const uint32_t* p = (const uint32_t*)&_ebss;
+    const uint32_t* top = (const uint32_t*)&_estack;
+    while (p < top && *p == STACK_PAINT) {
+        p++;
+    }
+    return (uint32_t)((uintptr_t)top - (uintptr_t)p);
+}
+
+void LPCMemStats::Sample()
+{
+    if (millis() - _last_sample_ms < LPC_HEAP_SAMPLE_MS) {
+        return;
+    }
+    _last_sample_ms = millis();
+
+    struct mallinfo info = mallinfo();
+    if ((uint32_t)info.uordblks > _heap_peak) {
+        _heap_peak = info.uordblks;
+    }
+}
+
+void LPCMemStats::Report(LPCMemReport& report)
+{
+    _last_sample_ms = millis() - LPC_HEAP_SAMPLE_MS;
+    Sample();
+
+    struct mallinfo info = mallinfo();
+    uint32_t unclaimed = (uint32_t)((uintptr_t)&_heap_end - (uintptr_t)__brkval);
+
+    report.stack_used = StackUsed();
+    report.stack_size = (uint32_t)((uintptr_t)&_estack - (uintptr_t)&_ebss);
+    report.heap_in_use = info.uordblks;
+    report.heap_peak = _heap_peak;
+    report.heap_free = info.fordblks + unclaimed;
+    report.heap_largest = LargestFreeBlock(report.heap_free);
+#if LPC_HEAP_COUNTERS
+    report.allocs = heap_allocs;
+    report.frees = heap_frees;
+    report.alloc_failures = heap_failures;
+#else
+    report.allocs = 0;
+    report.frees = 0;
+    report.alloc_failures = 0;
+#endif
+}
+
+uint32_t LPCMemStats::LargestFreeBlock(uint32_t limit)
+{
+    // Binary search on the largest malloc() that succeeds, to 64 bytes
+    uint32_t low = 0;
+    uint32_t high = limit;
+    while (high - low > 64) {
+        uint32_t mid = low + (high - low) / 2;
+        void* ptr = PROBE_MALLOC(mid);
+        if (ptr) {
+            PROBE_FREE(ptr);
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
@@ -0,0 +1,68 @@
+/*
+ *  LPCMemStats.h
+ *  Created: October 2026
+ *
+ *  Stack and heap high-water instrumentation for the Teensy 4.1.
+ *
+ *  The stack grows down through DTCM from _estack towards the end of .bss.
+ *  PaintStack() fills the unused part with a pattern at boot, and
+ *  StackUsed() finds the deepest word that has been overwritten since.
+ *
+ *  The heap (Arduino String, new) is in OCRAM, between _heap_start and
+ *  _heap_end. In-use and free bytes come from mallinfo(); the peak in-use
+ *  figure is sampled by Sample(). The largest block that can still be
+ *  allocated is found by probing, which shows fragmentation that the free
+ *  total hides.
+ *
+ *  With LPC_HEAP_COUNTERS set, and the build linking with
+ *  -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free (see
+ *  platformio.ini), allocation, free and failure counts are also kept.
+ */
+
+#ifndef LPCMEMSTATS_H
+#define LPCMEMSTATS_H
+
+#include <Arduino.h>
+
+#ifndef LPC_HEAP_COUNTERS
+#define LPC_HEAP_COUNTERS 0
+#endif
+
+/// Stack bytes below the current frame left unpainted by PaintStack()
+#define LPC_STACK_PAINT_GUARD 256
+/// Minimum interval between heap samples by Sample()
+#define LPC_HEAP_SAMPLE_MS 1000
+
+/// @brief A snapshot of the memory statistics
+struct LPCMemReport {
+    uint32_t stack_used;      // Deepest stack use since boot, bytes
+    uint32_t stack_size;      // DTCM available to the stack
+    uint32_t heap_in_use;     // Bytes allocated
+    uint32_t heap_peak;       // Highest sampled heap_in_use
+    uint32_t heap_free;       // Free bytes in the malloc arena and above it
+    uint32_t heap_largest;    // Largest block that can be allocated
+    uint32_t allocs;          // Allocations (0 without LPC_HEAP_COUNTERS)
+    uint32_t frees;
+    uint32_t alloc_failures;
+};
+
+class LPCMemStats {
+public:
+    /// @brief Paint the unused stack; call first thing in setup()
+    static void PaintStack();
+    /// @brief Deepest stack use since PaintStack(), bytes
+    static uint32_t StackUsed();
+    /// @brief Update the heap peak, at most every LPC_HEAP_SAMPLE_MS
+    static void Sample();
+    /// @brief Fill in all the statistics. This probes the heap, so it
+    /// should not be called from an interrupt or on every loop pass.
+    static void Report(LPCMemReport& report);
+
+private:
+    static uint32_t LargestFreeBlock(uint32_t limit);
+
+    static uint32_t _heap_peak;
+    static uint32_t _last_sample_ms;
+};
+
+#endif /* LPCMEMSTATS_H */
@@ -0,0 +1,54 @@
+/*
+ *  LPCMemory.h
+ *  Created: October 2026
+ *
+ *  Memory placement policy for the Teensy 4.1 (i.MX RT1062).
+ *
+ *  RAM1 (512 KB) is split, in 32 KB banks, between ITCM (code) and DTCM
+ *  (globals, statics and the stack); both run at the CPU clock with no
+ *  cache. RAM2/OCRAM (512 KB) is on the AXI bus behind the 32 KB data
+ *  cache, and holds DMAMEM variables and the heap. Every ITCM bank taken
+ *  by code is a bank less for data and stack.
+ *
+ *   - Code runs from ITCM by default. The per-frame and interrupt paths
+ *     (parsePHA, fillBins, the Zephyr RX interrupt and drain, the action
+ *     scheduler) are marked FASTRUN so they stay there if the default
+ *     changes. Setup, telecommand and benchmark code that runs rarely is
+ *     marked FLASHMEM, to run from flash through the cache and free ITCM.
+ *   - Data touched every frame or by interrupts stays in DTCM: the
+ *     measurement arena, the Zephyr RX ring and the scheduler heap.
+ *   - Bulk buffers that are only streamed through go in OCRAM with
+ *     DMAMEM: the serial port buffers, the SD sector buffers and the
+ *     compression frame. DMAMEM is not zeroed at startup.
+ *
+ *  The serial buffers are only touched by the CPU (the LPUART interrupt
+ *  and the main loop), so the cache keeps them coherent. A buffer that a
+ *  DMA engine reads or writes must be aligned to LPC_CACHE_LINE, padded to
+ *  a whole number of lines, and go through LPCDmaBeforeTransmit() /
+ *  LPCDmaAfterReceive() around the transfer.
+ *
+ *  memory_map.py, run by PlatformIO after each build, reports the usage and
+ *  headroom of each region.
+ */
+
+#ifndef LPCMEMORY_H
+#define LPCMEMORY_H
+
+#include <Arduino.h>
+
+/// Cortex-M7 data cache line size
+#define LPC_CACHE_LINE 32
+
+/// @brief Write any cached data in buf back to OCRAM before a DMA engine reads it
+static inline void LPCDmaBeforeTransmit(const void* buf, size_t len)
+{
+    arm_dcache_flush((void*)buf, len);
+}
+
+/// @brief Discard cached copies of buf after a DMA engine has written it
+static inline void LPCDmaAfterReceive(void* buf, size_t len)
+{
+    arm_dcache_delete(buf, len);
+}
+
+#endif /* LPCMEMORY_H */
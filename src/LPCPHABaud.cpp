@@ -0,0 +1,160 @@
+/*
+ *  LPCPHABaud.cpp
+ *  Created: October 2026
+ *
+ *  PHA link rate negotiation. See LPCPHABaud.h.
+ */
+
+#include "LPCPHABaud.h"
+
+static const uint32_t RATES[] = PHA_BAUD_RATES;
+
+LPCPHABaud::LPCPHABaud(HardwareSerial& port, LPCPHACommand& commands)
+    : _port(port),
+    _commands(commands)
+{
+}
+
+void LPCPHABaud::Start()
+{
+    _rate = PHA_BAUD_BASE;
+    _good = PHA_BAUD_BASE;
+    _failed = 0;
+    _state = BAUD_IDLE;
+    if (!PHA_BAUD_NEGOTIATE || _unsupported) {
+        return;
+    }
+    // straight to the rate that worked before, if there is one
+    uint32_t rate = _best > PHA_BAUD_BASE ? _best : NextRate();
+    if (rate) {
+        Request(rate);
+    }
+}
+
+uint32_t LPCPHABaud::NextRate() const
+{
+    for (uint32_t rate : RATES) {
+        if (rate > _good && rate < _ceiling) {
+            return rate;
+        }
+    }
+    return 0;
+}
+
+void LPCPHABaud::Request(uint32_t rate)
+{
+    _target = rate;
+    _queued = false;
+    _state = BAUD_REQUEST;
+}
+
+bool LPCPHABaud::Poll()
+{
+    switch (_state) {
+    case BAUD_REQUEST:
+        if (!_queued) {
+            // wait for the queue to empty
+            if (_commands.Commands()) {
+                return false;
+            }
+            _commands.Queue("baud", _target);
+            _queued = true;
+            return false;
+        }
+        if (!_commands.Finished()) {
+            return false;
+        }
+        // Without replies the new rate can only be checked by the frames
+        if ((_commands.Command(0).status == PHA_CMD_CONFIRMED)
+            || (_commands.Command(0).status == PHA_CMD_UNCONFIRMED)) {
+            _commands.Clear();
+            _port.begin(_target);
+            _rate = _target;
+            _verify_ms = millis();
+            _verify_frames = _commands.Frames();
+            _state = BAUD_VERIFY;
+            return false;
+        }
+        _commands.Clear();
+        // as in Abort(), the PHA may have switched without its reply
+        // being seen
+        _rate = _target;
+        Revert();
+        if (_good == PHA_BAUD_BASE && _best == PHA_BAUD_BASE) {
+            _unsupported = true;
+        } else {
+            _failed = _target;
+            _ceiling = _target;
+        }
+        _state = BAUD_IDLE;
+        return true;
+
+    case BAUD_VERIFY:
+        if (_commands.Frames() != _verify_frames) {
+            _good = _rate;
+            if (_good > _best) {
+                _best = _good;
+            }
+            uint32_t rate = NextRate();
+            if (rate) {
+                Request(rate);
+                return false;
+            }
+            _state = BAUD_IDLE;
+            return true;
+        }
+        if (millis() - _verify_ms >= PHA_BAUD_VERIFY_MS) {
+            if (_good == PHA_BAUD_BASE && _best == PHA_BAUD_BASE) {
+                // as for a #baud that fails, don't try again
+                _unsupported = true;
+            } else {
+                _failed = _rate;
+                _ceiling = _rate;
+                if (_best >= _ceiling) {
+                    _best = _good;
+                }
+            }
+            Revert();
+            _state = BAUD_IDLE;
+            return true;
+        }
+        return false;
+
+    default:
+        return false;
+    }
+}
+
+bool LPCPHABaud::Abort()
+{
+    if (!Busy()) {
+        return false;
+    }
+    // a #baud already sent may have been taken without its reply being seen
+    if (_state == BAUD_VERIFY || _queued) {
+        _commands.Clear();
+        _rate = _target;
+        Revert();
+    }
+    _state = BAUD_IDLE;
+    return true;
+}
+
+void LPCPHABaud::Revert()
+{
+    // The PHA may be at _rate with its replies unreadable, so tell it at
+    // that rate, without waiting for a reply
+    char cmd[24];
+    snprintf(cmd, sizeof(cmd), "#baud,%lu\r", (unsigned long)_good);
+    _port.begin(_rate);
+    _port.print(cmd);
+    _port.flush();
+    _port.begin(_good);
+    _rate = _good;
+}
+
+uint32_t LPCPHABaud::FrameMicros(uint32_t bytes, uint32_t rate)
+{
+    // 10 bits a byte, with the start and stop bits
+    return (uint32_t)((uint64_t)bytes * 10 * 1000000 / rate);
+}
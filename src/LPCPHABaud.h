@@ -0,0 +1,91 @@
+/*
+ *  LPCPHABaud.h
+ *  Created: October 2026
+ *
+ *  PHA link rate negotiation.
+ *
+ *  At 500 kbaud a PHA frame of about 3 KB takes 60 ms on the wire. Once
+ *  the PHA is on, each higher rate of PHA_BAUD_RATES is tried in turn:
+ *  "#baud,<rate>" is sent through the command queue (LPCPHACommand) at
+ *  the current rate, and once the PHA confirms it, OPCSERIAL is switched
+ *  over and the rate is verified by a complete data frame arriving within
+ *  PHA_BAUD_VERIFY_MS. A rate that fails is abandoned: the PHA is told to
+ *  go back to the last good rate, and the rate is not tried again this
+ *  session. The PHA starts at PHA_BAUD_BASE each time it is powered on,
+ *  so later warm ups go straight to the rate that worked.
+ *
+ *  With PHA_CMD_REPLIES false, #baud is taken as sent and the rate is
+ *  only verified by the frames. A #baud that fails (no good reply after
+ *  the retries) is followed by a revert sent at its rate, in case the PHA
+ *  switched without its reply being seen. A PHA that fails the first
+ *  #baud command, or sends no frame at the first rate, is taken not to
+ *  support it, and is left at PHA_BAUD_BASE from then on.
+ */
+
+#ifndef LPCPHABAUD_H
+#define LPCPHABAUD_H
+
+#include <Arduino.h>
+#include "LPCPHACommand.h"
+
+/// Try higher PHA link rates after warm up. Off until #baud has been
+/// checked against the PHA firmware.
+#define PHA_BAUD_NEGOTIATE false
+/// The rate the PHA starts at
+#define PHA_BAUD_BASE 500000
+/// Wait this long for a frame at a new rate (longer than the 2 s frame period)
+#define PHA_BAUD_VERIFY_MS 2500
+/// Rates to try, in increasing order
+#define PHA_BAUD_RATES {1000000, 2000000, 3000000}
+
+class LPCPHABaud {
+public:
+    LPCPHABaud(HardwareSerial& port, LPCPHACommand& commands);
+
+    /// @brief Start negotiating, with the port just opened at PHA_BAUD_BASE
+    void Start();
+    /// @brief Step the negotiation; call on every pass while Busy()
+    /// @return true when the negotiation has just finished
+    bool Poll();
+    /// @brief Give up on a rate still being tried, going back to the last
+    /// good one, e.g. when the measurement starts
+    /// @return true if the negotiation was running
+    bool Abort();
+    /// @brief Drop the negotiation, e.g. when the PHA is powered off
+    void Stop() { _state = BAUD_IDLE; }
+    /// @brief The negotiation has the command queue
+    bool Busy() const { return _state != BAUD_IDLE; }
+    /// @brief The rate in use
+    uint32_t Rate() const { return _rate; }
+    /// @brief Wire time of a frame of the given length at a rate
+    static uint32_t FrameMicros(uint32_t bytes, uint32_t rate);
+    /// @brief A rate that failed in the last negotiation, or 0
+    uint32_t FailedRate() const { return _failed; }
+    /// @brief The PHA did not confirm #baud, and is not asked again
+    bool Unsupported() const { return _unsupported; }
+
+private:
+    enum BaudState_t : uint8_t { BAUD_IDLE, BAUD_REQUEST, BAUD_VERIFY };
+
+    uint32_t NextRate() const;
+    void Request(uint32_t rate);
+    void Revert();
+
+    HardwareSerial& _port;
+    LPCPHACommand& _commands;
+
+    BaudState_t _state = BAUD_IDLE;
+    uint32_t _rate = PHA_BAUD_BASE;     // Set on the port
+    uint32_t _good = PHA_BAUD_BASE;     // Verified this power on
+    uint32_t _target = 0;               // Being tried
+    bool _queued = false;               // #baud is in the command queue
+    uint32_t _verify_ms = 0;
+    uint32_t _verify_frames = 0;
+    uint32_t _failed = 0;
+
+    uint32_t _best = PHA_BAUD_BASE;     // Verified at an earlier power on
+    uint32_t _ceiling = UINT32_MAX;     // Rates at or above this have failed
+    bool _unsupported = false;          // The PHA ignores #baud
+};
+
+#endif /* LPCPHABAUD_H */
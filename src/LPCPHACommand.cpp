@@ -0,0 +1,241 @@
+/*
+ *  LPCPHACommand.cpp
+ *  Created: October 2026
+ *
+ *  Queued, non-blocking commands to the PHA. See LPCPHACommand.h.
+ */
+
+#include "LPCPHACommand.h"
+
+/// @brief Whether text starts with word (ASCII, any case), as a whole word
+static bool startsWithWord(const char* text, size_t len, const char* word)
+{
+    size_t n = strlen(word);
+    if (len < n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (tolower(text[i]) != tolower(word[i])) {
+            return false;
+        }
+    }
+    return len == n || !isalnum(text[n]);
+}
+
+/// @brief Whether text contains word (ASCII, any case)
+static bool containsWord(const char* text, size_t len, const char* word)
+{
+    size_t n = strlen(word);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (startsWithWord(text + i, n, word)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+LPCPHACommand::LPCPHACommand(HardwareSerial& port)
+    : _port(port)
+{
+}
+
+void LPCPHACommand::Start()
+{
+    _started = true;
+    _len = 0;
+    _long_line = false;
+    // leave the PHA the spacing after its port opens, too
+    _last_send_ms = millis();
+}
+
+bool LPCPHACommand::Stop()
+{
+    bool dropped = _n && !Finished();
+    _started = false;
+    Clear();
+    return dropped;
+}
+
+bool LPCPHACommand::Queue(const char* name, int32_t value)
+{
+    if (_n >= PHA_CMD_QUEUE_LEN) {
+        return false;
+    }
+    PHACommand_t& cmd = _commands[_n++];
+    strncpy(cmd.name, name, PHA_CMD_NAME_LEN);
+    cmd.name[PHA_CMD_NAME_LEN] = '\0';
+    cmd.value = value;
+    cmd.sends = 0;
+    cmd.status = PHA_CMD_QUEUED;
+    return true;
+}
+
+void LPCPHACommand::Clear()
+{
+    _n = 0;
+    _current = 0;
+}
+
+void LPCPHACommand::Poll()
+{
+    if (!_started || _current >= _n) {
+        return;
+    }
+    PHACommand_t& cmd = _commands[_current];
+    uint32_t elapsed = millis() - _last_send_ms;
+
+    if (cmd.status == PHA_CMD_QUEUED) {
+        if (elapsed >= PHA_CMD_SPACING_MS) {
+            Send(cmd);
+        }
+    } else if (!PHA_CMD_REPLIES) {
+        // #thresh waits for a frame to confirm it; the rest are only sent
+        bool thresh = startsWithWord(cmd.name, strlen(cmd.name), "thresh");
+        if (elapsed >= (thresh ? PHA_CMD_FRAME_TIMEOUT_MS : PHA_CMD_SPACING_MS)) {
+            Next(PHA_CMD_UNCONFIRMED);
+        }
+    } else if (elapsed >= PHA_CMD_REPLY_TIMEOUT_MS) {
+        Retry(cmd);
+    }
+}
+
+void LPCPHACommand::Send(PHACommand_t& cmd)
+{
+    char text[PHA_CMD_NAME_LEN + 16];
+    if (cmd.value == PHA_CMD_NO_VALUE) {
+        snprintf(text, sizeof(text), "#%s\r", cmd.name);
+    } else {
+        snprintf(text, sizeof(text), "#%s,%ld\r", cmd.name, (long)cmd.value);
+    }
+    _port.print(text);
+    cmd.sends++;
+    cmd.status = PHA_CMD_SENT;
+    _last_send_ms = millis();
+}
+
+void LPCPHACommand::Retry(PHACommand_t& cmd)
+{
+    if (cmd.sends > PHA_CMD_RETRIES) {
+        Next(PHA_CMD_FAILED);
+    } else {
+        // sent again once the spacing is up
+        cmd.status = PHA_CMD_QUEUED;
+    }
+}
+
+void LPCPHACommand::Next(PHACmdStatus_t status)
+{
+    _commands[_current].status = status;
+    _current++;
+}
+
+void LPCPHACommand::Listen()
+{
+    while (_port.available()) {
+        char c = _port.read();
+        _line_bytes++;
+        if (c == ',') {
+            _line_commas++;
+        }
+        if (c == '\r' || c == '\n') {
+            if (_line_commas >= PHA_FRAME_MIN_FIELDS && _len && isdigit(_line[0])) {
+                _frames++;
+                _last_frame_bytes = _line_bytes;
+            }
+            if (_long_line) {
+                // a data frame, whose start is still in the line:
+                // timestamp, laser current, threshold, ...
+                int commas = 0;
+                for (uint16_t i = 0; i < _len; i++) {
+                    if (_line[i] == ',' && ++commas == 2) {
+                        FrameThreshold(atoi(_line + i + 1));
+                        break;
+                    }
+                }
+            } else if (_len) {
+                TakeLine(_line, _len);
+            }
+            _line_bytes = 0;
+            _len = 0;
+            _long_line = false;
+            _line_commas = 0;
+            continue;
+        }
+        if (_len < PHA_REPLY_LINE_BYTES - 1) {
+            _line[_len++] = c;
+            _line[_len] = '\0';
+        } else {
+            _long_line = true;
+        }
+    }
+}
+
+bool LPCPHACommand::TakeLine(const char* line, size_t len)
+{
+    while (len && (line[len - 1] == '\r' || line[len - 1] == '\n')) {
+        len--;
+    }
+    while (len && (*line == '#' || *line == ' ')) {
+        line++;
+        len--;
+    }
+    // data frames start with the PHA timestamp
+    if (!len || isdigit(*line) || *line == '-') {
+        return false;
+    }
+
+    if (_current >= _n || _commands[_current].status != PHA_CMD_SENT) {
+        // unsolicited, or a late reply to a command already finished
+        return true;
+    }
+    PHACommand_t& cmd = _commands[_current];
+    if (!startsWithWord(line, len, cmd.name)) {
+        return true;
+    }
+
+    bool ok = !containsWord(line, len, "err") && !containsWord(line, len, "nak");
+    if (ok && cmd.value != PHA_CMD_NO_VALUE) {
+        // an echoed value must be the one sent
+        size_t i = strlen(cmd.name);
+        while (i < len && !isdigit(line[i]) && line[i] != '-') {
+            i++;
+        }
+        if (i < len) {
+            ok = atol(line + i) == cmd.value;
+        }
+    }
+    if (ok) {
+        Next(PHA_CMD_CONFIRMED);
+    } else {
+        Retry(cmd);
+    }
+    return true;
+}
+
+void LPCPHACommand::FrameThreshold(int threshold)
+{
+    if (threshold < 0 || _current >= _n) {
+        return;
+    }
+    PHACommand_t& cmd = _commands[_current];
+    if (cmd.status == PHA_CMD_SENT && startsWithWord(cmd.name, strlen(cmd.name), "thresh")
+        && cmd.value == threshold) {
+        Next(PHA_CMD_CONFIRMED);
+    }
+}
+
+const char* LPCPHACommand::StatusName(PHACmdStatus_t status)
+{
+    switch (status) {
+    case PHA_CMD_QUEUED:
+        return "queued";
+    case PHA_CMD_SENT:
+        return "sent";
+    case PHA_CMD_CONFIRMED:
+        return "confirmed";
+    case PHA_CMD_UNCONFIRMED:
+        return "unconfirmed";
+    default:
+        return "failed";
+    }
+}
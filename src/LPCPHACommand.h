@@ -0,0 +1,132 @@
+/*
+ *  LPCPHACommand.h
+ *  Created: October 2026
+ *
+ *  Queued, non-blocking commands to the PHA, with confirmation.
+ *
+ *  phaConfig() used to write #thresh, #hgoff, #lgoff and #save with a
+ *  delay(100) before each, holding up the loop for 400 ms, and never
+ *  looked at what came back. Here the commands are queued, and Poll(),
+ *  called on every loop pass, sends one at a time, PHA_CMD_SPACING_MS
+ *  apart. A command is confirmed by a reply line that starts with its
+ *  name ("#thresh,120" or "thresh 120 OK"); a reply with a different value,
+ *  or with "err" or "nak" in it, or no reply within PHA_CMD_REPLY_TIMEOUT_MS,
+ *  has it sent again, up to PHA_CMD_RETRIES times. #thresh is also
+ *  confirmed by a data frame reporting the commanded threshold. With
+ *  PHA_CMD_REPLIES false (the default, as the reply format has not been
+ *  checked against the PHA), each command is sent once, and only #thresh
+ *  is confirmed, by the frames.
+ *
+ *  Reply lines come mixed in with the data frames on OPCSERIAL. While
+ *  the flight mode is reading frames it hands each line to TakeLine(),
+ *  which keeps the replies out of the frame parser; otherwise Listen()
+ *  reads the port itself, skipping the frames.
+ */
+
+#ifndef LPCPHACOMMAND_H
+#define LPCPHACOMMAND_H
+
+#include <Arduino.h>
+
+/// Commands in one batch
+#define PHA_CMD_QUEUE_LEN 8
+/// Longest command name, without the '#'
+#define PHA_CMD_NAME_LEN 8
+/// Time between commands, as the delays were
+#define PHA_CMD_SPACING_MS 100
+/// The PHA answers each command with a reply line. Without replies,
+/// commands are sent once on the schedule and left unconfirmed (apart from
+/// #thresh, by the data frames). Off until the reply format described
+/// above has been checked against the PHA firmware; otherwise every
+/// command, #save included, would be sent PHA_CMD_RETRIES more times.
+#define PHA_CMD_REPLIES false
+/// Without replies, wait this long for a data frame to confirm #thresh
+/// (longer than the 2 s frame period)
+#define PHA_CMD_FRAME_TIMEOUT_MS 2500
+/// Wait for a reply this long before sending again
+#define PHA_CMD_REPLY_TIMEOUT_MS 500
+/// Sends after the first before a command fails
+#define PHA_CMD_RETRIES 2
+/// Bytes of a line kept by Listen(); longer lines are data frames
+#define PHA_REPLY_LINE_BYTES 64
+/// Fields a line needs to count as a data frame (the 255 HG and 255 LG
+/// channels, after the header fields)
+#define PHA_FRAME_MIN_FIELDS 510
+/// Command value for commands without one (#save)
+#define PHA_CMD_NO_VALUE INT32_MIN
+
+enum PHACmdStatus_t : uint8_t {
+    PHA_CMD_QUEUED,
+    PHA_CMD_SENT,         // Waiting for the reply
+    PHA_CMD_CONFIRMED,
+    PHA_CMD_UNCONFIRMED,  // Sent, with PHA_CMD_REPLIES false
+    PHA_CMD_FAILED        // No good reply after the retries
+};
+
+struct PHACommand_t {
+    char name[PHA_CMD_NAME_LEN + 1];
+    int32_t value;
+    uint8_t sends;
+    PHACmdStatus_t status;
+};
+
+class LPCPHACommand {
+public:
+    LPCPHACommand(HardwareSerial& port);
+
+    /// @brief Start sending, once the PHA is powered and the port is open
+    void Start();
+    /// @brief Stop sending and drop the batch, e.g. when the PHA is powered off
+    /// @return true if commands were dropped before they were finished
+    bool Stop();
+    bool Started() const { return _started; }
+
+    /// @brief Add "#name,value\r" (or "#name\r") to the batch
+    /// @return false if the batch is full
+    bool Queue(const char* name, int32_t value = PHA_CMD_NO_VALUE);
+    /// @brief Send the next command when due, and time out replies
+    void Poll();
+    /// @brief Read the port for replies, when nothing else is reading it
+    void Listen();
+    /// @brief Offer a line read from the port (without the line ending)
+    /// @return true if it was a reply rather than a data frame
+    bool TakeLine(const char* line, size_t len);
+    /// @brief The threshold reported by a data frame
+    void FrameThreshold(int threshold);
+    /// @brief Complete data frames seen by Listen()
+    uint32_t Frames() const { return _frames; }
+    /// @brief Length of the last of them, with the first line ending byte
+    uint32_t LastFrameBytes() const { return _last_frame_bytes; }
+
+    /// @brief The batch has commands, and they are all finished
+    bool Finished() const { return _n && _current >= _n; }
+    /// @brief Empty the batch, e.g. once Finished() has been reported
+    void Clear();
+    int Commands() const { return _n; }
+    const PHACommand_t& Command(int i) const { return _commands[i]; }
+    /// @brief Short name of a status, for reports
+    static const char* StatusName(PHACmdStatus_t status);
+
+private:
+    void Send(PHACommand_t& cmd);
+    void Retry(PHACommand_t& cmd);
+    void Next(PHACmdStatus_t status);
+
+    HardwareSerial& _port;
+    bool _started = false;
+
+    PHACommand_t _commands[PHA_CMD_QUEUE_LEN];
+    int _n = 0;
+    int _current = 0;           // The command being sent
+    uint32_t _last_send_ms = 0;
+
+    char _line[PHA_REPLY_LINE_BYTES];
+    uint16_t _len = 0;
+    bool _long_line = false;    // More than fits in _line
+    uint32_t _line_bytes = 0;   // All of the line, for frames
+    uint16_t _line_commas = 0;
+    uint32_t _frames = 0;
+    uint32_t _last_frame_bytes = 0;
+};
+
+#endif /* LPCPHACOMMAND_H */
@@ -0,0 +1,62 @@
+/*
+ *  LPCRS41Aggregate.cpp
+ *  Created: October 2026
+ *
+ *  Windowed statistics of RS41 samples. See LPCRS41Aggregate.h.
+ */
+
+#include "LPCRS41Aggregate.h"
+
+void LPCRS41Window::Start(uint32_t start)
+{
+    _start = start;
+    _n = 0;
+    _n_valid = 0;
+    _error = 0;
+    for (int f = 0; f < RS41_AGG_FIELDS; f++) {
+        _sum[f] = 0;
+        _min[f] = UINT16_MAX;
+        _max[f] = 0;
+    }
+}
+
+void LPCRS41Window::Add(bool valid, uint16_t error, const uint16_t fields[RS41_AGG_FIELDS])
+{
+    if (_n == UINT8_MAX) {
+        // far more than a window of 1 Hz samples can hold
+        return;
+    }
+    _n++;
+    _error |= error;
+    if (!valid) {
+        return;
+    }
+
+    _n_valid++;
+    for (int f = 0; f < RS41_AGG_FIELDS; f++) {
+        _sum[f] += fields[f];
+        if (fields[f] < _min[f]) {
+            _min[f] = fields[f];
+        }
+        if (fields[f] > _max[f]) {
+            _max[f] = fields[f];
+        }
+    }
+}
+
+void LPCRS41Window::Result(rs41TmAggregate_t& aggregate) const
+{
+    aggregate.start = _start;
+    aggregate.n = _n;
+    aggregate.n_valid = _n_valid;
+    aggregate.error = _error;
+    for (int f = 0; f < RS41_AGG_FIELDS; f++) {
+        if (_n_valid) {
+            aggregate.mean[f] = (_sum[f] + _n_valid / 2) / _n_valid;
+            aggregate.min[f] = _min[f];
+            aggregate.max[f] = _max[f];
+        } else {
+            aggregate.mean[f] = aggregate.min[f] = aggregate.max[f] = 0;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ *  LPCRS41Aggregate.h
+ *  Created: October 2026
+ *
+ *  Windowed statistics of RS41 samples, for the aggregated RS41 TM.
+ *
+ *  With the TM aggregated (RS41_AGGREGATE_TM), every 1 Hz sample still
+ *  goes to the RS41_*.csv file, but the TM carries one rs41TmAggregate_t
+ *  per window of RS41_AGGREGATE_SECS instead: the mean,
+ *  minimum and maximum of each TM field over the valid samples in the
+ *  window, with the sample counts and the OR of the error codes. The
+ *  fields are in the scaled units of rs41TmSample_t.
+ */
+
+#ifndef LPCRS41AGGREGATE_H
+#define LPCRS41AGGREGATE_H
+
+#include <stdint.h>
+
+/// The aggregated fields: tdry, humidity, tsensor, pres
+#define RS41_AGG_FIELDS 4
+
+/// @brief One window of RS41 samples, for the RS41A TM message
+struct rs41TmAggregate_t {
+    uint32_t start;                    // Window start time
+    uint8_t n;                         // Samples in the window
+    uint8_t n_valid;                   // Valid samples, which the statistics cover
+    uint16_t error;                    // OR of the samples' error codes
+    uint16_t mean[RS41_AGG_FIELDS];
+    uint16_t min[RS41_AGG_FIELDS];
+    uint16_t max[RS41_AGG_FIELDS];
+};
+
+class LPCRS41Window {
+public:
+    /// @brief Start an empty window
+    void Start(uint32_t start);
+    /// @brief Add a sample's TM fields (tdry, humidity, tsensor, pres)
+    void Add(bool valid, uint16_t error, const uint16_t fields[RS41_AGG_FIELDS]);
+    /// @brief The statistics of the samples added since Start()
+    void Result(rs41TmAggregate_t& aggregate) const;
+
+    uint32_t StartTime() const { return _start; }
+    bool Empty() const { return _n == 0; }
+
+private:
+    uint32_t _start = 0;
+    uint8_t _n = 0;
+    uint8_t _n_valid = 0;
+    uint16_t _error = 0;
+    uint32_t _sum[RS41_AGG_FIELDS];
+    uint16_t _min[RS41_AGG_FIELDS];
+    uint16_t _max[RS41_AGG_FIELDS];
+};
+
+#endif /* LPCRS41AGGREGATE_H */
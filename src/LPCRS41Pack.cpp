@@ -0,0 +1,270 @@
+/*
+ *  LPCRS41Pack.cpp
+ *  Created: October 2026
+ *
+ *  Packed, delta-coded RS41 TM samples. See LPCRS41Pack.h.
+ */
+
+#include "LPCRS41Pack.h"
+
+#define RS41_PACK_FIELDS 4
+
+namespace {
+
+/// Bounded big-endian writer; ok goes false when the output is full
+struct Writer {
+    uint8_t* p;
+    uint8_t* end;
+    bool ok;
+
+    void u8(uint8_t v)
+    {
+        if (p < end) {
+            *p++ = v;
+        } else {
+            ok = false;
+        }
+    }
+    void u16(uint16_t v)
+    {
+        u8(v >> 8);
+        u8(v & 0xFF);
+    }
+    void u32(uint32_t v)
+    {
+        u16(v >> 16);
+        u16(v & 0xFFFF);
+    }
+    void varint(uint32_t v)
+    {
+        while (v >= 0x80) {
+            u8((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        u8(v);
+    }
+};
+
+/// Bounded big-endian reader; ok goes false on reading past the end
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+    uint8_t u8()
+    {
+        if (p < end) {
+            return *p++;
+        }
+        ok = false;
+        return 0;
+    }
+    uint16_t u16()
+    {
+        uint16_t hi = u8();
+        return (hi << 8) | u8();
+    }
+    uint32_t u32()
+    {
+        uint32_t hi = u16();
+        return (hi << 16) | u16();
+    }
+    uint32_t varint()
+    {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 32; shift += 7) {
+            uint8_t b = u8();
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return v;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+uint16_t field(const rs41TmSample_t& s, int f)
+{
+    switch (f) {
+    case 0:
+        return s.tdry;
+    case 1:
+        return s.humidity;
+    case 2:
+        return s.tsensor;
+    default:
+        return s.pres;
+    }
+}
+
+void setField(rs41TmSample_t& s, int f, uint16_t v)
+{
+    switch (f) {
+    case 0:
+        s.tdry = v;
+        break;
+    case 1:
+        s.humidity = v;
+        break;
+    case 2:
+        s.tsensor = v;
+        break;
+    default:
+        s.pres = v;
+        break;
+    }
+}
+
+} // namespace
+
+size_t LPCRS41Pack(const rs41TmSample_t* samples, int n, uint32_t start_time, uint8_t* out, size_t cap)
+{
+    if (n <= 0 || n > UINT16_MAX) {
+        return 0;
+    }
+    Writer w = {out, out + cap, true};
+
+    w.u8(LPC_RS41_PACK_VERSION);
+    w.u32(start_time + samples[0].secs);
+    w.u16((uint16_t)n);
+
+    // Exceptions to the 1 s cadence
+    int n_gaps = 0;
+    for (int i = 1; i < n; i++) {
+        if (samples[i].secs <= samples[i - 1].secs) {
+            return 0;
+        }
+        if (samples[i].secs != samples[i - 1].secs + 1) {
+            n_gaps++;
+        }
+    }
+    if (n_gaps > LPC_RS41_PACK_MAX_GAPS) {
+        return 0;
+    }
+    w.u8((uint8_t)n_gaps);
+    for (int i = 1; i < n; i++) {
+        uint32_t extra = samples[i].secs - samples[i - 1].secs - 1;
+        if (extra) {
+            if (extra > UINT16_MAX) {
+                return 0;
+            }
+            w.u16((uint16_t)i);
+            w.u16((uint16_t)extra);
+        }
+    }
+
+    // Validity and error bitmaps, then the error codes
+    for (int i = 0; i < n; i += 8) {
+        uint8_t bits = 0;
+        for (int b = 0; b < 8 && i + b < n; b++) {
+            bits |= (samples[i + b].valid ? 1 : 0) << b;
+        }
+        w.u8(bits);
+    }
+    for (int i = 0; i < n; i += 8) {
+        uint8_t bits = 0;
+        for (int b = 0; b < 8 && i + b < n; b++) {
+            bits |= (samples[i + b].error ? 1 : 0) << b;
+        }
+        w.u8(bits);
+    }
+    for (int i = 0; i < n; i++) {
+        if (samples[i].error) {
+            w.u16(samples[i].error);
+        }
+    }
+
+    // One delta stream per field, over the valid samples
+    for (int f = 0; f < RS41_PACK_FIELDS; f++) {
+        bool first = true;
+        uint16_t prev = 0;
+        for (int i = 0; i < n; i++) {
+            if (!samples[i].valid) {
+                continue;
+            }
+            uint16_t v = field(samples[i], f);
+            if (first) {
+                w.u16(v);
+                first = false;
+            } else {
+                int32_t delta = (int32_t)v - (int32_t)prev;
+                w.varint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+            }
+            prev = v;
+        }
+    }
+
+    return w.ok ? (size_t)(w.p - out) : 0;
+}
+
+int LPCRS41Unpack(const uint8_t* in, size_t len, uint32_t* start_time, rs41TmSample_t* samples, int max_samples)
+{
+    Reader r = {in, in + len, true};
+
+    if (r.u8() != LPC_RS41_PACK_VERSION) {
+        return -1;
+    }
+    *start_time = r.u32();
+    int n = r.u16();
+    if (!r.ok || n > max_samples) {
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        samples[i] = rs41TmSample_t();
+        samples[i].secs = i;
+    }
+    int n_gaps = r.u8();
+    for (int g = 0; g < n_gaps; g++) {
+        uint16_t index = r.u16();
+        uint16_t extra = r.u16();
+        if (!r.ok || index == 0 || index >= n) {
+            return -1;
+        }
+        for (int i = index; i < n; i++) {
+            samples[i].secs += extra;
+        }
+    }
+
+    for (int i = 0; i < n; i += 8) {
+        uint8_t bits = r.u8();
+        for (int b = 0; b < 8 && i + b < n; b++) {
+            samples[i + b].valid = (bits >> b) & 1;
+        }
+    }
+    for (int i = 0; i < n; i += 8) {
+        uint8_t bits = r.u8();
+        for (int b = 0; b < 8 && i + b < n; b++) {
+            samples[i + b].error = (bits >> b) & 1;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (samples[i].error) {
+            samples[i].error = r.u16();
+        }
+    }
+
+    for (int f = 0; f < RS41_PACK_FIELDS; f++) {
+        bool first = true;
+        uint16_t prev = 0;
+        for (int i = 0; i < n; i++) {
+            if (!samples[i].valid) {
+                continue;
+            }
+            uint16_t v;
+            if (first) {
+                v = r.u16();
+                first = false;
+            } else {
+                uint32_t z = r.varint();
+                int32_t delta = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+                v = (uint16_t)(prev + delta);
+            }
+            setField(samples[i], f, v);
+            prev = v;
+        }
+    }
+
+    return r.ok ? n : -1;
+}
@@ -0,0 +1,63 @@
+/*
+ *  LPCRS41Pack.h
+ *  Created: October 2026
+ *
+ *  Packed, delta-coded RS41 TM samples (StateMess2 "RS41D").
+ *
+ *  The original RS41 TM repeats a 32 bit time and full width fields in
+ *  every 17 byte sample. Here the samples share one base time and an
+ *  implied 1 s cadence, with exception records where samples are missing,
+ *  and each field is sent as the difference from the previous valid
+ *  sample, which for a balloon is nearly always a single byte.
+ *
+ *  Payload layout (multi-byte integers big-endian, like the rest of the TM):
+ *    u8  version (LPC_RS41_PACK_VERSION)
+ *    u32 time of the first sample
+ *    u16 n samples
+ *    u8  n gaps, then per gap: u16 sample index, u16 extra seconds before it
+ *    validity bitmap, (n + 7) / 8 bytes, sample i in bit i % 8 of byte i / 8
+ *    error bitmap, the same shape: set where the error code is non-zero
+ *    u16 error code of each sample with its error bit set
+ *    for each field (tdry, humidity, tsensor, pres), over the valid
+ *    samples: the first value as u16, then the zigzag coded difference
+ *    from the previous one as a base 128 varint (low groups first, top bit
+ *    set on all but the last byte)
+ *  Field values are in the scaled units of rs41TmSample_t.
+ *
+ *  This file has no Arduino dependencies, and is also built by the host
+ *  tools in tools/.
+ */
+
+#ifndef LPCRS41PACK_H
+#define LPCRS41PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LPC_RS41_PACK_VERSION 1
+/// Gap records one message can hold
+#define LPC_RS41_PACK_MAX_GAPS 255
+
+/// @brief The RS41 compressed sample for use in the RS41 TM message
+struct rs41TmSample_t {
+    uint8_t valid;
+    uint32_t secs;
+    uint16_t tdry;
+    uint16_t humidity;
+    uint16_t tsensor;
+    uint16_t pres;
+    uint16_t error;
+};
+
+/// @brief Pack samples, whose times are start_time + secs
+/// @return The packed length, or 0 if it does not fit in cap, or the
+/// samples are not in time order
+size_t LPCRS41Pack(const rs41TmSample_t* samples, int n, uint32_t start_time, uint8_t* out, size_t cap);
+
+/// @brief Unpack a payload. The samples' secs are relative to *start_time,
+/// the time of the first sample.
+/// @return The number of samples, or -1 if the payload is corrupt or holds
+/// more than max_samples
+int LPCRS41Unpack(const uint8_t* in, size_t len, uint32_t* start_time, rs41TmSample_t* samples, int max_samples);
+
+#endif /* LPCRS41PACK_H */
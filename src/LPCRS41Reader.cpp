@@ -0,0 +1,97 @@
+/*
+ *  LPCRS41Reader.cpp
+ *  Created: October 2026
+ *
+ *  Non-blocking RS41 sample acquisition. See LPCRS41Reader.h.
+ */
+
+#include "LPCRS41Reader.h"
+
+LPCRS41Reader::LPCRS41Reader(RS41& rs41, HardwareSerial& port)
+    : _rs41(rs41),
+    _port(port),
+    _sample()
+{
+}
+
+void LPCRS41Reader::Request(time_t when, uint32_t timeout_ms)
+{
+    if (_pending) {
+        _timeouts++;
+        Finish(false);
+    }
+    Cancel();
+
+    _port.print(RS41_DATA_REQUEST);
+    _pending = true;
+    _request_ms = millis();
+    _timeout_ms = timeout_ms;
+    _request_time = when;
+}
+
+void LPCRS41Reader::Cancel()
+{
+    while (_port.available()) {
+        _port.read();
+    }
+    _len = 0;
+    _pending = false;
+}
+
+void LPCRS41Reader::Poll()
+{
+    while (_port.available()) {
+        char c = _port.read();
+        if (!_pending) {
+            // unsolicited, or the rest of an abandoned reply
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            if (_len) {
+                Finish(_len < RS41_LINE_BYTES);
+                return;
+            }
+            continue;
+        }
+        // a full buffer marks a line too long to decode
+        if (_len < RS41_LINE_BYTES) {
+            _line[_len++] = c;
+        }
+    }
+
+    if (_pending && millis() - _request_ms > _timeout_ms) {
+        _timeouts++;
+        Finish(false);
+    }
+}
+
+bool LPCRS41Reader::Take(RS41::RS41SensorData_t& data, time_t& when)
+{
+    if (!_ready) {
+        return false;
+    }
+    data = _sample;
+    when = _sample_time;
+    _ready = false;
+    return true;
+}
+
+void LPCRS41Reader::Finish(bool complete)
+{
+    if (_ready) {
+        _overruns++;
+    }
+
+    if (complete) {
+        _line[_len] = '\0';
+        _sample = _rs41.decode_sensor_data(String(_line));
+    } else {
+        _sample = RS41::RS41SensorData_t();
+        _sample.valid = false;
+    }
+    _sample_time = _request_time;
+    _ready = true;
+
+    _len = 0;
+    _pending = false;
+}
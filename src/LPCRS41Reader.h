@@ -0,0 +1,74 @@
+/*
+ *  LPCRS41Reader.h
+ *  Created: October 2026
+ *
+ *  Non-blocking RS41 sample acquisition.
+ *
+ *  RS41::decoded_sensor_data() sends the sensor data request and then waits
+ *  for the reply, which held up the PHA state machine for the length of
+ *  the exchange every second. Here the request is only written to the
+ *  port; Poll(), called on every loop pass, moves whatever reply bytes
+ *  have arrived into a line buffer, and decodes the line once it is
+ *  complete into a ready slot, with the time of the request. The mode code
+ *  collects finished samples with Take().
+ *
+ *  A reply that is not complete within the request's timeout gives an
+ *  invalid sample, as a failed decoded_sensor_data() did, so that there is
+ *  still one sample per request.
+ */
+
+#ifndef LPCRS41READER_H
+#define LPCRS41READER_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include "RS41.h"
+
+/// The sensor data request sent by RS41::decoded_sensor_data(); keep in
+/// step with the RS41 library
+#define RS41_DATA_REQUEST "xdata=?\r"
+/// Longest reply line kept; longer lines are decoded as invalid
+#define RS41_LINE_BYTES 192
+/// Give up on a reply after this long, by default (less than the period)
+#define RS41_REPLY_TIMEOUT_MS 800
+
+class LPCRS41Reader {
+public:
+    LPCRS41Reader(RS41& rs41, HardwareSerial& port);
+
+    /// @brief Send a sensor data request, for a sample taken at time when.
+    /// A reply still outstanding from the previous request is abandoned.
+    void Request(time_t when, uint32_t timeout_ms = RS41_REPLY_TIMEOUT_MS);
+    /// @brief Abandon any outstanding reply, e.g. before a blocking RS41
+    /// library call, and discard unread bytes
+    void Cancel();
+    /// @brief Move arrived bytes into the line, and decode it when complete
+    void Poll();
+    /// @brief Collect the finished sample, if there is one
+    bool Take(RS41::RS41SensorData_t& data, time_t& when);
+
+    uint32_t Timeouts() const { return _timeouts; }
+    uint32_t Overruns() const { return _overruns; }
+
+private:
+    void Finish(bool complete);
+
+    RS41& _rs41;
+    HardwareSerial& _port;
+
+    char _line[RS41_LINE_BYTES];
+    uint16_t _len = 0;
+    bool _pending = false;      // Waiting for a reply
+    uint32_t _request_ms = 0;
+    uint32_t _timeout_ms = RS41_REPLY_TIMEOUT_MS;
+    time_t _request_time = 0;
+
+    bool _ready = false;        // _sample has not been taken yet
+    RS41::RS41SensorData_t _sample;
+    time_t _sample_time = 0;
+
+    uint32_t _timeouts = 0;
+    uint32_t _overruns = 0;     // Samples replaced before they were taken
+};
+
+#endif /* LPCRS41READER_H */
@@ -0,0 +1,125 @@
+/*
+ *  LPCRatePolicy.cpp
+ *  Created: October 2026
+ *
+ *  Measurement rate policy. See LPCRatePolicy.h.
+ */
+
+#include "LPCRatePolicy.h"
+
+#include <string.h>
+
+LPCRatePolicy::LPCRatePolicy()
+{
+    memset(_bands, 0, sizeof(_bands));
+    memset(_budget, 0, sizeof(_budget));
+}
+
+bool LPCRatePolicy::SetBand(uint8_t index, float low_m, float high_m)
+{
+    // NaN fails the comparison too
+    if ((index >= LPC_RATE_N_BANDS) || !(low_m <= high_m)) {
+        return false;
+    }
+    _bands[index].low_m = low_m;
+    _bands[index].high_m = high_m;
+    return true;
+}
+
+void LPCRatePolicy::Reset()
+{
+    _head = 0;
+    _count = 0;
+    _mode = LPC_RATE_DUTY;
+    _active = 0;
+    _rate_valid = false;
+    _rate_mps = 0;
+    _last_t = 0;
+    _triggered_t = 0;
+}
+
+bool LPCRatePolicy::Update(uint32_t t, float altitude_m)
+{
+    if (_last_t && (t > _last_t)) {
+        _budget[_mode].secs += t - _last_t;
+    }
+    _last_t = t;
+    _altitude_m = altitude_m;
+
+    if (altitude_m == 0) {
+        // no fix
+        _count = 0;
+        _head = 0;
+    } else {
+        int index = (_head + _count) % LPC_RATE_WINDOW_SAMPLES;
+        if (_count == LPC_RATE_WINDOW_SAMPLES) {
+            index = _head;
+            _head = (_head + 1) % LPC_RATE_WINDOW_SAMPLES;
+        } else {
+            _count++;
+        }
+        _times[index] = t;
+        _altitudes[index] = altitude_m;
+    }
+
+    _rate_valid = false;
+    if (_count == LPC_RATE_WINDOW_SAMPLES) {
+        int newest = (_head + _count - 1) % LPC_RATE_WINDOW_SAMPLES;
+        uint32_t span = _times[newest] - _times[_head];
+        if (span) {
+            _rate_mps = (_altitudes[newest] - _altitudes[_head]) / span;
+            _rate_valid = true;
+        }
+    }
+
+    _active = 0;
+    if (_rate_valid && (_rate_mps > LPC_RATE_VERTICAL_MPS)) {
+        _active |= LPC_RATE_TRIGGER_ASCENT;
+    }
+    if (_rate_valid && (_rate_mps < -LPC_RATE_VERTICAL_MPS)) {
+        _active |= LPC_RATE_TRIGGER_DESCENT;
+    }
+    if (altitude_m != 0) {
+        for (int b = 0; b < LPC_RATE_N_BANDS; b++) {
+            if ((altitude_m >= _bands[b].low_m) && (altitude_m < _bands[b].high_m)) {
+                _active |= LPC_RATE_TRIGGER_BAND;
+            }
+        }
+    }
+    _active &= _triggers;
+
+    LPCRateMode mode = _mode;
+    if (!LPC_RATE_POLICY) {
+        mode = LPC_RATE_DUTY;
+    } else if (_active) {
+        _triggered_t = t;
+        mode = LPC_RATE_CONTINUOUS;
+    } else if ((_mode == LPC_RATE_CONTINUOUS) && (t - _triggered_t >= LPC_RATE_HOLD_SECS)) {
+        mode = LPC_RATE_DUTY;
+    }
+
+    bool changed = mode != _mode;
+    _mode = mode;
+    return changed;
+}
+
+void LPCRatePolicy::AddMeasurement(LPCRateMode mode, uint32_t secs)
+{
+    _budget[mode].cycles++;
+    _budget[mode].measure_secs += secs;
+}
+
+void LPCRatePolicy::AddTm(LPCRateMode mode, uint32_t bytes)
+{
+    _budget[mode].tm_bytes += bytes;
+}
+
+void LPCRatePolicy::AddEnergy(LPCRateMode mode, float joules)
+{
+    _budget[mode].energy_j += joules;
+}
+
+const char* LPCRatePolicy::ModeName(LPCRateMode mode)
+{
+    return mode == LPC_RATE_CONTINUOUS ? "continuous" : "duty";
+}
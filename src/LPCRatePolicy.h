@@ -0,0 +1,126 @@
+/*
+ *  LPCRatePolicy.h
+ *  Created: October 2026
+ *
+ *  Measurement rate policy: the duty-cycled schedule, or continuous
+ *  sampling, chosen from the flight phase.
+ *
+ *  Update() is given the Zephyr GPS altitude every LPC_RATE_UPDATE_SECS.
+ *  The vertical rate is the altitude change across the last
+ *  LPC_RATE_WINDOW_SAMPLES updates, which smooths out the GPS noise and
+ *  the oscillations seen at float. Sampling is continuous while the
+ *  balloon climbs or descends faster than LPC_RATE_VERTICAL_MPS, or is
+ *  inside one of the altitude bands, as enabled by the trigger mask. Once
+ *  the triggers clear, continuous sampling is held for LPC_RATE_HOLD_SECS
+ *  more, so that a brief pause in the ascent does not power the
+ *  instrument down only to warm it up again.
+ *
+ *  An altitude of 0, what the Zephyr GPS reads before its first fix, is
+ *  taken as no fix, and restarts the vertical rate window.
+ *
+ *  The time, measuring time, cycles, TM bytes and energy spent in each
+ *  mode are kept, for comparing the cost of the modes.
+ *
+ *  This file has no Arduino dependencies.
+ */
+
+#ifndef LPCRATEPOLICY_H
+#define LPCRATEPOLICY_H
+
+#include <stdint.h>
+
+/// Switch to continuous sampling as the triggers below ask; false keeps
+/// the duty-cycled schedule throughout
+#define LPC_RATE_POLICY true
+/// Triggers enabled by default (LPC_RATE_TRIGGER_*)
+#define LPC_RATE_TRIGGERS (LPC_RATE_TRIGGER_ASCENT | LPC_RATE_TRIGGER_DESCENT | LPC_RATE_TRIGGER_BAND)
+/// Period of the altitude updates
+#define LPC_RATE_UPDATE_SECS 60
+/// Updates the vertical rate is measured across (5 minutes)
+#define LPC_RATE_WINDOW_SAMPLES 6
+/// Vertical speed above which the balloon is ascending or descending
+#define LPC_RATE_VERTICAL_MPS 1.0f
+/// Stay continuous this long after the triggers clear
+#define LPC_RATE_HOLD_SECS 600
+/// Altitude bands that can be set
+#define LPC_RATE_N_BANDS 4
+
+#define LPC_RATE_TRIGGER_ASCENT  0x01
+#define LPC_RATE_TRIGGER_DESCENT 0x02
+#define LPC_RATE_TRIGGER_BAND    0x04
+
+enum LPCRateMode : uint8_t {
+    LPC_RATE_DUTY,          // Cycles on the Set_cycleTime grid
+    LPC_RATE_CONTINUOUS,    // Cycles back to back, the instrument left on
+    LPC_RATE_N_MODES
+};
+
+/// @brief Altitude band [low_m, high_m); unused when high_m <= low_m
+struct LPCRateBand {
+    float low_m;
+    float high_m;
+};
+
+/// @brief What has been spent in one mode
+struct LPCRateBudget {
+    uint32_t secs;          // In the mode
+    uint32_t measure_secs;  // Of which measuring
+    uint32_t cycles;
+    uint32_t tm_bytes;      // LPC and RS41 TM
+    float energy_j;         // Pumps and optical head, from the HK currents
+};
+
+class LPCRatePolicy {
+public:
+    LPCRatePolicy();
+
+    void SetTriggers(uint8_t triggers) { _triggers = triggers; }
+    uint8_t Triggers() const { return _triggers; }
+    /// @brief Set band index; low_m == high_m clears it
+    /// @return false if the index or range is invalid
+    bool SetBand(uint8_t index, float low_m, float high_m);
+    const LPCRateBand& Band(uint8_t index) const { return _bands[index]; }
+
+    /// @brief Forget the altitude history and go back to the duty cycle,
+    /// e.g. on entering flight mode. The budgets are kept.
+    void Reset();
+    /// @brief Take the altitude at time t (seconds), and choose the mode
+    /// @return true if the mode changed
+    bool Update(uint32_t t, float altitude_m);
+
+    LPCRateMode Mode() const { return _mode; }
+    /// @brief The triggers that were active at the last update
+    uint8_t Active() const { return _active; }
+    bool RateValid() const { return _rate_valid; }
+    float VerticalRate() const { return _rate_mps; }
+    float Altitude() const { return _altitude_m; }
+
+    void AddMeasurement(LPCRateMode mode, uint32_t secs);
+    void AddTm(LPCRateMode mode, uint32_t bytes);
+    void AddEnergy(LPCRateMode mode, float joules);
+    const LPCRateBudget& Budget(LPCRateMode mode) const { return _budget[mode]; }
+
+    static const char* ModeName(LPCRateMode mode);
+
+private:
+    uint8_t _triggers = LPC_RATE_TRIGGERS;
+    LPCRateBand _bands[LPC_RATE_N_BANDS];
+
+    // Altitude window, oldest at _head once full
+    uint32_t _times[LPC_RATE_WINDOW_SAMPLES];
+    float _altitudes[LPC_RATE_WINDOW_SAMPLES];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+
+    LPCRateMode _mode = LPC_RATE_DUTY;
+    uint8_t _active = 0;
+    bool _rate_valid = false;
+    float _rate_mps = 0;
+    float _altitude_m = 0;
+    uint32_t _last_t = 0;        // Of the last update, 0 before the first
+    uint32_t _triggered_t = 0;   // Last update with a trigger active
+
+    LPCRateBudget _budget[LPC_RATE_N_MODES];
+};
+
+#endif /* LPCRATEPOLICY_H */
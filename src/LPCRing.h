@@ -0,0 +1,69 @@
+/*
+ *  LPCRing.h
+ *  Created: October 2026
+ *
+ *  Lock-free single producer, single consumer ring buffer, for passing
+ *  bytes from an interrupt handler to the main loop.
+ *
+ *  Only the producer writes _head and only the consumer writes _tail, so
+ *  no locking is needed on the single core Teensy. The indices run freely
+ *  and are masked on access, so the size must be a power of two and all
+ *  of it is usable.
+ */
+
+#ifndef LPCRING_H
+#define LPCRING_H
+
+#include <stdint.h>
+
+template <typename T, uint16_t SIZE>
+class LPCRing {
+    static_assert((SIZE & (SIZE - 1)) == 0, "LPCRing size must be a power of two");
+
+public:
+    LPCRing() : _head(0), _tail(0) {}
+
+    /// @brief Producer side: add an element
+    /// @return false if the ring is full (the element is dropped)
+    bool Push(T value)
+    {
+        uint16_t head = _head;
+        if ((uint16_t)(head - _tail) == SIZE) {
+            return false;
+        }
+        _buf[head & (SIZE - 1)] = value;
+        // the element must be in place before the consumer can see it
+        asm volatile("" ::: "memory");
+        _head = head + 1;
+        return true;
+    }
+
+    /// @brief Consumer side: remove the oldest element
+    /// @return false if the ring is empty
+    bool Pop(T& value)
+    {
+        uint16_t tail = _tail;
+        if (tail == _head) {
+            return false;
+        }
+        value = _buf[tail & (SIZE - 1)];
+        asm volatile("" ::: "memory");
+        _tail = tail + 1;
+        return true;
+    }
+
+    /// @brief Consumer side: look at element offset from the oldest,
+    /// which must be below Count()
+    T Peek(uint16_t offset) const { return _buf[(uint16_t)(_tail + offset) & (SIZE - 1)]; }
+
+    uint16_t Count() const { return (uint16_t)(_head - _tail); }
+    uint16_t Free() const { return SIZE - Count(); }
+    bool Empty() const { return _head == _tail; }
+
+private:
+    volatile uint16_t _head;
+    volatile uint16_t _tail;
+    T _buf[SIZE];
+};
+
+#endif /* LPCRING_H */
@@ -0,0 +1,248 @@
+/*
+ *  LPCScheduler.cpp
+ *  Created: October 2026
+ *
+ *  Millisecond deadline scheduler for the LPC scheduled actions.
+ *  See LPCScheduler.h.
+ */
+
+#include "LPCScheduler.h"
+
+LPCScheduler::LPCScheduler()
+    : _count(0),
+    _second(0),
+    _second_ms(0)
+{
+    for (int i = 0; i < LPC_SCHEDULER_SLOTS; i++) {
+        _index[i] = -1;
+        _fired[i] = false;
+        _fired_deadline[i] = 0;
+        _fired_ms[i] = 0;
+    }
+    ResetStats();
+}
+
+bool LPCScheduler::Schedule(uint8_t action, uint32_t delay_ms, uint32_t period_ms)
+{
+    if (action >= LPC_SCHEDULER_SLOTS) {
+        return false;
+    }
+
+    Entry entry = {millis() + delay_ms, period_ms, action};
+    if (_index[action] >= 0) {
+        // replace the pending entry in place
+        uint8_t i = _index[action];
+        _heap[i] = entry;
+        SiftUp(i);
+        SiftDown(_index[action]);
+    } else {
+        Push(entry);
+    }
+    return true;
+}
+
+bool LPCScheduler::ScheduleAt(uint8_t action, time_t when, uint32_t period_ms)
+{
+    TrackSecond();
+
+    // Until a second boundary has been seen, the sub-second phase of
+    // now() is unknown and the deadline may be up to a second early.
+    int32_t delay_ms = (int32_t)(when - _second) * 1000 - (int32_t)(millis() - _second_ms);
+    if (delay_ms < 0) {
+        delay_ms = 0;
+    }
+    return Schedule(action, (uint32_t)delay_ms, period_ms);
+}
+
+void LPCScheduler::Fire(uint8_t action)
+{
+    if (action >= LPC_SCHEDULER_SLOTS) {
+        return;
+    }
+    _fired[action] = true;
+    _fired_deadline[action] = millis();
+    _fired_ms[action] = _fired_deadline[action];
+}
+
+void LPCScheduler::Cancel(uint8_t action)
+{
+    if (action >= LPC_SCHEDULER_SLOTS) {
+        return;
+    }
+    if (_index[action] >= 0) {
+        RemoveAt(_index[action]);
+    }
+    _fired[action] = false;
+}
+
+bool LPCScheduler::Pending(uint8_t action) const
+{
+    return (action < LPC_SCHEDULER_SLOTS) && (_index[action] >= 0);
+}
+
+bool LPCScheduler::Due() const
+{
+    return _count && !Before(millis(), _heap[0].deadline);
+}
+
+FASTRUN void LPCScheduler::Poll()
+{
+    TrackSecond();
+    uint32_t now_ms = millis();
+
+    while (_count && !Before(now_ms, _heap[0].deadline)) {
+        Entry entry = _heap[0];
+        uint8_t action = entry.action;
+
+        if (_fired[action]) {
+            // still not taken since the last deadline; the two firings
+            // are taken as one
+            _stats[action].missed++;
+        }
+
+        if (entry.period) {
+            // stay on the grid of the original deadline; after an overrun,
+            // fire once for the latest deadline that has gone by
+            uint32_t skipped = (now_ms - entry.deadline) / entry.period;
+            entry.deadline += skipped * entry.period;
+            _stats[action].missed += skipped;
+            _fired[action] = true;
+            _fired_deadline[action] = entry.deadline;
+            _fired_ms[action] = now_ms;
+
+            entry.deadline += entry.period;
+            _heap[0] = entry;
+            SiftDown(0);
+        } else {
+            _fired[action] = true;
+            _fired_deadline[action] = entry.deadline;
+            _fired_ms[action] = now_ms;
+            RemoveAt(0);
+        }
+    }
+
+    // Staleness runs from when the action fired here, not from its
+    // deadline, so that an action first polled late (e.g. after a long
+    // blocking call) can still be taken
+    for (int i = 0; i < LPC_SCHEDULER_SLOTS; i++) {
+        if (_fired[i] && (now_ms - _fired_ms[i] >= LPC_ACTION_STALE_MS)) {
+            _fired[i] = false;
+            _stats[i].stale++;
+        }
+    }
+}
+
+FASTRUN bool LPCScheduler::Take(uint8_t action)
+{
+    if (action >= LPC_SCHEDULER_SLOTS) {
+        return false;
+    }
+
+    // pick up a deadline that passed since the last Poll()
+    Poll();
+    if (!_fired[action]) {
+        return false;
+    }
+    _fired[action] = false;
+
+    uint32_t late_ms = millis() - _fired_deadline[action];
+    if (late_ms > 0xFFFF) {
+        late_ms = 0xFFFF;
+    }
+    LPCActionStats& stats = _stats[action];
+    stats.count++;
+    stats.late_sum_ms += late_ms;
+    if (late_ms < stats.late_min_ms) {
+        stats.late_min_ms = late_ms;
+    }
+    if (late_ms > stats.late_max_ms) {
+        stats.late_max_ms = late_ms;
+    }
+    return true;
+}
+
+const LPCActionStats& LPCScheduler::Stats(uint8_t action) const
+{
+    return _stats[action < LPC_SCHEDULER_SLOTS ? action : 0];
+}
+
+void LPCScheduler::ResetStats()
+{
+    for (int i = 0; i < LPC_SCHEDULER_SLOTS; i++) {
+        _stats[i] = {0, 0, 0xFFFF, 0, 0, 0};
+    }
+}
+
+void LPCScheduler::TrackSecond()
+{
+    time_t current = now();
+    if (current != _second) {
+        _second = current;
+        _second_ms = millis();
+    }
+}
+
+void LPCScheduler::Push(const Entry& entry)
+{
+    if (_count >= LPC_SCHEDULER_SLOTS) {
+        return;
+    }
+    _heap[_count] = entry;
+    _index[entry.action] = _count;
+    _count++;
+    SiftUp(_count - 1);
+}
+
+void LPCScheduler::RemoveAt(uint8_t index)
+{
+    _index[_heap[index].action] = -1;
+    _count--;
+    if (index == _count) {
+        return;
+    }
+    _heap[index] = _heap[_count];
+    _index[_heap[index].action] = index;
+    SiftUp(index);
+    SiftDown(index);
+}
+
+void LPCScheduler::SiftUp(uint8_t index)
+{
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!Before(_heap[index].deadline, _heap[parent].deadline)) {
+            break;
+        }
+        Swap(index, parent);
+        index = parent;
+    }
+}
+
+void LPCScheduler::SiftDown(uint8_t index)
+{
+    while (true) {
+        uint8_t smallest = index;
+        uint8_t left = 2 * index + 1;
+        uint8_t right = left + 1;
+        if (left < _count && Before(_heap[left].deadline, _heap[smallest].deadline)) {
+            smallest = left;
+        }
+        if (right < _count && Before(_heap[right].deadline, _heap[smallest].deadline)) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        Swap(index, smallest);
+        index = smallest;
+    }
+}
+
+void LPCScheduler::Swap(uint8_t a, uint8_t b)
+{
+    Entry temp = _heap[a];
+    _heap[a] = _heap[b];
+    _heap[b] = temp;
+    _index[_heap[a].action] = a;
+    _index[_heap[b].action] = b;
+}
@@ -0,0 +1,98 @@
+/*
+ *  LPCScheduler.h
+ *  Created: October 2026
+ *
+ *  Millisecond deadline scheduler for the LPC scheduled actions.
+ *
+ *  Pending actions are kept in a binary min-heap ordered by their millis()
+ *  deadline, with at most one pending entry per action. When a deadline
+ *  passes, Poll() marks the action as fired; the mode code consumes it with
+ *  Take(). Periodic actions are re-armed from their previous deadline (not
+ *  from when they ran), so they stay on a fixed grid; if a deadline is
+ *  missed entirely the grid skips ahead rather than bunching up.
+ *
+ *  A fired action that is not taken within LPC_ACTION_STALE_MS of Poll()
+ *  firing it is dropped, which replaces the loop-count based FLAG_STALE of
+ *  the StratoCore action flags.
+ *
+ *  Dispatch jitter (deadline to Take()) is recorded per action.
+ */
+
+#ifndef LPCSCHEDULER_H
+#define LPCSCHEDULER_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+/// Number of action slots; action ids must be below this
+#define LPC_SCHEDULER_SLOTS 16
+/// A fired action that has not been taken after this long is dropped
+#define LPC_ACTION_STALE_MS 1000
+
+/// @brief Dispatch statistics for one action
+struct LPCActionStats {
+    uint32_t count;       // Times taken
+    uint32_t late_sum_ms; // Sum of deadline to Take() delays
+    uint16_t late_min_ms;
+    uint16_t late_max_ms;
+    uint16_t missed;      // Periodic deadlines skipped after an overrun, or
+                          // fired again before being taken
+    uint16_t stale;       // Fired but never taken
+};
+
+class LPCScheduler {
+public:
+    LPCScheduler();
+
+    /// @brief Fire action after delay_ms, then every period_ms if non-zero.
+    /// Replaces any pending entry for the action.
+    bool Schedule(uint8_t action, uint32_t delay_ms, uint32_t period_ms = 0);
+    /// @brief Fire action at a wall clock time (to the millisecond, using
+    /// the observed second boundaries of now()), then every period_ms.
+    bool ScheduleAt(uint8_t action, time_t when, uint32_t period_ms = 0);
+    /// @brief Fire action now
+    void Fire(uint8_t action);
+    /// @brief Remove any pending entry and fired state for action
+    void Cancel(uint8_t action);
+    bool Pending(uint8_t action) const;
+
+    /// @brief True if the earliest deadline has passed (for the event loop)
+    bool Due() const;
+    /// @brief Fire due actions, re-arm periodic ones and drop stale ones
+    void Poll();
+    /// @brief Check and clear the fired state of an action
+    bool Take(uint8_t action);
+
+    const LPCActionStats& Stats(uint8_t action) const;
+    void ResetStats();
+
+private:
+    struct Entry {
+        uint32_t deadline;
+        uint32_t period;
+        uint8_t action;
+    };
+
+    /// @brief Wrap safe a < b for millis() values
+    static bool Before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    void Push(const Entry& entry);
+    void RemoveAt(uint8_t index);
+    void SiftUp(uint8_t index);
+    void SiftDown(uint8_t index);
+    void Swap(uint8_t a, uint8_t b);
+    void TrackSecond();
+
+    Entry _heap[LPC_SCHEDULER_SLOTS];
+    uint8_t _count;
+    int8_t _index[LPC_SCHEDULER_SLOTS];        // Heap position of each action, or -1
+    bool _fired[LPC_SCHEDULER_SLOTS];
+    uint32_t _fired_deadline[LPC_SCHEDULER_SLOTS];  // For the dispatch jitter
+    uint32_t _fired_ms[LPC_SCHEDULER_SLOTS];        // When fired, for staleness
+    LPCActionStats _stats[LPC_SCHEDULER_SLOTS];
+
+    time_t _second;        // Last now() value seen
+    uint32_t _second_ms;   // millis() when it was first seen
+};
+
+#endif /* LPCSCHEDULER_H */
@@ -0,0 +1,107 @@
+/*
+ *  LPCTimeFormat.cpp
+ *  Created: October 2026
+ *
+ *  Incremental UTC timestamps. See LPCTimeFormat.h.
+ */
+
+#include "LPCTimeFormat.h"
+
+#include <string.h>
+
+#define SECS_PER_DAY 86400L
+
+/// @brief Write two digits
+static void two(char* out, uint32_t value)
+{
+    out[0] = '0' + value / 10;
+    out[1] = '0' + value % 10;
+}
+
+LPCTimeFormat::LPCTimeFormat()
+{
+    _text[LPC_TIME_TEXT_LEN] = '\0';
+    SetDay(0);
+    SetTimeOfDay(0);
+}
+
+const char* LPCTimeFormat::Format(time_t t)
+{
+    if (t == _time) {
+        return _text;
+    }
+    if (t == _time + 1 && t - _day_start < SECS_PER_DAY) {
+        Tick();
+    } else {
+        if (t < _day_start || t - _day_start >= SECS_PER_DAY) {
+            SetDay(t);
+        }
+        SetTimeOfDay((uint32_t)(t - _day_start));
+    }
+    _time = t;
+    return _text;
+}
+
+char* LPCTimeFormat::Write(char* out, time_t t)
+{
+    memcpy(out, Format(t), LPC_TIME_TEXT_LEN);
+    return out + LPC_TIME_TEXT_LEN;
+}
+
+void LPCTimeFormat::SetDay(time_t t)
+{
+    int64_t days = (int64_t)t / SECS_PER_DAY;
+    if ((int64_t)t % SECS_PER_DAY < 0) {
+        days--;
+    }
+    _day_start = (time_t)(days * SECS_PER_DAY);
+
+    // Civil date from days since 1970-01-01 (proleptic Gregorian), in
+    // 400 year eras of 146097 days starting on 0000-03-01
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);                            // [0, 146096]
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;   // [0, 399]
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);                 // [0, 365]
+    uint32_t mp = (5 * doy + 2) / 153;                                      // [0, 11] from March
+    uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+    int64_t year = yoe + era * 400 + (month <= 2);
+
+    uint32_t y = year < 0 ? 0 : (year > 9999 ? 9999 : (uint32_t)year);
+    two(_text, y / 100);
+    two(_text + 2, y % 100);
+    two(_text + 4, month);
+    two(_text + 6, day);
+}
+
+void LPCTimeFormat::SetTimeOfDay(uint32_t secs)
+{
+    uint32_t mins = secs / 60;
+    two(_text + 8, mins / 60);
+    two(_text + 10, mins % 60);
+    two(_text + 12, secs % 60);
+}
+
+/// @brief Step the time of day by one second, which is not the last of
+/// the day
+void LPCTimeFormat::Tick()
+{
+    // Digits from the right, with the value at which each one carries
+    static const char LIMIT[4] = {'9', '5', '9', '5'};
+    for (int i = 0; i < 4; i++) {
+        char& c = _text[13 - i];
+        if (c != LIMIT[i]) {
+            c++;
+            return;
+        }
+        c = '0';
+    }
+    // Hours, 00 to 23
+    if (_text[9] == '9') {
+        _text[8]++;
+        _text[9] = '0';
+    } else {
+        _text[9]++;
+    }
+}
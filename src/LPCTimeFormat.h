@@ -0,0 +1,48 @@
+/*
+ *  LPCTimeFormat.h
+ *  Created: October 2026
+ *
+ *  Incremental UTC timestamps, YYYYMMDDHHmmSS, for the SD file names and
+ *  the RS41 CSV rows.
+ *
+ *  gmtime() and strftime() redo the whole calendar conversion and parse
+ *  a format string for every row. Here the text of the last time is kept:
+ *  one second later only the digits that change are stepped, a later time
+ *  on the same day rewrites the time of day, and only a different day
+ *  converts the date (with integer arithmetic, no gmtime()).
+ *
+ *  This file has no Arduino dependencies, and is also built by the host
+ *  tools in tools/ (see lpc_fmtbench).
+ */
+
+#ifndef LPCTIMEFORMAT_H
+#define LPCTIMEFORMAT_H
+
+#include <stdint.h>
+#include <time.h>
+
+/// Length of the text, without the terminator
+#define LPC_TIME_TEXT_LEN 14
+
+class LPCTimeFormat {
+public:
+    LPCTimeFormat();
+
+    /// @brief The time as YYYYMMDDHHmmSS. The text stays valid until the
+    /// next call.
+    const char* Format(time_t t);
+    /// @brief Write the time as YYYYMMDDHHmmSS, without a terminator
+    /// @return The end of what was written
+    char* Write(char* out, time_t t);
+
+private:
+    void SetDay(time_t t);
+    void SetTimeOfDay(uint32_t secs);
+    void Tick();
+
+    time_t _time;         // Time of _text
+    time_t _day_start;    // 00:00:00 of its day
+    char _text[LPC_TIME_TEXT_LEN + 1];
+};
+
+#endif /* LPCTIMEFORMAT_H */
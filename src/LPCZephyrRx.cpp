@@ -0,0 +1,41 @@
+/*
+ *  LPCZephyrRx.cpp
+ *  Created: October 2026
+ *
+ *  Interrupt-driven Zephyr byte ingestion. See LPCZephyrRx.h.
+ */
+
+#include "LPCZephyrRx.h"
+
+LPCRing<uint8_t, ZEPHYR_RX_RING_SIZE> LPCZephyrRx::_ring;
+HardwareSerial* LPCZephyrRx::_port = nullptr;
+void (*LPCZephyrRx::_chained)(void) = nullptr;
+volatile uint32_t LPCZephyrRx::_last_byte_us = 0;
+volatile uint32_t LPCZephyrRx::_overflows = 0;
+
+FLASHMEM void LPCZephyrRx::Begin(HardwareSerial& port, IRQ_NUMBER_t irq)
+{
+    __disable_irq();
+    // the vector table is in RAM; external interrupts start at entry 16
+    _chained = _VectorsRam[irq + 16];
+    _port = &port;
+    attachInterruptVector(irq, Isr);
+    __enable_irq();
+}
+
+FASTRUN void LPCZephyrRx::Isr()
+{
+    // let HardwareSerial empty the UART FIFO into its buffer first
+    _chained();
+
+    bool received = false;
+    while (_port->available()) {
+        if (!_ring.Push((uint8_t)_port->read())) {
+            _overflows++;
+        }
+        received = true;
+    }
+    if (received) {
+        _last_byte_us = micros();
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ *  LPCZephyrRx.h
+ *  Created: October 2026
+ *
+ *  Interrupt-driven Zephyr byte ingestion.
+ *
+ *  Begin() chains a handler onto the Zephyr UART interrupt vector, after
+ *  the HardwareSerial handler. Every byte the UART receives is moved into
+ *  a lock-free SPSC ring in interrupt context, and the arrival time of the
+ *  last byte is recorded, so the main loop can wake and hand complete
+ *  messages to the StratoCore router without waiting for a loop tick.
+ *
+ *  Only used when the Zephyr port is a hardware UART (not with
+ *  LOG_ZEPHYR_COMMS_SHARED), in which case nothing else may read from it.
+ */
+
+#ifndef LPCZEPHYRRX_H
+#define LPCZEPHYRRX_H
+
+#include <Arduino.h>
+#include "LPCRing.h"
+
+/// Ring size; a power of two
+#define ZEPHYR_RX_RING_SIZE 4096
+
+class LPCZephyrRx {
+public:
+    /// @brief Chain onto the UART interrupt. Call after port.begin().
+    static void Begin(HardwareSerial& port, IRQ_NUMBER_t irq);
+    static bool Active() { return _port != nullptr; }
+
+    static bool Available() { return !_ring.Empty(); }
+    static bool Pop(uint8_t& value) { return _ring.Pop(value); }
+
+    /// @brief micros() when the most recent byte was received
+    static uint32_t LastByteMicros() { return _last_byte_us; }
+    /// @brief Bytes dropped because the ring was full
+    static uint32_t Overflows() { return _overflows; }
+
+private:
+    static void Isr();
+
+    static LPCRing<uint8_t, ZEPHYR_RX_RING_SIZE> _ring;
+    static HardwareSerial* _port;
+    static void (*_chained)(void);
+    static volatile uint32_t _last_byte_us;
+    static volatile uint32_t _overflows;
+};
+
+#endif /* LPCZEPHYRRX_H */
@@ -25,12 +25,13 @@ void StratoLPC::LowPowerMode()
     case LP_ENTRY:
         // perform setup
         log_nominal("Entering LP");
+        LogTcLatency("LP mode");
         LPC_Shutdown();
         inst_substate = LP_LOOP;
         break;
     case LP_LOOP:
         // nominal ops
-        log_debug("LP loop");
+        LPC_LOG(LOG_LP_LOOP);
         break;
     case LP_SHUTDOWN:
         // prep for shutdown
@@ -25,6 +25,7 @@ void StratoLPC::SafetyMode()
 {
     switch (inst_substate) {
     case SA_ENTRY:
+        LogTcLatency("SA mode");
         LPC_Shutdown();
         /* Assert Safe Pin*/
         digitalWrite(SAFE_PIN, HIGH);
@@ -35,11 +36,11 @@ void StratoLPC::SafetyMode()
     case SA_SEND_S:
         log_nominal("Sending safety message");
         zephyrTX.S();
-        scheduler.AddAction(RESEND_SAFETY, 60);
+        _action_scheduler.Schedule(RESEND_SAFETY, 60000);
         inst_substate = SA_ACK_WAIT;
         break;
     case SA_ACK_WAIT:
-        log_debug("Waiting on safety ack");
+        LPC_LOG(LOG_SA_WAIT_ACK);
         // check if the ack has been received
         if (S_ack_flag == ACK) {
             // clear the ack flag and go to the loop
@@ -58,7 +59,7 @@ void StratoLPC::SafetyMode()
         break;
     case SA_LOOP:
         // nominal ops
-        log_debug("SA loop");
+        LPC_LOG(LOG_SA_LOOP);
         break;
     case SA_SHUTDOWN:
         LPC_Shutdown();
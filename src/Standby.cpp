@@ -24,21 +24,22 @@ void StratoLPC::StandbyMode()
     switch (inst_substate) {
     case SB_ENTRY:
         log_nominal("Entering SB");
+        LogTcLatency("SB mode");
         LPC_Shutdown();
         // send mode request in first loop
-        scheduler.AddAction(SEND_IMR, 0);
+        _action_scheduler.Schedule(SEND_IMR, 0);
 
         inst_substate = SB_LOOP;
         break;
     case SB_LOOP:
         // nominal ops
-        log_debug("SB loop");
+        LPC_LOG(LOG_SB_LOOP);
 
         // send a mode request if time, and schedule the next
         if (CheckAction(SEND_IMR)) {
             log_nominal("Sending mode request to OBC");
             zephyrTX.IMR();
-            scheduler.AddAction(SEND_IMR, 60);
+            _action_scheduler.Schedule(SEND_IMR, 60000);
         }
         break;
     case SB_SHUTDOWN:
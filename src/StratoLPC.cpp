@@ -13,68 +13,142 @@
  */
 
 #include "StratoLPC.h"
+#include "LPCMemory.h"
+
+// PHA serial receive buffer, filled by the LPUART interrupt (see LPCMemory.h)
+DMAMEM static uint8_t OPC_serial_RX_buffer[PHA_BUFFER_SIZE];
+DMAMEM static uint8_t RS41_serial_RX_buffer[RS41_SERIAL_BUFFER_SIZE];
 
 StratoLPC::StratoLPC()
     : StratoCore(&ZEPHYR_SERIAL, INSTRUMENT),
     OPC(13),
-    _rs41(Serial7, RS41_ENB_PIN)
+    _rs41(RS41_SERIAL, RS41_ENB_PIN),
+    _rs41_reader(_rs41, RS41_SERIAL),
+    _pha_cmd(OPCSERIAL),
+    _pha_baud(OPCSERIAL, _pha_cmd),
+    _config_journal(LPC_CONFIG_EEPROM_START, LPC_CONFIG_EEPROM_BYTES, sizeof(lpcConfig_t))
 {
 }
 
-void StratoLPC::InstrumentSetup()
+FLASHMEM void StratoLPC::InstrumentSetup()
 {   
-    OPC.SetUp();  //Setup the board
-    OPC.configure_memory_table(); //This is necessary to load custom thermister coefficients
-    OPC.ConfigureChannels(); //Setup the LTC2983 Channels
+    OPC.SetUp();  //Setup the board, and start the LTC2983 initializing
 
     /*Figure out haw many High Gain and Low Gain Bins we Have */
     NumberHGBins = sizeof(Set_HGBinBoundaries)/sizeof(Set_HGBinBoundaries[0]) - 1;
     NumberLGBins = sizeof(Set_LGBinBoundaries)/sizeof(Set_LGBinBoundaries[0]) - 1;
     
-    /*set the data array to zeros so we can co-add to it */
-    memset(BinData,0,sizeof(BinData));
+    /*carve the measurement buffers, and set the data arrays to zeros so we can co-add to them */
+    AllocateArena();
+    // after the arena, which bounds the cycle settings
+    RestoreConfig();
+    _action_scheduler.Schedule(MEM_REPORT, MEM_REPORT_SECS * 1000UL, MEM_REPORT_SECS * 1000UL);
     
     OPCSERIAL.addMemoryForRead(&OPC_serial_RX_buffer, sizeof(OPC_serial_RX_buffer));
+    RS41_SERIAL.addMemoryForRead(&RS41_serial_RX_buffer, sizeof(RS41_serial_RX_buffer));
     Wire.begin();//Activate  Bus I2C for Mass Flow Meter
 
+    // Bring up the SD card once; files are then written through OPC's handle cache
+    if (!OPC.BeginSD()) {
+        log_error("SD card not available, local storage will be retried");
+    } else if (SD_BENCHMARK) {
+        OPC.BenchmarkSD();
+    }
+    LPCBoot::Mark(LPC_BOOT_SD);
+
+    // The LTC2983 has been initializing since SetUp()
+    if (!OPC.WaitLTC2983(LTC2983_READY_TIMEOUT_MS)) {
+        log_error("LTC2983 not ready, configuring anyway");
+    }
+    OPC.configure_memory_table(); //This is necessary to load custom thermister coefficients
+    OPC.ConfigureChannels(); //Setup the LTC2983 Channels
+    LPCBoot::Mark(LPC_BOOT_LTC2983);
 }
 
 void StratoLPC::InstrumentLoop()
 {
     WatchFlags();
+    RunArchive();
+    OPC.SyncFiles();
+    _config_journal.Poll();
+    _rs41_reader.Poll();
+    LPCMemStats::Sample();
+    if (_action_scheduler.Take(MEM_REPORT)) {
+        LogMemory();
+        SendMemoryTelemetry();
+    }
 }
 
 // The telecommand handler must return ACK/NAK
-bool StratoLPC::TCHandler(Telecommand_t telecommand)
+FLASHMEM bool StratoLPC::TCHandler(Telecommand_t telecommand)
 {
     String dbg_msg = "";
+    // a setting out of range is NAKed
+    bool accepted = true;
 
     switch (telecommand) {
     case SETLASERTEMP:
-        Set_LaserTemp = lpcParam.setLaserTemp; // todo: checking
+        if (!TemperatureOk(lpcParam.setLaserTemp)) {
+            ZephyrLogWarn("TC: Invalid Laser Temp");
+            accepted = false;
+            break;
+        }
+        Set_LaserTemp = lpcParam.setLaserTemp;
         break;
     case SETFLUSH:
-        Set_FlushingTime = lpcParam.lpc_flush; // todo: checking
+        if (!DurationOk(lpcParam.lpc_flush)) {
+            ZephyrLogWarn("TC: Invalid Flushing Time");
+            accepted = false;
+            break;
+        }
+        Set_FlushingTime = lpcParam.lpc_flush;
         log_nominal("TC: Changing Flushing Time");
         ZephyrLogFine("TC: Changing Flushing Time");
         break;
     case SETWARMUPTIME:
-        Set_warmUpTime = lpcParam.warmUpTime; // todo: checking
+        if (!DurationOk(lpcParam.warmUpTime)) {
+            ZephyrLogWarn("TC: Invalid WarmUpTime");
+            accepted = false;
+            break;
+        }
+        Set_warmUpTime = lpcParam.warmUpTime;
         log_nominal("TC: Changing WarmUpTime");
         ZephyrLogFine("TC: Changing WarmUpTime");
         break;
     case SETCYCLETIME:
-        Set_cycleTime = lpcParam.setCycleTime; // todo: checking
+        if (!CycleTimeOk(lpcParam.setCycleTime)) {
+            ZephyrLogWarn("TC: Invalid CycleTime");
+            accepted = false;
+            break;
+        }
+        Set_cycleTime = lpcParam.setCycleTime;
         log_nominal("TC: Changing CycleTime");
         ZephyrLogFine("TC: Changing CycleTime");
         break;
     case SETSAMPLE:
-        Set_numberSamples = lpcParam.samples; // todo: checking
+        if (lpcParam.samples < 1 || !CycleFits(lpcParam.samples, Set_samplesToAverage)) {
+            ZephyrLogWarn("TC: Number of Samples exceeds the measurement arena");
+            accepted = false;
+            break;
+        }
+        if (lpcParam.samples % Set_samplesToAverage) {
+            ZephyrLogWarn("TC: Number of Samples is not a multiple of Samples to Average");
+            accepted = false;
+            break;
+        }
+        Set_numberSamples = lpcParam.samples;
         log_nominal("TC: Changing Number of Samples per Cycle");
         ZephyrLogFine("TC: Changing Number of Samples per Cycle");
         break;
     case SETSAMPLEAVG:
-        Set_samplesToAverage = lpcParam.samplesToAverage; // todo: checking
+        if (lpcParam.samplesToAverage < 1
+            || !CycleFits(Set_numberSamples, lpcParam.samplesToAverage)
+            || (Set_numberSamples % lpcParam.samplesToAverage)) {
+            ZephyrLogWarn("TC: Invalid Samples to Average");
+            accepted = false;
+            break;
+        }
+        Set_samplesToAverage = lpcParam.samplesToAverage;
         log_nominal("TC: Changing Samples to Average");
         ZephyrLogFine("TC: Changing Samples to Average");
         break;
@@ -87,6 +161,11 @@ bool StratoLPC::TCHandler(Telecommand_t telecommand)
         log_error("LG bins unimplemented");
         break;
     case SETPHA:
+        if (!PhaOk(lpcParam.phaHiGainThreshold, lpcParam.phaHiGainOffset, lpcParam.phaLoGainOffset)) {
+            ZephyrLogWarn("TC: Invalid PHA threshold or offsets");
+            accepted = false;
+            break;
+        }
         Set_phaHiGainThreshold = lpcParam.phaHiGainThreshold;
         Set_phaHiGainOffset = lpcParam.phaHiGainOffset;
         Set_phaLoGainOffset = lpcParam.phaLoGainOffset;
@@ -101,11 +180,21 @@ bool StratoLPC::TCHandler(Telecommand_t telecommand)
         ZephyrLogFine("TC: RS41 regen requested");
         break;
     case SETFLOW:
+        if (!BemfOk(lpcParam.flowSetpoint)) {
+            ZephyrLogWarn("TC: Invalid BEMF Flow Setpoint");
+            accepted = false;
+            break;
+        }
         BEMF1_SP = lpcParam.flowSetpoint;
         BEMF2_SP = lpcParam.flowSetpoint;
         ZephyrLogFine((String("TC: Updated BEMF Flow Setpoint to: ") + String(BEMF1_SP)).c_str());
         break;
     case SETPUMPTEMP:
+        if (!TemperatureOk(lpcParam.pumpMinTemp)) {
+            ZephyrLogWarn("TC: Invalid Pump Min Temp");
+            accepted = false;
+            break;
+        }
         PumpMinTemp = lpcParam.pumpMinTemp;
         ZephyrLogFine((String("TC: Updated Pump Min Temp to: ") + String(PumpMinTemp)).c_str());
         break;
@@ -113,7 +202,33 @@ bool StratoLPC::TCHandler(Telecommand_t telecommand)
         ZephyrLogWarn("Unknown TC received");
         break;
     }
-    return true;
+    SaveConfig();
+    // StratoCore sends the ACK (or NAK) as soon as this returns
+    LogTcLatency("TC");
+    return accepted;
+}
+
+FASTRUN void StratoLPC::DrainZephyrRx()
+{
+    uint8_t rx_char;
+    while (LPCZephyrRx::Pop(rx_char)) {
+        TakeZephyrByte(rx_char);
+    }
+}
+
+void StratoLPC::LogTcLatency(const char* command)
+{
+    // Only meaningful if the command has just arrived; modes are also
+    // entered at startup and autonomously.
+    uint32_t latency_us = micros() - LPCZephyrRx::LastByteMicros();
+    if (!LPCZephyrRx::Active() || latency_us > TC_LATENCY_WINDOW_US) {
+        return;
+    }
+    if (latency_us > _tc_latency_max_us) {
+        _tc_latency_max_us = latency_us;
+    }
+    log_nominal((String(command) + " latency from receipt: " + String(latency_us)
+        + " us (max " + String(_tc_latency_max_us) + " us)").c_str());
 }
 
 void StratoLPC::ActionHandler(uint8_t action)
@@ -124,9 +239,8 @@ void StratoLPC::ActionHandler(uint8_t action)
         return;
     }
 
-    // set the flag and reset the stale count
-    action_flags[action].flag_value = true;
-    action_flags[action].stale_count = 0;
+    // an action from the StratoCore scheduler fires immediately
+    _action_scheduler.Fire(action);
 }
 
 bool StratoLPC::CheckAction(uint8_t action)
@@ -138,27 +252,326 @@ bool StratoLPC::CheckAction(uint8_t action)
     }
 
     // check and clear the flag if it is set, return the value
-    if (action_flags[action].flag_value) {
-        action_flags[action].flag_value = false;
-        action_flags[action].stale_count = 0;
-        return true;
+    return _action_scheduler.Take(action);
+}
+
+void StratoLPC::WatchFlags()
+{
+    // fire due actions, and clear flags that were not taken in time
+    _action_scheduler.Poll();
+}
+
+FLASHMEM void StratoLPC::LogMemory()
+{
+    LPCMemReport mem;
+    LPCMemStats::Report(mem);
+    log_nominal((String("Stack used/size: ") + String(mem.stack_used) + "/" + String(mem.stack_size)
+        + " heap in use/peak: " + String(mem.heap_in_use) + "/" + String(mem.heap_peak)
+        + " free/largest: " + String(mem.heap_free) + "/" + String(mem.heap_largest)
+        + " allocs/frees/fails: " + String(mem.allocs) + "/" + String(mem.frees) + "/" + String(mem.alloc_failures)
+        + " arena peak: " + String(_arena.Peak()) + "/" + String(_arena.Size())).c_str());
+}
+
+FLASHMEM void StratoLPC::LogBoot()
+{
+    String Message = String(LPCBoot::WarmReset() ? "Warm" : "Cold") + " boot (reset cause 0x"
+        + String(LPCBoot::ResetCause(), HEX) + ") in " + String(LPCBoot::TotalMs()) + " ms:";
+    for (int stage = 0; stage < LPC_BOOT_N_STAGES; stage++) {
+        Message += String(" ") + LPCBoot::StageName((LPCBootStage)stage) + " "
+            + String(LPCBoot::StageUs((LPCBootStage)stage) / 1000.0f, 1);
+    }
+    log_nominal(Message.c_str());
+}
+
+void StratoLPC::GetConfig(lpcConfig_t& config)
+{
+    // config may be _config_saved
+    uint8_t pha_set = _config_saved.pha_set;
+    // zero the padding too, so that records can be compared with memcmp
+    memset(&config, 0, sizeof(config));
+    config.version = LPC_CONFIG_VERSION;
+    config.pha_set = pha_set;
+    config.defaults_crc = _config_defaults_crc;
+    config.numberSamples = Set_numberSamples;
+    config.samplesToAverage = Set_samplesToAverage;
+    config.cycleTime = Set_cycleTime;
+    config.warmUpTime = Set_warmUpTime;
+    config.laserTemp = Set_LaserTemp;
+    config.flushingTime = Set_FlushingTime;
+    config.phaHiGainThreshold = Set_phaHiGainThreshold;
+    config.phaHiGainOffset = Set_phaHiGainOffset;
+    config.phaLoGainOffset = Set_phaLoGainOffset;
+    config.pumpMinTemp = PumpMinTemp;
+    config.bemf1SP = BEMF1_SP;
+    config.bemf2SP = BEMF2_SP;
+    for (int i = 0; i < 17; i++) {
+        config.hgBinBoundaries[i] = (uint8_t)Set_HGBinBoundaries[i];
+        config.lgBinBoundaries[i] = (uint8_t)Set_LGBinBoundaries[i];
+    }
+    config.rateTriggers = _rate_policy.Triggers();
+    for (int b = 0; b < LPC_RATE_N_BANDS; b++) {
+        config.rateBands[b] = _rate_policy.Band(b);
+    }
+}
+
+FLASHMEM void StratoLPC::RestoreConfig()
+{
+    // A record is only applied over the defaults it was changed from, so
+    // that a build with new defaults (e.g. for another instrument) starts
+    // from them rather than from settings made for the old ones
+    GetConfig(_config_saved);
+    _config_defaults_crc = LPCConfigJournal::Crc(&_config_saved, sizeof(_config_saved));
+    _config_saved.defaults_crc = _config_defaults_crc;
+
+    if (!LPC_CONFIG_PERSIST) {
+        return;
+    }
+    lpcConfig_t config;
+    if (!_config_journal.Restore(&config)) {
+        log_nominal("No saved configuration, using the defaults");
+        return;
+    }
+    if ((config.version != LPC_CONFIG_VERSION) || (config.defaults_crc != _config_defaults_crc)) {
+        log_nominal("Saved configuration is for other defaults, using the defaults");
+        return;
+    }
+
+    // samplesToAverage is checked first, as the others divide by it
+    if ((config.samplesToAverage >= 1) && (config.numberSamples >= 1)
+        && CycleFits(config.numberSamples, config.samplesToAverage)
+        && !(config.numberSamples % config.samplesToAverage)) {
+        Set_numberSamples = config.numberSamples;
+        Set_samplesToAverage = config.samplesToAverage;
+    } else {
+        log_error("Saved samples per cycle are invalid or do not fit the measurement arena");
+    }
+    // Each setting is checked as its telecommand is, and one out of range
+    // is left at its default
+    String rejected = "";
+    if (CycleTimeOk(config.cycleTime)) {
+        Set_cycleTime = config.cycleTime;
+    } else {
+        rejected += " cycle";
+    }
+    if (DurationOk(config.warmUpTime)) {
+        Set_warmUpTime = config.warmUpTime;
+    } else {
+        rejected += " warmup";
+    }
+    if (TemperatureOk(config.laserTemp)) {
+        Set_LaserTemp = config.laserTemp;
+    } else {
+        rejected += " laser";
+    }
+    if (DurationOk(config.flushingTime)) {
+        Set_FlushingTime = config.flushingTime;
+    } else {
+        rejected += " flush";
+    }
+    if (config.pha_set) {
+        if (PhaOk(config.phaHiGainThreshold, config.phaHiGainOffset, config.phaLoGainOffset)) {
+            // the PHA has its power-on settings, so send them again at warm up
+            Set_phaHiGainThreshold = config.phaHiGainThreshold;
+            Set_phaHiGainOffset = config.phaHiGainOffset;
+            Set_phaLoGainOffset = config.phaLoGainOffset;
+            Set_triggerPHAconfig = true;
+        } else {
+            rejected += " pha";
+            config.pha_set = 0;
+        }
+    }
+    if (TemperatureOk(config.pumpMinTemp)) {
+        PumpMinTemp = config.pumpMinTemp;
+    } else {
+        rejected += " pumptemp";
+    }
+    if (BemfOk(config.bemf1SP) && BemfOk(config.bemf2SP)) {
+        BEMF1_SP = config.bemf1SP;
+        BEMF2_SP = config.bemf2SP;
+    } else {
+        rejected += " flow";
+    }
+    if (BinsOk(config.hgBinBoundaries, 17) && BinsOk(config.lgBinBoundaries, 17)) {
+        for (int i = 0; i < 17; i++) {
+            Set_HGBinBoundaries[i] = config.hgBinBoundaries[i];
+            Set_LGBinBoundaries[i] = config.lgBinBoundaries[i];
+        }
     } else {
+        rejected += " bins";
+    }
+    _rate_policy.SetTriggers(config.rateTriggers & (LPC_RATE_TRIGGER_ASCENT | LPC_RATE_TRIGGER_DESCENT | LPC_RATE_TRIGGER_BAND));
+    for (int b = 0; b < LPC_RATE_N_BANDS; b++) {
+        if (!_rate_policy.SetBand(b, config.rateBands[b].low_m, config.rateBands[b].high_m)) {
+            rejected += String(" band") + String(b);
+        }
+    }
+    if (rejected.length()) {
+        log_error((String("Saved settings out of range, using the defaults:") + rejected).c_str());
+    }
+
+    _config_saved.pha_set = config.pha_set;
+    GetConfig(_config_saved);
+    log_nominal((String("Restored configuration ") + String(_config_journal.Sequence())
+        + ": cycle " + String(Set_cycleTime) + " min, samples " + String(Set_numberSamples)
+        + "x" + String(Set_samplesToAverage)).c_str());
+}
+
+bool StratoLPC::BinsOk(const uint8_t* boundaries, int n)
+{
+    // fillBins() reads channels [boundaries[m], boundaries[m + 1])
+    for (int i = 1; i < n; i++) {
+        if ((boundaries[i] < boundaries[i - 1]) || (boundaries[i] >= PHA_CHANNELS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StratoLPC::SaveConfig()
+{
+    if (!LPC_CONFIG_PERSIST) {
+        return;
+    }
+    lpcConfig_t config;
+    GetConfig(config);
+    if (Set_triggerPHAconfig) {
+        config.pha_set = 1;
+    }
+    if (memcmp(&config, &_config_saved, sizeof(config)) == 0) {
+        return;
+    }
+    _config_journal.Save(&config);
+    _config_saved = config;
+}
+
+void StratoLPC::SetRateTriggers(uint8_t triggers)
+{
+    _rate_policy.SetTriggers(triggers);
+    log_nominal((String("Rate policy triggers: ascent ") + String((triggers & LPC_RATE_TRIGGER_ASCENT) ? 1 : 0)
+        + " descent " + String((triggers & LPC_RATE_TRIGGER_DESCENT) ? 1 : 0)
+        + " band " + String((triggers & LPC_RATE_TRIGGER_BAND) ? 1 : 0)).c_str());
+    SaveConfig();
+}
+
+bool StratoLPC::SetRateBand(uint8_t band, float low_m, float high_m)
+{
+    if (!_rate_policy.SetBand(band, low_m, high_m)) {
+        ZephyrLogWarn("Invalid rate policy band");
         return false;
     }
+    log_nominal((String("Rate policy band ") + String(band) + ": " + String(low_m, 0)
+        + " to " + String(high_m, 0) + " m").c_str());
+    SaveConfig();
+    return true;
 }
 
-void StratoLPC::WatchFlags()
+void StratoLPC::rateUpdate()
 {
-    // monitor for and clear stale flags
-    for (int i = 0; i < NUM_ACTIONS; i++) {
-        if (action_flags[i].flag_value) {
-            action_flags[i].stale_count++;
-            if (action_flags[i].stale_count >= FLAG_STALE) {
-                action_flags[i].flag_value = false;
-                action_flags[i].stale_count = 0;
-            }
+    if (!_rate_policy.Update((uint32_t)now(), zephyrRX.zephyr_gps.altitude)) {
+        return;
+    }
+
+    String Message = String("LPC ") + LPCRatePolicy::ModeName(_rate_policy.Mode()) + " sampling at "
+        + String(_rate_policy.Altitude(), 0) + " m";
+    if (_rate_policy.RateValid()) {
+        Message += String(", ") + String(_rate_policy.VerticalRate(), 1) + " m/s";
+    }
+    uint8_t active = _rate_policy.Active();
+    if (active & LPC_RATE_TRIGGER_ASCENT) {
+        Message += ", ascent";
+    }
+    if (active & LPC_RATE_TRIGGER_DESCENT) {
+        Message += ", descent";
+    }
+    if (active & LPC_RATE_TRIGGER_BAND) {
+        Message += ", band";
+    }
+    ZephyrLogFine(Message.c_str());
+    rateReport();
+
+    bool continuous = _rate_policy.Mode() == LPC_RATE_CONTINUOUS;
+    _rate_start_pending = continuous;
+    if (RS41_AGGREGATE_TM_WITH_LPC) {
+        rs41SetAggregateTm(continuous || RS41_AGGREGATE_TM);
+    }
+}
+
+void StratoLPC::rateReport()
+{
+    for (int mode = 0; mode < LPC_RATE_N_MODES; mode++) {
+        const LPCRateBudget& budget = _rate_policy.Budget((LPCRateMode)mode);
+        // mean power while measuring
+        float watts = budget.measure_secs ? budget.energy_j / budget.measure_secs : 0;
+        log_nominal((String("Rate mode ") + LPCRatePolicy::ModeName((LPCRateMode)mode)
+            + ": " + String(budget.secs / 3600.0f, 2) + " h, measuring "
+            + String(budget.secs ? budget.measure_secs * 100.0f / budget.secs : 0, 0) + "%, "
+            + String(budget.cycles) + " cycles, TM " + String(budget.tm_bytes / 1024.0f, 1)
+            + " KB, " + String(budget.energy_j / 3600.0f, 2) + " Wh (" + String(watts, 1) + " W)").c_str());
+    }
+}
+
+FLASHMEM void StratoLPC::SendMemoryTelemetry()
+{
+    LPCMemReport mem;
+    LPCMemStats::Report(mem);
+
+    // Warn when the stack is within 10% of the end of DTCM, or the heap
+    // can no longer satisfy a 4 KB allocation
+    bool stack_ok = mem.stack_used < mem.stack_size - mem.stack_size / 10;
+    bool heap_ok = (mem.heap_largest >= 4096) && !mem.alloc_failures;
+
+    String Message = "";
+    zephyrTX.setStateFlagValue(1, stack_ok ? FINE : WARN);
+    Message.concat(mem.stack_used);
+    Message.concat(',');
+    Message.concat(mem.stack_size);
+    zephyrTX.setStateDetails(1, Message);
+
+    // Set StateMess2 to "MEM" so that TM decoders can distinguish it
+    zephyrTX.setStateFlagValue(2, heap_ok ? FINE : WARN);
+    Message = "MEM";
+    zephyrTX.setStateDetails(2, Message);
+
+    zephyrTX.addTm((uint32_t)now());
+    zephyrTX.addTm((uint32_t)(millis() / 1000));
+    zephyrTX.addTm(mem.stack_used);
+    zephyrTX.addTm(mem.stack_size);
+    zephyrTX.addTm(mem.heap_in_use);
+    zephyrTX.addTm(mem.heap_peak);
+    zephyrTX.addTm(mem.heap_free);
+    zephyrTX.addTm(mem.heap_largest);
+    zephyrTX.addTm(mem.allocs);
+    zephyrTX.addTm(mem.frees);
+    zephyrTX.addTm(mem.alloc_failures);
+    zephyrTX.addTm((uint32_t)_arena.Peak());
+    zephyrTX.addTm((uint32_t)_arena.Size());
+    // The last boot: reset cause, then ms to the first loop pass
+    zephyrTX.addTm(LPCBoot::ResetCause());
+    zephyrTX.addTm(LPCBoot::TotalMs());
+
+    zephyrTX.TM();
+}
+
+FLASHMEM void StratoLPC::ReportActionJitter()
+{
+    static const char* action_names[NUM_ACTIONS] = {
+        "NO_ACTION", "SEND_IMR", "START_WARMUP", "START_FLUSH",
+        "START_MEASUREMENT", "RESEND_SAFETY", "RS41_SAMPLE", "MEM_REPORT",
+        "RATE_POLICY"
+    };
+
+    for (int i = NO_ACTION + 1; i < NUM_ACTIONS; i++) {
+        const LPCActionStats& stats = _action_scheduler.Stats(i);
+        if (!stats.count && !stats.stale) {
+            continue;
         }
+        log_nominal((String(action_names[i]) + " n:" + String(stats.count)
+            + " late ms min/mean/max:" + String(stats.count ? stats.late_min_ms : 0)
+            + "/" + String(stats.count ? stats.late_sum_ms / stats.count : 0)
+            + "/" + String(stats.late_max_ms)
+            + " missed:" + String(stats.missed) + " stale:" + String(stats.stale)).c_str());
     }
+    _action_scheduler.ResetStats();
 }
 
 void StratoLPC::LPC_Shutdown()
@@ -174,54 +587,56 @@ void StratoLPC::LPC_Shutdown()
     
     //digitalWrite(MFS_POWER, LOW); //Turn off AFS
     digitalWrite(PHA_POWER, LOW); //Turn off Optical Head
+    // Drop the rest of the last frame, which nothing reads until the next
+    // cycle and which would otherwise keep waking the event loop
+    while (OPCSERIAL.available()) {
+        OPCSERIAL.read();
+    }
+    // A configuration cut short is sent again at the next warm up, and the
+    // PHA starts at its base rate again
+    _pha_baud.Stop();
+    if (_pha_cmd.Stop()) {
+        Set_triggerPHAconfig = true;
+    }
     digitalWrite(HEATER1, LOW); //Turn off Laser Heater
     digitalWrite(HEATER2, LOW); //Turn of unused heater
 }
 
-TimeElements StratoLPC::Get_Next_Hour()
+time_t StratoLPC::PlanNextCycle(time_t t)
 {
-    /* Returns a Time Elements struct of the next whole hour to sync up measurements
-     with the clock */
-    
-    int32_t current_time;
-    TimeElements temp_time;
-    
-    current_time = now();
-    breakTime(current_time, temp_time);
-    
-    if(temp_time.Minute + Set_cycleTime < 60)
-    {
-        temp_time.Minute = temp_time.Minute + (Set_cycleTime - temp_time.Minute%Set_cycleTime); 
-        temp_time.Second = 0; //zero seconds
+    /* Cycles start on a fixed grid of multiples of Set_cycleTime since the
+     epoch, so they are aligned to the hour when Set_cycleTime divides 60.
+     If a grid point that has not been planned yet went by less than
+     CYCLE_CATCHUP_SECS ago, that cycle is started late; otherwise the
+     next grid point is used and any passed over are counted as skipped. */
+
+    // SETCYCLETIME is checked, but a zero period must never get here
+    time_t period = (time_t)(Set_cycleTime >= 1 ? Set_cycleTime : 1) * 60;
+    time_t previous = t - t % period;
+    time_t next;
+
+    if ((previous > _cycle_planned_start) && (t - previous <= CYCLE_CATCHUP_SECS)) {
+        next = previous;
+    } else {
+        next = previous + period;
     }
-    
-    else
-    {
-        if(temp_time.Hour < 23)
-        {
-            temp_time.Hour += 1 ;  //advance the hour buy one /* Set this back to 1 */
-            temp_time.Minute = 0;
-        }
-        else
-        {
-            temp_time.Hour = 0;  //unless it is the end of the day
-            temp_time.Day += 1; //then we add one to the day and zero hours
-            temp_time.Minute = 0;
+
+    if (_cycle_planned_start) {
+        time_t missed = (next - _cycle_planned_start) / period - 1;
+        if (missed > 0) {
+            _cycles_skipped += missed;
         }
     }
-
-    return temp_time;
+    _cycle_planned_start = next;
+    return next;
 }
 
-/*
-int32_t StratoLPC::Next_Start_Time(int32_t LastStartTime)
+void StratoLPC::ScheduleNextCycle()
 {
-    
-    
-    Serial.print("Next Start Time: ");
-    Serial.println(new_start_time);
+    time_t next = PlanNextCycle(now());
+    _action_scheduler.ScheduleAt(START_WARMUP, next);
+    log_nominal((String("Next measurement scheduled for: ") + TimeString(next)).c_str());
 }
-*/
 
 void StratoLPC::ReadHK(int record)
 {
@@ -249,37 +664,41 @@ void StratoLPC::ReadHK(int record)
   IDetector = (ID_Bits/i)/1.058; //Detector Current in mA
 
 
-    HKData[0][record] = (uint16_t) (now() - MeasurementStartTime); //save the elapsed time since we started.
-    HKData[1][record] = (uint16_t) IPump1; //Current in mA
-    HKData[2][record] = (uint16_t) IPump2; //Current in mA
+    HKData[0][record % _cycle_records] = (uint16_t) (now() - MeasurementStartTime); //save the elapsed time since we started.
+    HKData[1][record % _cycle_records] = (uint16_t) IPump1; //Current in mA
+    HKData[2][record % _cycle_records] = (uint16_t) IPump2; //Current in mA
     IHeater1 = analogRead(HEATER1_I)/1.058;
-    HKData[3][record] = (uint16_t) IDetector;  //Current in mA
+    HKData[3][record % _cycle_records] = (uint16_t) IDetector;  //Current in mA
     VDetector = analogRead(PHA_12V_V)*3.3/4095.0*5.993;
-    HKData[4][record] = (uint16_t) (VDetector * 1000.0);  //Volts in mV
+    HKData[4][record % _cycle_records] = (uint16_t) (VDetector * 1000.0);  //Volts in mV
     VPHA = analogRead(PHA_3V3_V)*3.3/4095.0*2.0;
-    HKData[5][record] = (uint16_t) (VPHA * 1000.0); //Volts in mV
+    HKData[5][record % _cycle_records] = (uint16_t) (VPHA * 1000.0); //Volts in mV
     VTeensy = analogRead(TEENSY_3V3)*3.3/4095.0*2.0;
-    HKData[6][record] = (uint16_t) (VTeensy * 1000.0); //volte in mV
+    HKData[6][record % _cycle_records] = (uint16_t) (VTeensy * 1000.0); //volte in mV
     VBat = analogRead(BATTERY_V)*3.3/4095.0 *6.772;
-    HKData[7][record] = (uint16_t) (VBat * 1000.0);
+    HKData[7][record % _cycle_records] = (uint16_t) (VBat * 1000.0);
+    // pumps and optical head since the last HK read, for the rate mode budget
+    uint32_t hk_ms = millis();
+    _rate_policy.AddEnergy(_cycle_rate_mode, VBat * (IPump1 + IPump2 + IDetector) / 1000.0f * (hk_ms - _hk_last_ms) / 1000.0f);
+    _hk_last_ms = hk_ms;
     Flow = getFlow(); //get the flow in LPM
-    HKData[8][record] = (uint16_t)(Flow * 1000); //Flow in ccm
-    HKData[9][record] = (uint16_t)BEMF1_pwm;
-    HKData[10][record] = (uint16_t)BEMF2_pwm;
+    HKData[8][record % _cycle_records] = (uint16_t)(Flow * 1000); //Flow in ccm
+    HKData[9][record % _cycle_records] = (uint16_t)BEMF1_pwm;
+    HKData[10][record % _cycle_records] = (uint16_t)BEMF2_pwm;
 //    VMotors = analogRead(MOTOR_V_MON)*3.0/4095.0*5.993;
-//    HKData[10][record] = (uint16_t) (VMotors * 1000.0);
+//    HKData[10][record % _cycle_records] = (uint16_t) (VMotors * 1000.0);
     
     /* Reads temperatures from the LTC part*/
     TempPump1 = OPC.MeasureLTC2983(4);
-    HKData[11][record] = (uint16_t) (TempPump1 + 273.15) * 100.0; //Kelvin * 100
+    HKData[11][record % _cycle_records] = (uint16_t) (TempPump1 + 273.15) * 100.0; //Kelvin * 100
     TempPump2 = OPC.MeasureLTC2983(6);
-    HKData[12][record] = (uint16_t) (TempPump2 + 273.15) * 100.0; //Kelvin * 100
+    HKData[12][record % _cycle_records] = (uint16_t) (TempPump2 + 273.15) * 100.0; //Kelvin * 100
     TempLaser = OPC.MeasureLTC2983(8);
-    HKData[13][record] = (uint16_t) (TempLaser + 273.15) * 100.0; //Kelvin * 100
+    HKData[13][record % _cycle_records] = (uint16_t) (TempLaser + 273.15) * 100.0; //Kelvin * 100
     TempPCB = OPC.MeasureLTC2983(12);
-    HKData[14][record] = (uint16_t) (TempPCB + 273.15) * 100.0; //Kelvin * 100
+    HKData[14][record % _cycle_records] = (uint16_t) (TempPCB + 273.15) * 100.0; //Kelvin * 100
     TempInlet = OPC.MeasureLTC2983(10);
-    HKData[15][record] = (uint16_t) (TempInlet + 273.15) * 100.0; //Kelvin * 100
+    HKData[15][record % _cycle_records] = (uint16_t) (TempInlet + 273.15) * 100.0; //Kelvin * 100
     
 }
 
@@ -306,6 +725,11 @@ void StratoLPC::CheckTemps(void)
     
 }
 
+bool StratoLPC::PumpsWarm()
+{
+    return (OPC.MeasureLTC2983(4) >= PumpMinTemp) && (OPC.MeasureLTC2983(6) >= PumpMinTemp);
+}
+
 void StratoLPC::AdjustPumps()
 {
   int i = 0;
@@ -355,7 +779,7 @@ float StratoLPC::getFlow()
     return flow;
 }
 
-int StratoLPC::parsePHA(int charsToParse) {
+FASTRUN int StratoLPC::parsePHA(int charsToParse) {
     /*This Function parses the char string from the PHA into two integer arrays containing
      * the PHA HG and LG arrays.  We can then down sample to 'bins'.
      */
@@ -363,8 +787,8 @@ int StratoLPC::parsePHA(int charsToParse) {
     char * strtokIndx; // this is used by strtok() as an index
     int i;
     
-    memset(LGArray, -999, sizeof(LGArray)); //initialize int arays to -999 so we
-    memset(HGArray, -999, sizeof(HGArray)); //know if there are missing values.
+    memset(LGArray, -999, PHA_CHANNELS * sizeof(int)); //initialize int arays to -999 so we
+    memset(HGArray, -999, PHA_CHANNELS * sizeof(int)); //know if there are missing values.
     
     //DEBUG_SERIAL.print("PHA Array as passed to parsePHA: ");
     //DEBUG_SERIAL.println(PHAArray);
@@ -405,7 +829,7 @@ int StratoLPC::parsePHA(int charsToParse) {
     
 }
 
-void StratoLPC::fillBins(int record, int SamplesToCoAdd)
+FASTRUN void StratoLPC::fillBins(int record, int SamplesToCoAdd)
 {
     int m = 0;
     int n = 0;
@@ -436,12 +860,222 @@ void StratoLPC::fillBins(int record, int SamplesToCoAdd)
     
     for(m = 0; m < 16; m++)
     {
-        BinData[m][record/SamplesToCoAdd] += (uint16_t) HGBins[m];
-        BinData[m+16][record/SamplesToCoAdd] += (uint16_t) LGBins[m];
+        BinData[m][(record/SamplesToCoAdd) % _cycle_records] += (uint16_t) HGBins[m];
+        BinData[m+16][(record/SamplesToCoAdd) % _cycle_records] += (uint16_t) LGBins[m];
+    }
+}
+
+FLASHMEM void StratoLPC::AllocateArena()
+{
+    _arena.Reset();
+    PHAArray = _arena.AllocArray<char>(PHA_BUFFER_SIZE + 2);  // parsePHA() terminates one past the data
+    LGArray = _arena.AllocArray<int>(PHA_CHANNELS);
+    HGArray = _arena.AllocArray<int>(PHA_CHANNELS);
+    _rs41_samples = _arena.AllocArray<rs41TmSample_t>(RS41_N_SAMPLES_TO_REPORT);
+    _rs41_aggregates = _arena.AllocArray<rs41TmAggregate_t>(RS41_N_AGGREGATES_TO_REPORT);
+    if (RS41_TM_FORMAT == 2) {
+        _rs41_packed = _arena.AllocArray<uint8_t>(RS41_TM_BYTES(RS41_N_SAMPLES_TO_REPORT));
+    }
+    _arena_cycle_mark = _arena.Mark();
+
+    log_nominal((String("Measurement arena: ") + String(_arena_cycle_mark)
+        + " of " + String(_arena.Size()) + " bytes fixed").c_str());
+    CarveCycleBuffers();
+}
+
+int StratoLPC::CycleRecords(int samples, int samples_to_average)
+{
+    if (LPC_STREAM_CHUNK_RECORDS) {
+        return LPC_STREAM_CHUNK_RECORDS;
+    }
+    return samples / samples_to_average;
+}
+
+bool StratoLPC::CycleFits(int samples, int samples_to_average)
+{
+    if (samples_to_average < 1) {
+        return false;
+    }
+    // Record buffers are only ever carved above the mark
+    size_t bytes = (size_t)LPC_RECORD_BUFFERS * (32 + 16)
+        * CycleRecords(samples, samples_to_average) * sizeof(uint16_t);
+    return bytes + 8 <= _arena.Size() - _arena_cycle_mark;
+}
+
+int StratoLPC::BufferRecords()
+{
+    int records = CycleRecords(Set_numberSamples, Set_samplesToAverage);
+    if (!CycleFits(Set_numberSamples, Set_samplesToAverage)) {
+        // TCs are checked against the arena, so only a bad default gets here
+        records = (_arena.Size() - _arena_cycle_mark - 8) / (LPC_RECORD_BUFFERS * (32 + 16) * sizeof(uint16_t));
+    }
+    if (records < 1) {
+        records = 1;
     }
+    return records;
 }
 
-void StratoLPC::PackageTelemetry(int Records)
+void StratoLPC::CarveCycleBuffers()
+{
+    int records = BufferRecords();
+    if (!CycleFits(Set_numberSamples, Set_samplesToAverage)) {
+        log_error((String("Cycle does not fit the measurement arena, limited to ")
+            + String(records) + " records").c_str());
+    }
+
+    _arena.Release(_arena_cycle_mark);
+    for (int b = 0; b < LPC_RECORD_BUFFERS; b++) {
+        LPCCycle_t& cycle = _cycle_buffers[b];
+        uint16_t* rows = _arena.AllocArray<uint16_t>((32 + 16) * records);
+        for (int m = 0; m < 32; m++) {
+            cycle.bins[m] = rows + m * records;
+        }
+        for (int n = 0; n < 16; n++) {
+            cycle.hk[n] = rows + (32 + n) * records;
+        }
+        cycle.capacity = records;
+        ClearCycle(cycle);
+    }
+
+    _cycle_records = records;
+    _acquire_buffer = 0;
+    BinData = _cycle_buffers[0].bins;
+    HKData = _cycle_buffers[0].hk;
+}
+
+void StratoLPC::ClearCycle(LPCCycle_t& cycle)
+{
+    // The rows of a buffer are contiguous
+    memset(cycle.bins[0], 0, (32 + 16) * cycle.capacity * sizeof(uint16_t));
+}
+
+void StratoLPC::StartCycle()
+{
+    if (BufferRecords() != _cycle_records) {
+        // The buffers must be idle before they are re-carved. The last
+        // cycle is normally archived long before warm up and flush are over.
+        while (_archive_pending || _archive_state != ARCHIVE_IDLE) {
+            RunArchive();
+        }
+        CarveCycleBuffers();
+    } else {
+        // Acquire into the free buffer while the last cycle is archived
+        // from the other; clear any partial records an FL_ERROR cycle left
+        ClearCycle(_cycle_buffers[_acquire_buffer]);
+    }
+    _chunk_seq = 0;
+    _chunk_first_record = 0;
+    _cycle_rate_mode = _rate_policy.Mode();
+    _hk_last_ms = millis();
+}
+
+void StratoLPC::RecordComplete(int record)
+{
+    if (LPC_STREAM_CHUNK_RECORDS && ((record + 1) % _cycle_records == 0)) {
+        QueueRecords(_cycle_records, false);
+    }
+}
+
+bool StratoLPC::CycleFull()
+{
+    // When streaming, the chunk buffers are reused as the cycle goes on
+    return !LPC_STREAM_CHUNK_RECORDS && (Frame / Set_samplesToAverage >= _cycle_records);
+}
+
+void StratoLPC::FinishCycle(int Records)
+{
+    if (Records - _chunk_first_record > _cycle_records) {
+        // a guard; CycleFull() ends the cycle before records wrap around
+        Records = _chunk_first_record + _cycle_records;
+    }
+    // When streaming this may be an empty chunk, which marks the end
+    QueueRecords(Records - _chunk_first_record, true);
+    _chunk_seq = 0;
+    _chunk_first_record = 0;
+}
+
+void StratoLPC::QueueRecords(int Records, bool final)
+{
+    // The next buffer must be free before acquisition switches to it.
+    // FL_SEND_TELEMETRY waits for that without blocking (RecordBufferFree),
+    // and archiving is much faster than acquisition, so this should not wait.
+    if (!RecordBufferFree()) {
+        log_error("LPC record buffers full, waiting for archive");
+        while (!RecordBufferFree()) {
+            RunArchive();
+        }
+    }
+
+    LPCCycle_t& cycle = _cycle_buffers[_acquire_buffer];
+    cycle.records = Records;
+    cycle.chunk = _chunk_seq;
+    cycle.first_record = _chunk_first_record;
+    cycle.final = final;
+    cycle.start_time = MeasurementStartTime;
+    cycle.temp_pump1 = TempPump1;
+    cycle.temp_pump2 = TempPump2;
+    cycle.temp_laser = TempLaser;
+    cycle.vbat = VBat;
+    cycle.latitude = zephyrRX.zephyr_gps.latitude;
+    cycle.longitude = zephyrRX.zephyr_gps.longitude;
+    cycle.altitude = zephyrRX.zephyr_gps.altitude;
+    cycle.duty = (float)_cycles_run * 100.0 / (float)(_cycles_run + _cycles_skipped);
+    cycle.start_error = _cycle_start_error;
+    cycle.arena_peak = _arena.Peak();
+    cycle.rate_mode = _cycle_rate_mode;
+    _archive_pending++;
+    _chunk_seq++;
+    _chunk_first_record += Records;
+
+    _acquire_buffer = (_acquire_buffer + 1) % LPC_RECORD_BUFFERS;
+    BinData = _cycle_buffers[_acquire_buffer].bins;
+    HKData = _cycle_buffers[_acquire_buffer].hk;
+}
+
+void StratoLPC::RunArchive()
+{
+    switch (_archive_state) {
+    case ARCHIVE_IDLE:
+        if (_archive_pending) {
+            // the oldest queued buffer
+            _archive_cycle = &_cycle_buffers[(_acquire_buffer + LPC_RECORD_BUFFERS - _archive_pending) % LPC_RECORD_BUFFERS];
+            _archive_state = ARCHIVE_SEND_TM;
+        }
+        break;
+    case ARCHIVE_SEND_TM:
+        PackageTelemetry(*_archive_cycle);
+        _archive_state = ARCHIVE_SD_OPEN;
+        break;
+    case ARCHIVE_SD_OPEN:
+        if (writeLPCHeaderToSD(*_archive_cycle)) {
+            _archive_record = 0;
+            _archive_state = ARCHIVE_SD_RECORDS;
+        } else {
+            _archive_state = ARCHIVE_SD_CLOSE;
+        }
+        break;
+    case ARCHIVE_SD_RECORDS: {
+        int last = _archive_record + LPC_ARCHIVE_RECORDS_PER_PASS;
+        if (last >= _archive_cycle->records) {
+            last = _archive_cycle->records;
+            _archive_state = ARCHIVE_SD_CLOSE;
+        }
+        writeLPCRecordsToSD(*_archive_cycle, _archive_record, last);
+        _archive_record = last;
+        break;
+    }
+    case ARCHIVE_SD_CLOSE:
+        closeLPCtoSD(_archive_cycle->final);
+        // zero the buffer so a later cycle can co-add into it
+        ClearCycle(*_archive_cycle);
+        _archive_cycle = nullptr;
+        _archive_pending--;
+        _archive_state = ARCHIVE_IDLE;
+        break;
+    }
+}
+
+void StratoLPC::PackageTelemetry(LPCCycle_t& cycle)
 {
     int m = 0;
     int n = 0;
@@ -451,15 +1085,15 @@ void StratoLPC::PackageTelemetry(int Records)
     bool flag2 = true;
     
     /* Check the values for the TM message header */
-    if ((TempPump1 > 60.0) || (TempPump1 < -30.0))
+    if ((cycle.temp_pump1 > 60.0) || (cycle.temp_pump1 < -30.0))
         flag1 = false;
-    if ((TempPump2 > 60.0) || (TempPump2 < -30.0))
+    if ((cycle.temp_pump2 > 60.0) || (cycle.temp_pump2 < -30.0))
         flag1 = false;
-    if ((TempLaser > 50.0) || (TempLaser < -30.0))
+    if ((cycle.temp_laser > 50.0) || (cycle.temp_laser < -30.0))
         flag1 = false;
     
     /*Check Voltages are in range */
-    if ((VBat > 18.0) || (VBat < 14.0))
+    if ((cycle.vbat > 18.0) || (cycle.vbat < 14.0))
         flag2 = false;
    
     
@@ -470,11 +1104,9 @@ void StratoLPC::PackageTelemetry(int Records)
         zephyrTX.setStateFlagValue(1, WARN);
     }
     
-    Message.concat(TempPump1);
-    Message.concat(',');
-    Message.concat(TempPump2);
-    Message.concat(',');
-    Message.concat(TempLaser);
+    char mess[LPC_STATE_MESS_MAX];
+    *FormatStateMess1(mess, cycle) = '\0';
+    Message = mess;
     zephyrTX.setStateDetails(1, Message);
     Message = "";
     
@@ -485,57 +1117,54 @@ void StratoLPC::PackageTelemetry(int Records)
         zephyrTX.setStateFlagValue(2, WARN);
     }
     
-    Message.concat(zephyrRX.zephyr_gps.latitude);
-    Message.concat(',');
-    Message.concat(zephyrRX.zephyr_gps.longitude);
-    Message.concat(',');
-    Message.concat(zephyrRX.zephyr_gps.altitude);
+    *FormatStateMess2(mess, cycle) = '\0';
+    Message = mess;
     zephyrTX.setStateDetails(2, Message);
     Message = "";
 
     /* Build the telemetry binary array */
     
     /* Add the initial timestamp */
-    zephyrTX.addTm(MeasurementStartTime);
+    zephyrTX.addTm(cycle.start_time);
     
-    for(n = 0; n < NumberHKChannels; n++) //add all the initial HK values
-    {
-        zephyrTX.addTm(HKData[n][0]);
-        HKData[n][m] = 0;
-        i++;
+    if (LPC_STREAM_CHUNK_RECORDS) {
+        // chunk header in place of the initial HK
+        zephyrTX.addTm(cycle.chunk);
+        zephyrTX.addTm(cycle.first_record);
+        zephyrTX.addTm((uint8_t)cycle.final);
+    } else {
+        for(n = 0; n < NumberHKChannels; n++) //add all the initial HK values
+        {
+            zephyrTX.addTm(cycle.hk[n][0]);
+            i++;
+        }
     }
     
-    for (m = 0; m < Records; m++)
+    for (m = 0; m < cycle.records; m++)
     {
         for( n = 0; n < (NumberLGBins + NumberHGBins); n++)
         {
-            zephyrTX.addTm(BinData[n][m]);
-            BinData[n][m] = 0;
+            zephyrTX.addTm(cycle.bins[n][m]);
             i++;
         
         }
         for(n = 0; n < NumberHKChannels; n++)
         {
-            zephyrTX.addTm(HKData[n][m]);
-            HKData[n][m] = 0;
+            zephyrTX.addTm(cycle.hk[n][m]);
             i++;
         }
     }
 
-    Serial.print("Sending Records: ");
-    Serial.println(m);
-    Serial.print("Sending Bytes: ");
-    Serial.println(i);
+    LPC_LOG(LOG_LPC_TM_SENT, m, i);
+    _rate_policy.AddTm(cycle.rate_mode, 4 + (LPC_STREAM_CHUNK_RECORDS ? 5 : 0) + 2 * i);
     
     /* send the TM packet to the OBC */
     zephyrTX.TM();
-
-    // Save data to local storage
-    writeLPCtoSD(Records);
 }
 
 void StratoLPC::phaConfig() {
-    if (!Set_triggerPHAconfig) {
+    // The PHA is only listening between warm up and shutdown
+    if (!Set_triggerPHAconfig || !_pha_cmd.Started()) {
         return;
     }
 
@@ -543,42 +1172,117 @@ void StratoLPC::phaConfig() {
     Set_triggerPHAconfig = false;
 
     // Verify parameters
-    if ((Set_phaHiGainThreshold >= 1024) ||
-        (Set_phaHiGainOffset >= 4096) ||
-        (Set_phaLoGainOffset >= 4096)) {
+    if (!PhaOk(Set_phaHiGainThreshold, Set_phaHiGainOffset, Set_phaLoGainOffset)) {
             log_error((
                 String("PHA config range error: ") +
-                String() + String(", ") +
-                String() + String(", ") +
-                String() + String(" ") +
+                String(Set_phaHiGainThreshold) + String(", ") +
+                String(Set_phaHiGainOffset) + String(", ") +
+                String(Set_phaLoGainOffset) + String(" ") +
                 String("PHA will not be configured")).c_str());
             return;
         }
 
-    // Send the commands to the PHA
-    String cmd;
+    // Queue the commands; a newer configuration replaces one still being sent.
+    // phaCommandLoop() sends them and reports the result.
+    _pha_cmd.Clear();
+    _pha_cmd.Queue("thresh", Set_phaHiGainThreshold);
+    _pha_cmd.Queue("hgoff", Set_phaHiGainOffset);
+    _pha_cmd.Queue("lgoff", Set_phaLoGainOffset);
+    // Have the PHA save the new values
+    _pha_cmd.Queue("save");
+    log_nominal((String("PHA configuration queued: thresh ") + String(Set_phaHiGainThreshold)
+        + " hgoff " + String(Set_phaHiGainOffset) + " lgoff " + String(Set_phaLoGainOffset)).c_str());
+}
+
+void StratoLPC::phaCommandLoop() {
+    _pha_cmd.Poll();
+    if (_pha_baud.Busy()) {
+        // the rate negotiation has the command queue to itself
+        if (_pha_baud.Poll()) {
+            phaLinkReport();
+        }
+        return;
+    }
+    phaConfig();
+    if (_pha_cmd.Finished()) {
+        phaReport();
+        _pha_cmd.Clear();
+    }
+}
 
-    delay(100);
-    cmd = String("#thresh,") + String(Set_phaHiGainThreshold) + String("\r");
-    OPCSERIAL.print(cmd.c_str());
-    log_nominal((String("PHA Hi Gain Threshold commanded: ") + cmd).c_str());
+void StratoLPC::phaLinkReport() {
+    if (_pha_baud.FailedRate()) {
+        log_error((String("PHA link failed at ") + String(_pha_baud.FailedRate()) + " baud").c_str());
+    }
+    String message = String("PHA link at ") + String(_pha_baud.Rate()) + " baud";
+    if (_pha_baud.Unsupported()) {
+        message += " (the PHA does not take #baud)";
+    }
+    uint32_t frame_bytes = _pha_cmd.LastFrameBytes();
+    if (frame_bytes) {
+        message += String(", a ") + String(frame_bytes) + " byte frame takes "
+            + String(LPCPHABaud::FrameMicros(frame_bytes, _pha_baud.Rate()) / 1000.0f, 1) + " ms ("
+            + String(LPCPHABaud::FrameMicros(frame_bytes, PHA_BAUD_BASE) / 1000.0f, 1) + " ms at "
+            + String(PHA_BAUD_BASE) + ")";
+    }
+    log_nominal(message.c_str());
+}
 
-    delay(100);
-    cmd = String("#hgoff,") + String(Set_phaHiGainOffset) + String("\r");
-    OPCSERIAL.print(cmd.c_str());
-    log_nominal((String("PHA Hi Gain Baseline Offset commanded: ") + cmd).c_str());
+void StratoLPC::phaReport() {
+    bool all_ok = true;
+    String report = "PHA configuration:";
+    for (int i = 0; i < _pha_cmd.Commands(); i++) {
+        const PHACommand_t& cmd = _pha_cmd.Command(i);
+        report += String(" ") + cmd.name;
+        if (cmd.value != PHA_CMD_NO_VALUE) {
+            report += String(" ") + String(cmd.value);
+        }
+        report += String(" ") + LPCPHACommand::StatusName(cmd.status);
+        if (cmd.sends > 1) {
+            report += String(" (") + String(cmd.sends) + " sends)";
+        }
+        all_ok = all_ok && (cmd.status != PHA_CMD_FAILED);
+    }
+    if (all_ok) {
+        ZephyrLogFine(report.c_str());
+    } else {
+        ZephyrLogWarn(report.c_str());
+    }
+}
 
-    delay(100);
-    cmd = String("#lgoff,") + String(Set_phaLoGainOffset) + String("\r");
-    OPCSERIAL.print(cmd.c_str());
-    log_nominal((String("PHA Lo Gain Baseline Offset commanded: ") + cmd).c_str());
-    delay(100);
+char* StratoLPC::FormatStateMess1(char* out, const LPCCycle_t& cycle)
+{
+    out = LPCFormatFixed(out, cycle.temp_pump1);
+    *out++ = ',';
+    out = LPCFormatFixed(out, cycle.temp_pump2);
+    *out++ = ',';
+    out = LPCFormatFixed(out, cycle.temp_laser);
+    // Cycle timeline: percentage of planned cycles that ran this flight,
+    // and the start time error of this cycle in seconds
+    *out++ = ',';
+    out = LPCFormatFixed(out, cycle.duty);
+    *out++ = ',';
+    out = LPCFormatInt(out, cycle.start_error);
+    // Peak measurement arena use, bytes
+    *out++ = ',';
+    return LPCFormatUInt(out, cycle.arena_peak);
+}
 
-    // Have the PHA save the new values
-    OPCSERIAL.print("#save\r");
+char* StratoLPC::FormatStateMess2(char* out, const LPCCycle_t& cycle)
+{
+    if (LPC_STREAM_CHUNK_RECORDS) {
+        // marks the chunked payload for the ground
+        out = LPCFormatText(out, LPC_CHUNK_TAG);
+        *out++ = ',';
+    }
+    out = LPCFormatFixed(out, cycle.latitude);
+    *out++ = ',';
+    out = LPCFormatFixed(out, cycle.longitude);
+    *out++ = ',';
+    return LPCFormatFixed(out, cycle.altitude);
 }
 
-void StratoLPC::writeLPCtoSD(int Records) {
+bool StratoLPC::writeLPCHeaderToSD(LPCCycle_t& cycle) {
 
     // We are building a facsimile of the TM message generated
     // by XMLwriter.
@@ -586,93 +1290,132 @@ void StratoLPC::writeLPCtoSD(int Records) {
     // XMLwriter doesn't keep a copy of the built XML header,
     // so we build that here.
     //
-    // XMLwriter does make avaiable a buffer of the binary payload,
-    // so we will use that to fill in the binary data.
+    // The XMLwriter TM buffer may have been reused (e.g. by the RS41 TM)
+    // by the time the records are written, so the binary payload is
+    // rebuilt from the cycle buffer in the same big-endian layout.
     //
     // There are 2 designed-in differences from the XMLwriter:
     //  - The Msg number is fixed at 0.
     //  - The CRC is not calculated. It is set to 0
 
-    String lpc_file_name = SDFileName("LPC_", ".ready_tm", now());
-    File lpc_file = SD.open(lpc_file_name.c_str(), FILE_WRITE);
-    if (!lpc_file) {
-        log_error((String("Unable to open ") + String(lpc_file_name)
-         + String(", LPC data will not be written")).c_str());
-        return;
+    // When streaming, each chunk is a TM message of its own, and all the
+    // chunks of a cycle go in the one file.
+    if (cycle.chunk == 0) {
+        _archive_file = SDFileName("LPC_", ".ready_tm", now());
+        if (!OPC.CreateFile(_archive_file.c_str(), LPC_FILE_PREALLOCATE)) {
+            log_error((String("Unable to open ") + String(_archive_file)
+             + String(", LPC data will not be written")).c_str());
+            _archive_file = "";
+            return false;
+        }
+        log_nominal((String("Writing LPC to ") + _archive_file).c_str());
+    } else if (_archive_file.length() == 0) {
+        return false;
     }
 
-    log_nominal((String("Writing LPC to ") + lpc_file_name).c_str());
+    const char* lpc_file = _archive_file.c_str();
     bool flag1 = true;
     bool flag2 = true;
-    uint8_t* tm_buffer;
-
-    // Fetch the length of the binary segment, and a pointer to the buffer.
-    uint16_t num_elements = zephyrTX.getTmBuffer(&tm_buffer);
 
-    if ((TempPump1 > 60.0) || (TempPump1 < -30.0)) {flag1 = false;}
-    if ((TempPump2 > 60.0) || (TempPump2 < -30.0)) {flag1 = false;}
-    if ((TempLaser > 50.0) || (TempLaser < -30.0)) {flag1 = false;}
-    if ((VBat > 18.0) || (VBat < 14.0)) {flag2 = false;}
-
-    String xml = "<TM>\n";
-    xml += "\t<Msg>0</Msg>\n";
-    xml += "\t<Inst>LPC</Inst>\n";
-
-    xml += "\t<StateFlag1>";
-    if (flag1) {
-        xml += "WARN";
+    // The length of the binary segment: start time, initial HK (or the
+    // chunk header), records
+    uint16_t header_bytes = LPC_STREAM_CHUNK_RECORDS
+        ? sizeof(cycle.start_time) + sizeof(cycle.chunk) + sizeof(cycle.first_record) + sizeof(uint8_t)
+        : sizeof(cycle.start_time) + sizeof(uint16_t) * NumberHKChannels;
+    uint16_t num_elements = header_bytes
+        + cycle.records * sizeof(uint16_t) * (NumberLGBins + NumberHGBins + NumberHKChannels);
+
+    if ((cycle.temp_pump1 > 60.0) || (cycle.temp_pump1 < -30.0)) {flag1 = false;}
+    if ((cycle.temp_pump2 > 60.0) || (cycle.temp_pump2 < -30.0)) {flag1 = false;}
+    if ((cycle.temp_laser > 50.0) || (cycle.temp_laser < -30.0)) {flag1 = false;}
+    if ((cycle.vbat > 18.0) || (cycle.vbat < 14.0)) {flag2 = false;}
+
+    char xml[192 + 2 * LPC_STATE_MESS_MAX];
+    char* p = xml;
+    p = LPCFormatText(p, "<TM>\n\t<Msg>0</Msg>\n\t<Inst>LPC</Inst>\n");
+    p = LPCFormatText(p, "\t<StateFlag1>");
+    p = LPCFormatText(p, flag1 ? "WARN" : "FINE");
+    p = LPCFormatText(p, "</StateFlag1>\n\t<StateMess1>");
+    p = FormatStateMess1(p, cycle);
+    p = LPCFormatText(p, "</StateMess1>\n\t<StateFlag2>");
+    p = LPCFormatText(p, flag2 ? "FINE" : "WARN");
+    p = LPCFormatText(p, "</StateFlag2>\n\t<StateMess2>");
+    p = FormatStateMess2(p, cycle);
+    p = LPCFormatText(p, "</StateMess2>\n\t<Length>");
+    p = LPCFormatUInt(p, num_elements);
+    p = LPCFormatText(p, "</Length></TM>\n<CRC>00000</CRC>\n");
+    OPC.WriteData(lpc_file, xml, p - xml);
+
+    OPC.WriteData(lpc_file, "START", 5);
+
+    // Start of the binary payload: start time and the initial HK values,
+    // or the chunk header
+    uint8_t be[4 + 2 * 16];
+    int k = 0;
+    be[k++] = (uint8_t)(cycle.start_time >> 24);
+    be[k++] = (uint8_t)(cycle.start_time >> 16);
+    be[k++] = (uint8_t)(cycle.start_time >> 8);
+    be[k++] = (uint8_t)cycle.start_time;
+    if (LPC_STREAM_CHUNK_RECORDS) {
+        be[k++] = highByte(cycle.chunk);
+        be[k++] = lowByte(cycle.chunk);
+        be[k++] = highByte(cycle.first_record);
+        be[k++] = lowByte(cycle.first_record);
+        be[k++] = (uint8_t)cycle.final;
     } else {
-        xml += "FINE";
+        for (int n = 0; n < NumberHKChannels; n++) {
+            be[k++] = highByte(cycle.hk[n][0]);
+            be[k++] = lowByte(cycle.hk[n][0]);
+        }
     }
-    xml += "</StateFlag1>\n";
-
-    xml += "\t<StateMess1>";
-    xml += String(TempPump1);
-    xml += String(',');
-    xml += String(TempPump2);
-    xml += String(',');
-    xml += String(TempLaser);
-    xml += "</StateMess1>\n";
+    OPC.WriteData(lpc_file, be, k);
+    return true;
+}
 
-    xml += "\t<StateFlag2>";
-    if (flag2) {
-        xml += "FINE";
-    } else {
-        xml += "WARN";
+void StratoLPC::writeLPCRecordsToSD(LPCCycle_t& cycle, int first, int last) {
+    if (_archive_file.length() == 0) {
+        return;
     }
-    xml += "</StateFlag2>\n";
-
-    xml += "\t<StateMess2>";
-    xml += String(zephyrRX.zephyr_gps.latitude);
-    xml += String(',');
-    xml += String(zephyrRX.zephyr_gps.longitude);
-    xml += String(',');
-    xml += String(zephyrRX.zephyr_gps.altitude);
-    xml += "</StateMess2>\n";
 
-    xml += "\t<Length>";
-    xml += String(num_elements);
-    xml += "</Length>";
-    xml += "</TM>\n";
+    // One record: the bins then the HK, big-endian like XMLWriter::addTm()
+    uint8_t be[2 * (32 + 16)];
+    for (int m = first; m < last; m++) {
+        int k = 0;
+        for (int n = 0; n < (NumberLGBins + NumberHGBins); n++) {
+            be[k++] = highByte(cycle.bins[n][m]);
+            be[k++] = lowByte(cycle.bins[n][m]);
+        }
+        for (int n = 0; n < NumberHKChannels; n++) {
+            be[k++] = highByte(cycle.hk[n][m]);
+            be[k++] = lowByte(cycle.hk[n][m]);
+        }
+        OPC.WriteData(_archive_file.c_str(), be, k);
+    }
+}
 
-    xml += "<CRC>00000</CRC>\n";
-    lpc_file.write(xml.c_str());
+void StratoLPC::closeLPCtoSD(bool final) {
+    if (_archive_file.length() == 0) {
+        return;
+    }
 
-    lpc_file.write("START");
-    
-    //Write the binary payload
-    lpc_file.write(tm_buffer, num_elements);
+    const char* lpc_file = _archive_file.c_str();
     uint16_t crc_zero = 0;
-    lpc_file.write(&crc_zero, sizeof(uint16_t));
-    lpc_file.write("END");
+    OPC.WriteData(lpc_file, &crc_zero, sizeof(uint16_t));
+    OPC.WriteData(lpc_file, "END", 3);
+    if (!final) {
+        return;
+    }
 
     // Finished
-    lpc_file.close();
-    log_nominal((lpc_file_name +String(" written")).c_str());
+    OPC.CloseFile(lpc_file);
+    log_nominal((_archive_file +String(" written")).c_str());
+    _archive_file = "";
 }
 
 void StratoLPC::rs41Start() {
-    scheduler.AddAction(RS41_SAMPLE, RS41_SAMPLE_PERIOD_SECS);
+    // Periodic on a fixed millisecond grid, starting at the next second
+    // boundary, so that samples do not drift with the loop timing
+    _action_scheduler.ScheduleAt(RS41_SAMPLE, now() + 1, RS41_SAMPLE_PERIOD_SECS * 1000UL);
     if (!_rs41_start_time) {
         _rs41_start_time = now();
     }
@@ -681,53 +1424,66 @@ void StratoLPC::rs41Start() {
 void StratoLPC::rs41Action() {
     if (CheckAction(RS41_SAMPLE)) {
         if (Set_rs41regen) {
+            // the library call blocks, but regeneration is rare and commanded
+            _rs41_reader.Cancel();
             log_nominal("RS41 regeneration initiated");
             log_nominal(_rs41.recondition().c_str());
             Set_rs41regen = false;
         }
 
-        // *** Get the RS41 measurement
-        RS41::RS41SensorData_t rs41_data = _rs41.decoded_sensor_data(false);
-
-        // Detect the initial clock update. THIS ASSUMES THAT THE
-        // SAMPLE RATE IS ONCE PER SECOND.
-        if (now() > (_rs41_start_time + RS41_N_SAMPLES_TO_REPORT)) {
-            // Set start time to now() minus the number of samples collected so far.
-            _rs41_start_time = now() - _n_rs41_samples - 1;
-        }
+        // The reply is collected by _rs41_reader.Poll() in InstrumentLoop()
+        _rs41_reader.Request(now());
+    }
 
-        // *** TM message handling
-        // Collect the RS41 sample for the TM message.
+    // *** Get a finished RS41 measurement, if there is one
+    RS41::RS41SensorData_t rs41_data;
+    time_t sample_time;
+    if (_rs41_reader.Take(rs41_data, sample_time)) {
         // Convert to the compressed telemetry format.
-        _rs41_samples[_n_rs41_samples].valid = rs41_data.valid;
-        _rs41_samples[_n_rs41_samples].secs = now() - _rs41_start_time;
-        _rs41_samples[_n_rs41_samples].tdry = (rs41_data.air_temp_degC+100)*100;
-        _rs41_samples[_n_rs41_samples].humidity = rs41_data.humdity_percent*100;
-        _rs41_samples[_n_rs41_samples].tsensor = (rs41_data.hsensor_temp_degC+100)*100;
-        _rs41_samples[_n_rs41_samples].pres = rs41_data.pres_mb*50;
-        _rs41_samples[_n_rs41_samples].error = rs41_data.module_error;
-        _n_rs41_samples++;
-
-        if (_n_rs41_samples == RS41_N_SAMPLES_TO_REPORT) {
-            // Transmit the RS41 data
-            rs41SendTelemetry(now(), _rs41_samples, _n_rs41_samples);
-            log_nominal(String("Transmit " + String(_n_rs41_samples) + " RS41 samples").c_str());
-            _n_rs41_samples = 0;
-            _rs41_start_time = now();
+        rs41TmSample_t sample;
+        sample.valid = rs41_data.valid;
+        sample.secs = 0;
+        sample.tdry = (rs41_data.air_temp_degC+100)*100;
+        sample.humidity = rs41_data.humdity_percent*100;
+        sample.tsensor = (rs41_data.hsensor_temp_degC+100)*100;
+        sample.pres = rs41_data.pres_mb*50;
+        sample.error = rs41_data.module_error;
+
+        if (_rs41_aggregate_tm) {
+            // *** Aggregated TM
+            rs41Aggregate(sample, sample_time);
+        } else {
+            // Detect the initial clock update. THIS ASSUMES THAT THE
+            // SAMPLE RATE IS ONCE PER SECOND.
+            if (sample_time > (time_t)(_rs41_start_time + RS41_N_SAMPLES_TO_REPORT)) {
+                // Set start time to the sample time minus the number of samples collected so far.
+                _rs41_start_time = sample_time - _n_rs41_samples - 1;
+            }
+
+            // *** TM message handling
+            // Collect the RS41 sample for the TM message.
+            sample.secs = sample_time - _rs41_start_time;
+            _rs41_samples[_n_rs41_samples] = sample;
+            _n_rs41_samples++;
+
+            if (_n_rs41_samples == RS41_N_SAMPLES_TO_REPORT) {
+                // Transmit the RS41 data
+                rs41SendTelemetry(now(), _rs41_samples, _n_rs41_samples);
+                log_nominal(String("Transmit " + String(_n_rs41_samples) + " RS41 samples").c_str());
+                _n_rs41_samples = 0;
+                _rs41_start_time = sample_time;
+            }
         }
 
         //*** Local storage handling
         if (time_valid) {
-            rs41LocalStorage(rs41_data);
+            rs41LocalStorage(rs41_data, sample_time);
         }
 
         // *** Console print
         if(RS41_DEBUG_PRINT) {
-            rs41PrintCsv(rs41_data);
+            rs41PrintCsv(rs41_data, sample_time);
         }
-
-        // *** Schedule the next measurement
-        rs41Start();
     }
 }
 
@@ -743,15 +1499,65 @@ void StratoLPC::rs41SendTelemetry(uint32_t time_stamp, rs41TmSample_t* rs41_samp
     sizeof(rs41_sample_array[0].pres) + 
     sizeof(rs41_sample_array[0].error); 
 
+    bool any_error = false;
+    bool all_valid = true;
+    for (int i = 0; i < n_samples; i++) {
+        any_error = any_error || rs41_sample_array[i].error;
+        all_valid = all_valid && rs41_sample_array[i].valid;
+    }
+
+    size_t packed_bytes = 0;
+    if (RS41_TM_FORMAT == 2 && _rs41_packed) {
+        packed_bytes = LPCRS41Pack(rs41_sample_array, n_samples, _rs41_start_time,
+                                   _rs41_packed, RS41_TM_BYTES(RS41_N_SAMPLES_TO_REPORT));
+    }
+    if (packed_bytes) {
+        rs41TelemetryState(any_error, all_valid, "RS41D");
+        for (size_t i = 0; i < packed_bytes; i++) {
+            zephyrTX.addTm(_rs41_packed[i]);
+        }
+        LPC_LOG(LOG_RS41_TM_SENT, n_samples, (int)packed_bytes);
+        _rate_policy.AddTm(_rate_policy.Mode(), packed_bytes);
+        zephyrTX.TM();
+        return;
+    }
+
+    // StateMess2 "RS41" lets TM decoders distinguish
+    // between LPC messages and RS41 messages.
+    rs41TelemetryState(any_error, all_valid, "RS41");
+
+    // Add the initial timestamp
+    zephyrTX.addTm(time_stamp);
+
+    // And the number of samples
+    zephyrTX.addTm(uint16_t(n_samples));
+    
+    // Add the samples
+    for (int i = 0; i < n_samples; i++)
+    {
+            zephyrTX.addTm(rs41_sample_array[i].valid);
+            zephyrTX.addTm(rs41_sample_array[i].secs);
+            zephyrTX.addTm(rs41_sample_array[i].tdry);
+            zephyrTX.addTm(rs41_sample_array[i].humidity);
+            zephyrTX.addTm(rs41_sample_array[i].tsensor);
+            zephyrTX.addTm(rs41_sample_array[i].pres);
+            zephyrTX.addTm(rs41_sample_array[i].error);
+    }
+
+    LPC_LOG(LOG_RS41_TM_SENT, n_samples, n_samples*(sample_bytes));
+    _rate_policy.AddTm(_rate_policy.Mode(), 6 + n_samples * sample_bytes);
+
+    /* send the TM packet to the OBC */
+    zephyrTX.TM();
+    
+}
+
+void StratoLPC::rs41TelemetryState(bool any_error, bool all_valid, const char* mess2)
+{
     String Message = "";
 
     // First Field
-    Message = "";
-    bool flag1 = true;
-    for (int i = 0; i < n_samples; i++) {
-        flag1 = flag1 & !rs41_sample_array[i].error;
-    }
-    if (flag1) {
+    if (!any_error) {
         zephyrTX.setStateFlagValue(1, FINE);
     } else {
         zephyrTX.setStateFlagValue(1, WARN);
@@ -760,20 +1566,12 @@ void StratoLPC::rs41SendTelemetry(uint32_t time_stamp, rs41TmSample_t* rs41_samp
     zephyrTX.setStateDetails(1, Message);
 
     // Second Field
-    Message = "";
-    bool flag2 = true;
-    for (int i = 0; i < n_samples; i++) {
-        flag1 = flag1 & rs41_sample_array[i].valid;
-    }
-    if (flag2) {
+    if (all_valid) {
         zephyrTX.setStateFlagValue(2, FINE);
     } else {
         zephyrTX.setStateFlagValue(2, WARN);
     }
-
-    // Set StateMess2 to "RS41" so that TM decoders can distiguish
-    // between LPC messages and RS41 messages.
-    Message = "RS41";
+    Message = mess2;
     zephyrTX.setStateDetails(2, Message);
     
     // Third Field - GPS Position
@@ -785,115 +1583,206 @@ void StratoLPC::rs41SendTelemetry(uint32_t time_stamp, rs41TmSample_t* rs41_samp
     Message.concat(',');
     Message.concat(zephyrRX.zephyr_gps.altitude);
     zephyrTX.setStateDetails(3, Message);
-    Message = "";
-    // Add the initial timestamp
-    zephyrTX.addTm(time_stamp);
+}
 
-    // And the number of samples
-    zephyrTX.addTm(uint16_t(n_samples));
-    
-    // Add the samples
-    for (int i = 0; i < n_samples; i++)
-    {
-            zephyrTX.addTm(rs41_sample_array[i].valid);
-            zephyrTX.addTm(rs41_sample_array[i].secs);
-            zephyrTX.addTm(rs41_sample_array[i].tdry);
-            zephyrTX.addTm(rs41_sample_array[i].humidity);
-            zephyrTX.addTm(rs41_sample_array[i].tsensor);
-            zephyrTX.addTm(rs41_sample_array[i].pres);
-            zephyrTX.addTm(rs41_sample_array[i].error);
+void StratoLPC::rs41SetAggregateTm(bool aggregate)
+{
+    if (aggregate == _rs41_aggregate_tm) {
+        return;
+    }
+
+    // Send what has been collected in the current mode
+    if (_rs41_aggregate_tm) {
+        if (!_rs41_window.Empty()) {
+            rs41CloseWindow();
+        }
+        if (_n_rs41_aggregates) {
+            rs41SendAggregateTelemetry(_rs41_aggregates, _n_rs41_aggregates);
+            _n_rs41_aggregates = 0;
+        }
+    } else if (_n_rs41_samples) {
+        rs41SendTelemetry(now(), _rs41_samples, _n_rs41_samples);
+        _n_rs41_samples = 0;
+    }
+    _rs41_start_time = now();
+
+    _rs41_aggregate_tm = aggregate;
+    log_nominal(aggregate ? "RS41 aggregated TM" : "RS41 per-sample TM");
+}
+
+void StratoLPC::rs41Aggregate(const rs41TmSample_t& sample, time_t sample_time)
+{
+    // Windows are on a grid of RS41_AGGREGATE_SECS
+    uint32_t window_start = sample_time - sample_time % RS41_AGGREGATE_SECS;
+    if (!_rs41_window.Empty() && window_start != _rs41_window.StartTime()) {
+        rs41CloseWindow();
+    }
+    if (_rs41_window.Empty()) {
+        _rs41_window.Start(window_start);
+    }
+
+    const uint16_t fields[RS41_AGG_FIELDS] = {sample.tdry, sample.humidity, sample.tsensor, sample.pres};
+    _rs41_window.Add(sample.valid, sample.error, fields);
+}
+
+void StratoLPC::rs41CloseWindow()
+{
+    _rs41_window.Result(_rs41_aggregates[_n_rs41_aggregates]);
+    _n_rs41_aggregates++;
+    _rs41_window.Start(0);
+
+    if (_n_rs41_aggregates == RS41_N_AGGREGATES_TO_REPORT) {
+        rs41SendAggregateTelemetry(_rs41_aggregates, _n_rs41_aggregates);
+        _n_rs41_aggregates = 0;
+    }
+}
+
+void StratoLPC::rs41SendAggregateTelemetry(rs41TmAggregate_t* aggregates, int n_aggregates)
+{
+    // offset, n, n_valid, error, then mean, min and max of each field
+    const int aggregate_bytes = 2 + 1 + 1 + 2 + 3 * 2 * RS41_AGG_FIELDS;
+
+    bool any_error = false;
+    bool all_valid = true;
+    for (int i = 0; i < n_aggregates; i++) {
+        any_error = any_error || aggregates[i].error;
+        all_valid = all_valid && aggregates[i].n_valid == aggregates[i].n;
+    }
+    rs41TelemetryState(any_error, all_valid, "RS41A");
+
+    // The first window's start time and the window length, then the
+    // windows with their start as an offset from the first
+    uint32_t base = aggregates[0].start;
+    zephyrTX.addTm(base);
+    zephyrTX.addTm(uint16_t(RS41_AGGREGATE_SECS));
+    zephyrTX.addTm(uint16_t(n_aggregates));
+    for (int i = 0; i < n_aggregates; i++) {
+        zephyrTX.addTm(uint16_t(aggregates[i].start - base));
+        zephyrTX.addTm(aggregates[i].n);
+        zephyrTX.addTm(aggregates[i].n_valid);
+        zephyrTX.addTm(aggregates[i].error);
+        for (int f = 0; f < RS41_AGG_FIELDS; f++) {
+            zephyrTX.addTm(aggregates[i].mean[f]);
+            zephyrTX.addTm(aggregates[i].min[f]);
+            zephyrTX.addTm(aggregates[i].max[f]);
+        }
     }
 
-    Serial.print("Sending RS41 samples: ");
-    Serial.println(n_samples);
-    Serial.print("Sending Bytes: ");
-    Serial.println(n_samples*(sample_bytes));
+    LPC_LOG(LOG_RS41_AGG_SENT, n_aggregates, n_aggregates * aggregate_bytes);
+    _rate_policy.AddTm(_rate_policy.Mode(), n_aggregates * aggregate_bytes);
 
     /* send the TM packet to the OBC */
     zephyrTX.TM();
-    
 }
 
-void StratoLPC::rs41LocalStorage(RS41::RS41SensorData_t& rs41_data) {
-
-    File rs41_file;
+void StratoLPC::rs41LocalStorage(RS41::RS41SensorData_t& rs41_data, time_t sample_time) {
 
     // On the first entry or after FL_EXIT, there will be no file name
     if (!_rs41_filename.length() || (_rs41_file_n_samples >= RS41_N_SAMPLES_TO_REPORT)) {
-        _rs41_filename = SDFileName("RS41_", ".csv", now());
+        // The finished file no longer needs a cached handle
+        if (_rs41_filename.length()) {
+            OPC.CloseFile(_rs41_filename.c_str());
+        }
+        _rs41_filename = SDFileName("RS41_", ".csv", sample_time);
         _rs41_file_n_samples = 0;
         // Create the new file
-        rs41_file = SD.open(_rs41_filename.c_str(), FILE_WRITE);
+        String header = rs41CsvHeader() + "\n";
         // Verify that the file can be written
-        if (!rs41_file) {
+        if (!OPC.CreateFile(_rs41_filename.c_str(), RS41_FILE_PREALLOCATE) ||
+            !OPC.WriteData(_rs41_filename.c_str(), header.c_str(), header.length())) {
             log_error((String("Unable to open ") + _rs41_filename + String(", RS41 dat will not be stored")).c_str());
         } else {
             log_nominal((String("RS41 csv will be logged to ") + _rs41_filename).c_str());
-            rs41_file.write(rs41CsvHeader().c_str());
-            rs41_file.write("\n");
         }
     }
     
     _rs41_file_n_samples++;
 
-    // If the file was not opened above
-    if (!rs41_file) {
-        // Open an existing file
-        rs41_file = SD.open(_rs41_filename.c_str(), FILE_WRITE);
-        // Verify that the file can be written
-        if (!rs41_file) {
-            return;
-        }
-    }
-
-    String csv_str = rs41CsvData(rs41_data);
-    rs41_file.write(csv_str.c_str());
-    rs41_file.write("\n");
-    rs41_file.close();
+    // Appends to the cached handle; OPC.SyncFiles() flushes it periodically
+    char line[RS41_CSV_LINE_MAX];
+    char* end = rs41CsvData(line, rs41_data, sample_time);
+    *end++ = '\n';
+    OPC.WriteData(_rs41_filename.c_str(), line, end - line);
 }
 
-String StratoLPC::rs41CsvData( RS41::RS41SensorData_t &rs41_data) {
-    String comma(",");
-    String csv_str = 
-        TimeString(now()) + comma +
-        String(rs41_data.valid) + comma +
-        String(rs41_data.frame_count) + comma +
-        String(rs41_data.air_temp_degC) + comma +
-        String(rs41_data.humdity_percent) + comma +
-        String(rs41_data.hsensor_temp_degC) + comma +
-        String(rs41_data.pres_mb) + comma +
-        String(rs41_data.internal_temp_degC) + comma +
-        String(rs41_data.module_status) + comma +
-        String(rs41_data.module_error) + comma +
-        String(rs41_data.pcb_supply_V) + comma +
-        String(rs41_data.lsm303_temp_degC) + comma +
-        String(rs41_data.pcb_heater_on) + comma +
-        String(rs41_data.mag_hdgXY_deg) + comma +
-        String(rs41_data.mag_hdgXZ_deg) + comma +
-        String(rs41_data.mag_hdgYZ_deg) + comma +
-        String(rs41_data.accelX_mG) + comma +
-        String(rs41_data.accelY_mG) + comma +
-        String(rs41_data.accelZ_mG);
-
-    return csv_str;
+char* StratoLPC::rs41CsvData(char* out, RS41::RS41SensorData_t &rs41_data, time_t sample_time) {
+    out = _time_format.Write(out, sample_time);
+    *out++ = ',';
+    out = LPCFormatUInt(out, rs41_data.valid);
+    *out++ = ',';
+    out = LPCFormatUInt(out, rs41_data.frame_count);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.air_temp_degC);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.humdity_percent);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.hsensor_temp_degC);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.pres_mb);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.internal_temp_degC);
+    *out++ = ',';
+    out = LPCFormatUInt(out, rs41_data.module_status);
+    *out++ = ',';
+    out = LPCFormatUInt(out, rs41_data.module_error);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.pcb_supply_V);
+    *out++ = ',';
+    out = LPCFormatInt(out, rs41_data.lsm303_temp_degC);
+    *out++ = ',';
+    out = LPCFormatUInt(out, rs41_data.pcb_heater_on);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.mag_hdgXY_deg);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.mag_hdgXZ_deg);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.mag_hdgYZ_deg);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.accelX_mG);
+    *out++ = ',';
+    out = LPCFormatFixed(out, rs41_data.accelY_mG);
+    *out++ = ',';
+    return LPCFormatFixed(out, rs41_data.accelZ_mG);
 }
 
 String StratoLPC::rs41CsvHeader() {
     return String("Time,valid,frame_count,air_temp_degC,humdity_percent,hsensor_temp_degC,pres_mb,internal_temp_degC,module_status,module_error,pcb_supply_V,lsm303_temp_degC,pcb_heater_on,mag_hdgXY_deg,mag_hdgXZ_deg,mag_hdgYZ_deg,accelX_mG,accelY_mG,accelZ_mG");
 }
 
-void StratoLPC::rs41PrintCsv( RS41::RS41SensorData_t &rs41_data) {
-    Serial.println(rs41CsvData(rs41_data));
+void StratoLPC::rs41PrintCsv( RS41::RS41SensorData_t &rs41_data, time_t sample_time) {
+    // console output per sample is too slow to leave in a flight build
+    if (LPC_LOG_LEVEL <= LPC_LOG_DEBUG) {
+        char line[RS41_CSV_LINE_MAX];
+        char* end = rs41CsvData(line, rs41_data, sample_time);
+        *end++ = '\n';
+        Serial.write(line, end - line);
+    }
 }
 
 String StratoLPC::SDFileName(String prefix, String extension, time_t timetag) {
-    return prefix + TimeString(timetag) + extension;
+    const char* time_string = _time_format.Format(timetag);
+    if (SD_COMPRESS) {
+        extension += LPC_COMPRESS_SUFFIX;
+    }
+
+    // Keeping each directory to a day (or an hour) of files bounds the
+    // FAT directory scans done by open and create over a long flight.
+    char dir[16];
+    char* end = dir;
+    *end++ = '/';
+    end = (char*)memcpy(end, time_string, 8) + 8;
+    if (SD_SHARD_BY_HOUR) {
+        *end++ = '/';
+        end = (char*)memcpy(end, time_string + 8, 2) + 2;
+    }
+    *end = '\0';
+    if (!OPC.EnsureDirectory(dir)) {
+        // Fall back to the root directory
+        return String("/") + prefix + time_string + extension;
+    }
+    return String(dir) + String("/") + prefix + time_string + extension;
 }
 
 String StratoLPC::TimeString(time_t timetag) {
-    char buf[50];
-    struct tm* tm_time;
-    tm_time = gmtime(&timetag);
-    strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", tm_time);
-    return String(buf);
+    return String(_time_format.Format(timetag));
 }
@@ -15,15 +15,35 @@
 #include <time.h>
 #include "StratoCore.h"
 #include "LOPCLibrary_revF.h"  //updated library for Teensy 4.1
+#include "LPCArena.h"
+#include "LPCBoot.h"
+#include "LPCConfigJournal.h"
+#include "LPCFormat.h"
+#include "LPCLog.h"
+#include "LPCMemStats.h"
+#include "LPCPHABaud.h"
+#include "LPCPHACommand.h"
+#include "LPCRatePolicy.h"
+#include "LPCRS41Aggregate.h"
+#include "LPCRS41Pack.h"
+#include "LPCRS41Reader.h"
+#include "LPCScheduler.h"
+#include "LPCTimeFormat.h"
+#include "LPCZephyrRx.h"
 //#include "LPCBufferGuard.h"   //this is not needed for Teensy 4.1 as buffer size is set in user code
 #include "RS41.h"
 
 /// Schedule the OPC for immediate start after entering flight mode,
 /// rather than waiting for the hour.
 #define OPC_IMMEDIATE_START false
+/// A measurement cycle whose planned start was missed by up to this many
+/// seconds (e.g. after an overrun) is started late rather than skipped.
+#define CYCLE_CATCHUP_SECS 60
 
 #ifndef LOG_ZEPHYR_COMMS_SHARED
 #define ZEPHYR_SERIAL   Serial8
+// Serial8 is LPUART5; its interrupt feeds LPCZephyrRx
+#define ZEPHYR_SERIAL_IRQ IRQ_LPUART5
 #else
 // This allows for use of the OBD_Simulator with just the Teensy programming port, 
 // by sharing it for both Zephyr and StratoCore log messages.
@@ -32,8 +52,15 @@
 
 #define INSTRUMENT      LPC
 #define ZEPHYR_SERIAL_BUFFER_SIZE 4096
+/// Commands handled more than this long after the last Zephyr byte are
+/// not reported by LogTcLatency (e.g. modes entered without a command)
+#define TC_LATENCY_WINDOW_US 2000000
 
 // RS41 options
+/// The RS41 serial port
+#define RS41_SERIAL Serial7
+/// RS41 serial receive buffer, enough for a reply between loop passes
+#define RS41_SERIAL_BUFFER_SIZE 256
 /// The RS41 enable pin
 #define RS41_ENB_PIN 32
 /// Print RS41 samples to the console.
@@ -43,15 +70,115 @@
 /// The telemetry reporting period of RS41 samples.
 /// A new local storage file is also made at the same interval.
 #define RS41_N_SAMPLES_TO_REPORT 300
+/// RS41 TM encoding: 1 for the original per-sample "RS41" message, 2 for
+/// the packed, delta-coded "RS41D" message (see LPCRS41Pack.h), which
+/// falls back to 1 for sample sets it cannot pack
+#define RS41_TM_FORMAT 2
+/// Bytes of the original RS41 TM message, the most a packed one may use
+#define RS41_TM_BYTES(n) (4 + 2 + 15 * (n))
+/// Start flight mode with the RS41 TM aggregated: the samples still go to
+/// local storage at the RS41's 1 Hz rate, but the TM carries windowed
+/// statistics in place of each sample (see LPCRS41Aggregate.h)
+#define RS41_AGGREGATE_TM false
+/// Switch the RS41 TM to aggregates as well while the LPC samples
+/// continuously (see LPCRatePolicy.h). Off by default: continuous sampling
+/// is for ascent and descent, where the per-sample TM resolves the profile.
+#define RS41_AGGREGATE_TM_WITH_LPC false
+/// Length of an RS41 aggregation window
+#define RS41_AGGREGATE_SECS 10
+/// Windows per RS41A TM message
+#define RS41_N_AGGREGATES_TO_REPORT 30
+/// The period of the memory (stack and heap) housekeeping TM
+#define MEM_REPORT_SECS 3600
 
-// number of loops before a flag becomes stale and is reset
-#define FLAG_STALE      2
+// Local storage options
+/// Shard local storage files into /YYYYMMDD/HH/ directories,
+/// rather than just /YYYYMMDD/.
+#define SD_SHARD_BY_HOUR false
+/// Bytes of clusters preallocated for each LPC_*.ready_tm file.
+/// A 60 record cycle is a little under 6 KB.
+#define LPC_FILE_PREALLOCATE 8192
+/// Bytes of clusters preallocated for each RS41_*.csv file.
+/// RS41_N_SAMPLES_TO_REPORT rows of roughly 120 characters.
+#define RS41_FILE_PREALLOCATE 40960
+/// Longest RS41 CSV row, including the newline
+#define RS41_CSV_LINE_MAX 384
+/// Longest StateMess1 or StateMess2 text of an LPC TM message
+#define LPC_STATE_MESS_MAX 160
+/// Compress LPC and RS41 local storage files (LPCCompress).
+/// The files get LPC_COMPRESS_SUFFIX appended; tools/lpc_unlzb restores them.
+#define SD_COMPRESS false
+/// Run the SD write path benchmark (LOPCLibrary::BenchmarkSD) at startup.
+#define SD_BENCHMARK false
 
 // hardcoded limits for LPC
 #define T_PUMP_SHUTDOWN 75.0 // Max operating temperature for rotary vane pump
 
 #define PHA_BUFFER_SIZE 4096
 
+/// PHA channels in each of the HG and LG arrays
+#define PHA_CHANNELS 256
+/// Most records a cycle (or streamed chunk) may hold, which sizes the
+/// arena: each record buffer holds a cycle as long as the single 300
+/// record buffer they replaced did; longer cycles need streaming.
+#define LPC_MAX_CYCLE_RECORDS 300
+/// Arena bytes allocated once at setup: the PHA line and channel arrays,
+/// and the RS41 TM buffers (about 17.6 KB)
+#define LPC_ARENA_FIXED_BYTES ((PHA_BUFFER_SIZE + 2) + 2 * PHA_CHANNELS * sizeof(int) \
+    + RS41_N_SAMPLES_TO_REPORT * sizeof(rs41TmSample_t) \
+    + RS41_N_AGGREGATES_TO_REPORT * sizeof(rs41TmAggregate_t) \
+    + (RS41_TM_FORMAT == 2 ? RS41_TM_BYTES(RS41_N_SAMPLES_TO_REPORT) : 0))
+/// RAM for the measurement buffers (see LPCArena): the fixed buffers, and
+/// the record buffers for the largest cycle, with room for alignment
+/// (about 74 KB, in DTCM). The record buffers are sized from SETSAMPLE/SETSAMPLEAVG;
+/// a configuration that does not fit is rejected.
+#define LPC_ARENA_BYTES (LPC_ARENA_FIXED_BYTES \
+    + LPC_RECORD_BUFFERS * (32 + 16) * sizeof(uint16_t) * LPC_MAX_CYCLE_RECORDS + 64)
+/// LPC records archived to the SD card per loop pass (see RunArchive)
+#define LPC_ARCHIVE_RECORDS_PER_PASS 20
+/// Stream each measurement cycle as TM chunks of this many records, each
+/// with a chunk sequence number, rather than one TM at the end of the
+/// cycle. The record buffers then only hold LPC_STREAM_BUFFERS chunks, and
+/// the cycle length is not limited by the arena. 0 sends whole cycles.
+#define LPC_STREAM_CHUNK_RECORDS 0
+/// Chunk buffers when streaming: one being acquired, the rest being archived
+#define LPC_STREAM_BUFFERS 3
+/// StateMess2 prefix of a streamed LPC TM chunk. The payload is u32 cycle
+/// start time, u16 chunk number, u16 first record, u8 final chunk flag,
+/// then the records (no initial HK).
+#define LPC_CHUNK_TAG "LPCC"
+
+// Configuration journal (see LPCConfigJournal)
+/// Keep the telecommanded settings across resets, in an EEPROM journal.
+/// Settings saved by a build with different compiled defaults are ignored.
+#define LPC_CONFIG_PERSIST true
+/// EEPROM region of the journal, clear of LOPCLibrary's bytes 0-3
+#define LPC_CONFIG_EEPROM_START 256
+#define LPC_CONFIG_EEPROM_BYTES 1024
+/// Layout version of lpcConfig_t
+#define LPC_CONFIG_VERSION 2
+
+// Limits of the telecommanded settings, also applied to a restored configuration
+/// Longest warm up or flushing time, seconds
+#define LPC_SET_DURATION_MAX_SECS 3600
+/// Laser and pump minimum temperature settings, deg C
+#define LPC_SET_TEMP_MIN -60.0
+#define LPC_SET_TEMP_MAX 60.0
+/// Highest pump back EMF set point, volts (below the battery voltage)
+#define LPC_SET_BEMF_MAX 18.0
+/// Highest PHA high gain threshold and baseline offsets
+#define LPC_SET_PHA_THRESHOLD_MAX 1023
+#define LPC_SET_PHA_OFFSET_MAX 4095
+
+#if LPC_STREAM_CHUNK_RECORDS
+#define LPC_RECORD_BUFFERS LPC_STREAM_BUFFERS
+#else
+#define LPC_RECORD_BUFFERS 2
+#endif
+#if LPC_STREAM_CHUNK_RECORDS > LPC_MAX_CYCLE_RECORDS
+#error "LPC_STREAM_CHUNK_RECORDS must not exceed LPC_MAX_CYCLE_RECORDS"
+#endif
+
 // todo: perhaps more creative/useful enum here by mode with separate arrays?
 // WARNING: this construct assumes that NUM_ACTIONS will be equal to the number
 // of actions. Never seen this coding style before; seems dangerous.
@@ -63,18 +190,58 @@ enum ScheduleAction_t : uint8_t {
     START_MEASUREMENT,
     RESEND_SAFETY,
     RS41_SAMPLE,
+    MEM_REPORT,
+    RATE_POLICY,
     NUM_ACTIONS
 };
 
-/// @brief The RS41 compressed sample for use in the RS41 TM message
-struct rs41TmSample_t {
-    uint8_t valid;
-    uint32_t secs;
-    uint16_t tdry;
-    uint16_t humidity;
-    uint16_t tsensor;
-    uint16_t pres;
-    uint16_t error;
+/// @brief One measurement cycle (or, when streaming, one chunk of it): the
+/// records, and the values for its TM header captured when it finished.
+/// There are several, so that one can be sent and archived while the next
+/// is being acquired.
+struct LPCCycle_t {
+    uint16_t* bins[32];  // Aerosol bins, co-added in place; rows in the arena
+    uint16_t* hk[16];    // HK channels
+    int capacity;        // Records per row
+    int records;
+    uint16_t chunk;         // Chunk sequence number within the cycle
+    uint16_t first_record;  // Cycle record number of records[0]
+    bool final;             // Last chunk of the cycle
+    uint32_t start_time;
+    float temp_pump1;
+    float temp_pump2;
+    float temp_laser;
+    float vbat;
+    float latitude;
+    float longitude;
+    float altitude;
+    float duty;           // Percentage of planned cycles run this flight
+    int32_t start_error;  // Actual minus planned start, seconds
+    uint32_t arena_peak;  // Peak measurement arena use, bytes
+    LPCRateMode rate_mode;  // Measured under (LPCRatePolicy)
+};
+
+/// @brief The telecommanded settings, as kept in the configuration journal
+struct lpcConfig_t {
+    uint8_t version;            // LPC_CONFIG_VERSION
+    uint8_t pha_set;            // The PHA settings have been commanded
+    uint16_t defaults_crc;      // Of the compiled defaults (see StratoLPC::RestoreConfig)
+    int32_t numberSamples;
+    int32_t samplesToAverage;
+    int32_t cycleTime;
+    int32_t warmUpTime;
+    int32_t laserTemp;
+    int32_t flushingTime;
+    uint16_t phaHiGainThreshold;
+    uint16_t phaHiGainOffset;
+    uint16_t phaLoGainOffset;
+    float pumpMinTemp;
+    float bemf1SP;
+    float bemf2SP;
+    uint8_t hgBinBoundaries[17];
+    uint8_t lgBinBoundaries[17];
+    uint8_t rateTriggers;       // LPC_RATE_TRIGGER_*
+    LPCRateBand rateBands[LPC_RATE_N_BANDS];
 };
 
 class StratoLPC : public StratoCore {
@@ -88,6 +255,38 @@ public:
     // called at the end of each loop
     void InstrumentLoop();
 
+    // true when a scheduled action's deadline has passed, so that the
+    // event-driven loop can wake for it
+    bool ActionDue() { return _action_scheduler.Due(); }
+
+    // true from the start of the flush until LPC_Shutdown(), while the PHA
+    // is powered and its frames are read
+    bool PHAListening() const { return _pha_cmd.Started(); }
+
+    // hand the Zephyr bytes received by LPCZephyrRx to the router;
+    // call before RunRouter()
+    void DrainZephyrRx();
+
+    // log the stack and heap statistics (debug command)
+    void LogMemory();
+    /// @brief Log the reset cause and the boot time breakdown (LPCBoot)
+    void LogBoot();
+    /// @brief Restore the telecommanded settings from the configuration
+    /// journal, checking them as the telecommands do
+    void RestoreConfig();
+    /// @brief Journal the telecommanded settings, if they have changed.
+    /// This only stages the record; InstrumentLoop() writes it.
+    void SaveConfig();
+    /// @brief The current settings as a journal record
+    void GetConfig(lpcConfig_t& config);
+    /// @brief Choose the measurement rate policy triggers
+    /// (LPC_RATE_TRIGGER_*), as the telecommand does
+    void SetRateTriggers(uint8_t triggers);
+    /// @brief Set an altitude band of continuous sampling, in metres, as
+    /// the telecommand does; low_m == high_m clears it
+    /// @return false if the band is invalid
+    bool SetRateBand(uint8_t band, float low_m, float high_m);
+
 private:
     // Mode functions (implemented in unique source files)
     void StandbyMode();
@@ -98,76 +297,199 @@ private:
     
     //LPC Functions
     void LPC_Shutdown();
-    TimeElements Get_Next_Hour();
-  //  time_t Next_Start_Time(time_t);
+    /// @brief Plan the start of the next measurement cycle.
+    /// Start times are absolute, on multiples of Set_cycleTime since the
+    /// epoch, and overruns or skipped cycles do not shift later ones.
+    /// @param t The time from which to look for the next start
+    /// @return The planned start time (also kept in _cycle_planned_start)
+    time_t PlanNextCycle(time_t t);
+    /// @brief Plan the next cycle from now() and schedule START_WARMUP for it
+    void ScheduleNextCycle();
+    // Checks of the telecommanded settings (see LPC_SET_*)
+    static bool CycleTimeOk(int32_t minutes) { return minutes >= 1; }
+    static bool DurationOk(int32_t secs) { return secs >= 0 && secs <= LPC_SET_DURATION_MAX_SECS; }
+    static bool TemperatureOk(float celsius) { return celsius >= LPC_SET_TEMP_MIN && celsius <= LPC_SET_TEMP_MAX; }
+    static bool BemfOk(float volts) { return volts > 0 && volts <= LPC_SET_BEMF_MAX; }
+    static bool PhaOk(uint16_t threshold, uint16_t hg_offset, uint16_t lg_offset)
+    {
+        return threshold <= LPC_SET_PHA_THRESHOLD_MAX && hg_offset <= LPC_SET_PHA_OFFSET_MAX
+            && lg_offset <= LPC_SET_PHA_OFFSET_MAX;
+    }
+    /// @brief Bin boundaries must rise and stay within the PHA channels
+    static bool BinsOk(const uint8_t* boundaries, int n);
+    /// @brief Give the rate policy the GPS altitude, and report a change
+    /// of mode (LPCRatePolicy)
+    void rateUpdate();
+    /// @brief Log the time, TM and energy spent in each rate mode
+    void rateReport();
     void ReadHK(int);
     void CheckTemps();
+    /// @brief Both pumps are at or above PumpMinTemp, as needed to start a cycle
+    bool PumpsWarm();
     void AdjustPumps();
     float getFlow();
     int parsePHA(int);
     void fillBins(int,int);
-    void PackageTelemetry(int);
+    void PackageTelemetry(LPCCycle_t& cycle);
+    /// @brief The StateMess1 text of a cycle's TM: temperatures, duty,
+    /// start error and arena peak
+    /// @return The end of the text written to out (LPC_STATE_MESS_MAX)
+    char* FormatStateMess1(char* out, const LPCCycle_t& cycle);
+    /// @brief The StateMess2 text of a cycle's TM: the position, after
+    /// LPC_CHUNK_TAG when streaming
+    char* FormatStateMess2(char* out, const LPCCycle_t& cycle);
+
+    // Measurement pipeline
+    /// @brief Allocate the buffers that last the whole flight from the arena
+    void AllocateArena();
+    /// @brief Records per buffer needed for a configuration
+    int CycleRecords(int samples, int samples_to_average);
+    /// @brief True if the record buffers for a configuration fit in the arena
+    bool CycleFits(int samples, int samples_to_average);
+    /// @brief Records per buffer for the current configuration, limited to
+    /// what fits in the arena
+    int BufferRecords();
+    /// @brief Release the record buffers and carve them again for the
+    /// current configuration, cleared
+    void CarveCycleBuffers();
+    /// @brief Zero the records of a buffer so it can be co-added into
+    void ClearCycle(LPCCycle_t& cycle);
+    /// @brief Start a new cycle in the free buffer, clearing the chunk count.
+    /// The buffers are only re-carved, after waiting for the archive, when
+    /// the configuration has changed their size.
+    void StartCycle();
+    /// @brief Note that a record is complete; when streaming, a full chunk
+    /// is handed to the archive pipeline
+    void RecordComplete(int record);
+    /// @brief True when the record buffer of a whole-cycle TM is full, e.g.
+    /// after SETSAMPLE raised the samples mid-cycle; further frames would
+    /// wrap around onto the first record
+    bool CycleFull();
+    /// @brief Hand the rest of the cycle to the archive pipeline
+    void FinishCycle(int Records);
+    /// @brief True if a buffer is free for acquisition to switch to
+    bool RecordBufferFree() const { return _archive_pending <= LPC_RECORD_BUFFERS - 2; }
+    /// @brief Hand the acquisition buffer, holding Records records, to the
+    /// archive pipeline and switch BinData/HKData to the next free buffer
+    void QueueRecords(int Records, bool final);
+    /// @brief Advance the archive pipeline by one step: send the TM, or
+    /// write the SD file a few records at a time. Called every loop pass.
+    void RunArchive();
     
     // PHA functions
     /// @brief Configure the PHA if needed
-    /// If the Set_triggerPHAconfig flag is set, 
-    /// configure the PHA, and clear Set_triggerPHAconfig.
+    /// If the Set_triggerPHAconfig flag is set and the PHA is on,
+    /// queue the configuration commands, and clear Set_triggerPHAconfig.
     void phaConfig();
+    /// @brief Send the queued PHA commands, picking up a configuration
+    /// commanded mid-flight, and report the batch when it is finished
+    void phaCommandLoop();
+    /// @brief Report the result of each command of the finished batch
+    void phaReport();
+    /// @brief Report the PHA link rate after a negotiation (LPCPHABaud)
+    void phaLinkReport();
 
     // RS41 Functions
     /// @brief (Re)start the RS41 measurement action.
     void rs41Start();
     /// @brief See if the RS41 action has been triggered.
-    /// If so, collect a sample and reset the action.
+    /// If so, request a sample from the RS41. Then take the
+    /// finished sample from _rs41_reader, if there is one.
     /// If RS41_N_SAMPLES_TO_REPORT have been collected,
     /// transmit them as a TM data packet.
     /// If time is valid, save the sample to local storage.
     void rs41Action();
-    /// @brief Send an RS41 telemetry package
+    /// @brief Send an RS41 telemetry package, packed as RS41D when
+    /// RS41_TM_FORMAT is 2 and the samples allow
     void rs41SendTelemetry(uint32_t sample_start_time, rs41TmSample_t* rs41_sample_array, int n_samples);
+    /// @brief Switch the RS41 TM between per-sample and aggregated. What
+    /// has been collected for the TM so far is sent first.
+    void rs41SetAggregateTm(bool aggregate);
+    /// @brief Add a sample to its aggregation window
+    void rs41Aggregate(const rs41TmSample_t& sample, time_t sample_time);
+    /// @brief Store the current window's statistics, and send them when
+    /// RS41_N_AGGREGATES_TO_REPORT have been collected
+    void rs41CloseWindow();
+    /// @brief Send an RS41A telemetry package of aggregation windows
+    void rs41SendAggregateTelemetry(rs41TmAggregate_t* aggregates, int n_aggregates);
+    /// @brief Set the RS41 TM state flags and messages
+    void rs41TelemetryState(bool any_error, bool all_valid, const char* mess2);
     /// @brief A header for RS41 CSV data
     /// @return The header
     String rs41CsvHeader();
-    /// @brief Get a CSV version of RS41 data
-    String rs41CsvData(RS41::RS41SensorData_t &rs41_data);
+    /// @brief Get a CSV version of RS41 data, without the newline
+    /// @return The end of the text written to out (RS41_CSV_LINE_MAX)
+    char* rs41CsvData(char* out, RS41::RS41SensorData_t &rs41_data, time_t sample_time);
     /// @brief Send RS41 data to the console
-    void rs41PrintCsv(RS41::RS41SensorData_t &rs41_data);
+    void rs41PrintCsv(RS41::RS41SensorData_t &rs41_data, time_t sample_time);
 
     // Local storage functions
-    /// @brief Create a time based file name
+    /// @brief Create a time based file name.
+    /// Files are sharded into per day (or hour, see SD_SHARD_BY_HOUR)
+    /// directories, which are created as needed.
+    /// With SD_COMPRESS, LPC_COMPRESS_SUFFIX is appended and the file is
+    /// written compressed.
+    /// @return /YYYYMMDD[/HH]/<prefix>YYYYMMDDHHmmSS<extension>
     String SDFileName(String prefix, String extension, time_t timetag);
-    /// @brief Formatted time respresentation
+    /// @brief Formatted time respresentation (see LPCTimeFormat)
     /// @param timetag The time of interest
     /// @return Formatted as YYYYMMDDHHmmSS
     String TimeString(time_t timetag);
-    /// @brief The number of LPC records in BinData
-    /// @param Records 
-    void writeLPCtoSD(int Records);
+    /// @brief Create the LPC local storage file for a cycle and write
+    /// everything up to the binary records
+    /// @return false if the file could not be created
+    bool writeLPCHeaderToSD(LPCCycle_t& cycle);
+    /// @brief Append records [first, last) of a cycle to the LPC file
+    void writeLPCRecordsToSD(LPCCycle_t& cycle, int first, int last);
+    /// @brief Finish the LPC TM message in the file, and close the file
+    /// after the final chunk
+    void closeLPCtoSD(bool final);
     /// @brief
     /// RS41 local storage processing
-    /// Create a new RS41 local file every RS41_N_SAMPLES_TO_REPORT.
-    /// Append the samples in CSV format.
+    /// Create a new RS41 local file every RS41_N_SAMPLES_TO_REPORT
+    /// seconds. Append every sample, at either rate, in CSV format.
     /// @param rs41_data One sample of RS41 data
-    void rs41LocalStorage(RS41::RS41SensorData_t& rs41_data);
+    /// @param sample_time When the sample was requested
+    void rs41LocalStorage(RS41::RS41SensorData_t& rs41_data, time_t sample_time);
     
     LOPCLibrary OPC;  //Creates an instance of the OPC
     RS41 _rs41; // The RS41 sensor
+    LPCRS41Reader _rs41_reader; // Collects RS41 samples without blocking
+    LPCPHACommand _pha_cmd;     // Sends PHA commands without blocking
+    LPCPHABaud _pha_baud;       // Raises the PHA link rate after warm up
+    LPCRatePolicy _rate_policy; // Duty-cycled or continuous measurements
     
     // Telcommand handler - returns ack/nak
     bool TCHandler(Telecommand_t telecommand);
 
-    // Action handler for scheduled actions
+    /// @brief Log the time from the last Zephyr byte (the end of the
+    /// command) to now, when the command is being acknowledged
+    void LogTcLatency(const char* command);
+    uint32_t _tc_latency_max_us = 0;
+
+    // Action handler for actions scheduled with the StratoCore scheduler
     void ActionHandler(uint8_t action);
 
     // Safely check and clear action flags
     bool CheckAction(uint8_t action);
 
-    // Monitor the action flags and clear old ones
+    // Fire due actions and clear old ones
     void WatchFlags();
-    
-    //Teensy 4.1 Serial buffer
-    uint8_t OPC_serial_RX_buffer[PHA_BUFFER_SIZE];
 
+    /// @brief Log the dispatch jitter of each action since the last report
+    void ReportActionJitter();
+    /// @brief Send the stack and heap statistics as a TM, with StateMess2
+    /// "MEM". The payload is 15 u32: time, uptime s, stack used, stack
+    /// size, heap in use, heap peak, heap free, largest free block, allocs,
+    /// frees, alloc failures, arena peak, arena size, and the last boot's
+    /// reset cause (SRC_SRSR) and ms to the first loop pass (LPCBoot).
+    void SendMemoryTelemetry();
+
+    // Millisecond deadline scheduler for the ScheduleAction_t actions.
+    // The StratoCore scheduler has one second resolution, and its flags go
+    // stale after a number of loops rather than a fixed time.
+    LPCScheduler _action_scheduler;
+    
     // Global variables used by LPC
     /* Variables with initial values that can be configured via telecommand */
     int Set_numberSamples = 60;        // Number of samples to collect for each measurement
@@ -192,10 +514,42 @@ private:
     int NumberHGBins = 16;
     int NumberHKChannels = 16;
     
-    uint16_t BinData[32][300];  //Array to store aerosol bins for a full measurement cycle
-    uint16_t HKData[16][300];  //Array to store HK data
-    TimeElements StartTime;
+    // Measurement buffers. Those that last the whole flight are allocated
+    // below _arena_cycle_mark at setup; the record buffers above it are
+    // carved again at the start of every cycle.
+    alignas(8) uint8_t _arena_memory[LPC_ARENA_BYTES];
+    LPCArena _arena{_arena_memory, sizeof(_arena_memory)};
+    size_t _arena_cycle_mark = 0;
+
+    LPCCycle_t _cycle_buffers[LPC_RECORD_BUFFERS];
+    int _cycle_records = 0;       // Records per buffer, from the configuration
+    uint8_t _acquire_buffer = 0;  // Index of the buffer being acquired
+    uint8_t _archive_pending = 0; // Buffers queued for (or being) archived, oldest first
+    uint16_t _chunk_seq = 0;      // Sequence number of the chunk being acquired
+    int _chunk_first_record = 0;  // Cycle record number of its first record
+    // Index with record % _cycle_records
+    uint16_t** BinData = _cycle_buffers[0].bins;  //Array to store aerosol bins for a full measurement cycle
+    uint16_t** HKData = _cycle_buffers[0].hk;  //Array to store HK data
+
+    enum ArchiveState_t : uint8_t {
+        ARCHIVE_IDLE,
+        ARCHIVE_SEND_TM,
+        ARCHIVE_SD_OPEN,
+        ARCHIVE_SD_RECORDS,
+        ARCHIVE_SD_CLOSE
+    };
+    ArchiveState_t _archive_state = ARCHIVE_IDLE;
+    LPCCycle_t* _archive_cycle = nullptr;  // The cycle being archived
+    int _archive_record = 0;               // Next record to write to SD
+    String _archive_file;                  // Its LPC local storage file
     time_t StartTimeSeconds;
+    time_t _cycle_planned_start = 0;   // Planned start of the current/next cycle
+    int32_t _cycle_start_error = 0;    // Actual minus planned start of the last cycle, seconds
+    uint32_t _cycles_run = 0;          // Cycles completed this flight
+    uint32_t _cycles_skipped = 0;      // Grid cycles skipped (overruns, pump temperature)
+    LPCRateMode _cycle_rate_mode = LPC_RATE_DUTY;  // Rate mode of the current cycle
+    uint32_t _hk_last_ms = 0;          // Last HK read, for the rate mode energy
+    bool _rate_start_pending = false;  // Start a cycle now for continuous sampling
     uint32_t MeasurementStartTime; //actually a time_t, set to uint32_t for overloaded TM function in XMLwriter
     
     /*Global Variables */
@@ -247,9 +601,9 @@ private:
     char inByte;
     int ErrorCount = 0;
 
-    char PHAArray[PHA_BUFFER_SIZE]; //bit char array to hold data from PHA
-    int LGArray[256]; //int array for data from PHA LG channel
-    int HGArray[256]; //int array for data from PHA HG channel
+    char* PHAArray = nullptr; //bit char array to hold data from PHA (PHA_BUFFER_SIZE + 2, in the arena)
+    int* LGArray = nullptr; //int array for data from PHA LG channel (PHA_CHANNELS)
+    int* HGArray = nullptr; //int array for data from PHA HG channel (PHA_CHANNELS)
     int HGBins[16]; //int array for downsampled data
     int LGBins[16]; // int array for downsampled data
     
@@ -257,8 +611,10 @@ private:
     /// The number of RS41 samples which have been collected for
     /// sending as a TM
     int _n_rs41_samples = 0;
-    /// Array to hold RS41 samples for the TM
-    rs41TmSample_t _rs41_samples[RS41_N_SAMPLES_TO_REPORT];
+    /// Array to hold RS41 samples for the TM (RS41_N_SAMPLES_TO_REPORT, in the arena)
+    rs41TmSample_t* _rs41_samples = nullptr;
+    /// The packed RS41D payload (RS41_TM_FORMAT 2, in the arena)
+    uint8_t* _rs41_packed = nullptr;
     /// The current RS41 local file. We will be opening, appending, closing
     /// to this file. When not in flight mode, the string is set to empty.
     String _rs41_filename;
@@ -267,8 +623,21 @@ private:
     int _rs41_file_n_samples = 0;
     /// The start time of the current RS41 collection cycle
     uint32_t _rs41_start_time = 0;
-
-    // Actions
-    ActionFlag_t action_flags[NUM_ACTIONS] = {{0}}; // initialize all flags to false
+    /// The RS41 TM carries aggregation windows rather than samples
+    bool _rs41_aggregate_tm = RS41_AGGREGATE_TM;
+    /// The open aggregation window
+    LPCRS41Window _rs41_window;
+    /// Closed windows for the TM (RS41_N_AGGREGATES_TO_REPORT, in the arena)
+    rs41TmAggregate_t* _rs41_aggregates = nullptr;
+    int _n_rs41_aggregates = 0;
+    /// Timestamps for the file names and CSV rows, which mostly advance
+    /// a second at a time
+    LPCTimeFormat _time_format;
+    /// The telecommanded settings, kept across resets
+    LPCConfigJournal _config_journal;
+    /// The settings last journaled or restored
+    lpcConfig_t _config_saved;
+    /// CRC of the compiled default settings
+    uint16_t _config_defaults_crc = 0;
 };
 #endif /* STRATOLPC_H */
@@ -0,0 +1,380 @@
+/*
+ *  lpc_decode.cpp
+ *  Created: October 2026
+ *
+ *  Ground-side decoder for LPC local storage dumps and TM captures.
+ *
+ *  Walks the given directories (recursively) for LPC_*.ready_tm, *.tm and
+ *  RS41_*.csv files, memory-maps them and decodes them in parallel. Files
+ *  written with SD_COMPRESS (an extra .lzb suffix) are expanded in memory
+ *  first. The results are merged in file name order (which is time order) and written
+ *  as CSV and/or LCOL binary columnar tables:
+ *
+ *    <out>/lpc.csv       <out>/lpc.lcol        LPC bin and HK records
+ *    <out>/rs41_tm.csv   <out>/rs41_tm.lcol    RS41 samples from TM messages
+ *    <out>/rs41_csv.csv  <out>/rs41_csv.lcol   RS41 samples from local storage
+ *    <out>/rs41_agg.csv  <out>/rs41_agg.lcol   RS41 aggregated window statistics
+ *    <out>/mem.csv       <out>/mem.lcol        Stack and heap housekeeping TM
+ *    <out>/files.csv                           file_id to path mapping
+ *
+ *  Usage: lpc_decode [-j threads] [-f csv|lcol|both] [-o outdir] [--bench] path...
+ */
+
+#include "lpc_formats.h"
+#include "LPCCompress.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace lpc;
+
+enum FileKind { KIND_TM, KIND_RS41_CSV };
+
+struct InputFile {
+    std::string path;
+    FileKind kind;
+    size_t bytes;
+    bool compressed;
+};
+
+struct Options {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    bool csv = true;
+    bool lcol = true;
+    bool bench = false;
+    std::string out_dir = ".";
+    std::vector<std::string> inputs;
+};
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: lpc_decode [-j threads] [-f csv|lcol|both] [-o outdir] [--bench] path...\n"
+        "  Decodes LPC_*.ready_tm, *.tm (TM captures) and RS41_*.csv files,\n"
+        "  plain or with an .lzb (SD_COMPRESS) suffix.\n"
+        "  Directories are searched recursively.\n");
+}
+
+static bool classify(fs::path p, FileKind& kind, bool& compressed)
+{
+    compressed = (p.extension() == LPC_COMPRESS_SUFFIX);
+    if (compressed) {
+        p.replace_extension();
+    }
+    std::string name = p.filename().string();
+    std::string ext = p.extension().string();
+    if (ext == ".ready_tm" || ext == ".tm") {
+        kind = KIND_TM;
+        return true;
+    }
+    if (ext == ".csv" && name.rfind("RS41_", 0) == 0) {
+        kind = KIND_RS41_CSV;
+        return true;
+    }
+    return false;
+}
+
+static std::vector<InputFile> collectInputs(const std::vector<std::string>& paths)
+{
+    std::vector<InputFile> files;
+    for (const std::string& p : paths) {
+        std::error_code ec;
+        FileKind kind;
+        bool compressed;
+        if (fs::is_directory(p, ec)) {
+            for (auto it = fs::recursive_directory_iterator(p, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                if (it->is_regular_file(ec) && classify(it->path(), kind, compressed)) {
+                    files.push_back({it->path().string(), kind, (size_t)it->file_size(ec), compressed});
+                }
+            }
+        } else if (fs::is_regular_file(p, ec) && classify(p, kind, compressed)) {
+            files.push_back({p, kind, (size_t)fs::file_size(p, ec), compressed});
+        } else {
+            fprintf(stderr, "Skipping %s\n", p.c_str());
+        }
+    }
+    // File names carry the creation time, so name order is time order.
+    std::sort(files.begin(), files.end(), [](const InputFile& a, const InputFile& b) {
+        return fs::path(a.path).filename() < fs::path(b.path).filename();
+    });
+    return files;
+}
+
+static void decodeFile(const InputFile& in, uint32_t file_id, Decoded& out)
+{
+    int fd = open(in.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        out.errors++;
+        out.error_text = "Unable to open";
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    size_t len = (size_t)st.st_size;
+    void* map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        out.errors++;
+        out.error_text = "Unable to mmap";
+        return;
+    }
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    const uint8_t* data = (const uint8_t*)map;
+    std::vector<uint8_t> expanded;
+    if (in.compressed) {
+        std::string err;
+        if (!decompressLzb(data, len, expanded, err)) {
+            out.errors++;
+            out.error_text = err;
+        }
+        munmap(map, len);
+        map = nullptr;
+        data = expanded.data();
+        len = expanded.size();
+    }
+
+    if (in.kind == KIND_TM) {
+        decodeTm(data, len, file_id, out);
+    } else {
+        decodeRs41Csv(data, len, file_id, out);
+    }
+    if (map) {
+        munmap(map, len);
+    }
+}
+
+/// @brief Run fn(i) for i in [0, n) across nthreads workers
+template <typename Fn> static void parallelFor(size_t n, int nthreads, Fn fn)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < n; i = next++) {
+            fn(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < nthreads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : pool) {
+        t.join();
+    }
+}
+
+/// @brief Concatenate one table from every decoded file, in file order.
+/// Each (file, column) copy is an independent task.
+static Table merge(const std::vector<Decoded>& parts, Table Decoded::*which, int nthreads)
+{
+    Table merged = parts.empty() ? Table() : parts[0].*which;
+    if (parts.empty()) {
+        return merged;
+    }
+    size_t ncols = merged.cols.size();
+    std::vector<std::vector<size_t>> offset(ncols, std::vector<size_t>(parts.size() + 1, 0));
+    for (size_t c = 0; c < ncols; c++) {
+        for (size_t f = 0; f < parts.size(); f++) {
+            offset[c][f + 1] = offset[c][f] + (parts[f].*which).cols[c].data.size();
+        }
+        merged.cols[c].data.resize(offset[c][parts.size()]);
+    }
+    parallelFor(ncols * parts.size(), nthreads, [&](size_t i) {
+        size_t c = i % ncols;
+        size_t f = i / ncols;
+        const std::vector<uint8_t>& src = (parts[f].*which).cols[c].data;
+        if (!src.empty()) {
+            memcpy(&merged.cols[c].data[offset[c][f]], src.data(), src.size());
+        }
+    });
+    return merged;
+}
+
+static bool writeCsv(const Table& t, const std::string& path, int nthreads)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+    std::string header = csvHeader(t);
+    bool ok = fwrite(header.data(), 1, header.size(), f) == header.size();
+
+    // Format fixed size row blocks in parallel, then write them in order.
+    const size_t block_rows = 16384;
+    size_t rows = t.rows();
+    size_t nblocks = (rows + block_rows - 1) / block_rows;
+    std::vector<std::string> text(nblocks);
+    parallelFor(nblocks, nthreads, [&](size_t b) {
+        formatCsvRows(t, b * block_rows, std::min(rows, (b + 1) * block_rows), text[b]);
+    });
+    for (const std::string& s : text) {
+        ok = ok && fwrite(s.data(), 1, s.size(), f) == s.size();
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+struct Result {
+    Table lpc;
+    Table rs41_tm;
+    Table rs41_csv;
+    Table rs41_agg;
+    Table mem;
+    int messages = 0;
+    int errors = 0;
+};
+
+static Result decodeAll(const std::vector<InputFile>& files, int nthreads, bool report_errors)
+{
+    std::vector<Decoded> parts(files.size());
+    parallelFor(files.size(), nthreads, [&](size_t i) { decodeFile(files[i], (uint32_t)i, parts[i]); });
+
+    Result r;
+    for (size_t i = 0; i < parts.size(); i++) {
+        r.messages += parts[i].messages;
+        r.errors += parts[i].errors;
+        if (report_errors && parts[i].errors) {
+            fprintf(stderr, "%s: %d error(s), first: %s\n", files[i].path.c_str(), parts[i].errors,
+                    parts[i].error_text.c_str());
+        }
+    }
+    r.lpc = merge(parts, &Decoded::lpc, nthreads);
+    r.rs41_tm = merge(parts, &Decoded::rs41_tm, nthreads);
+    r.rs41_csv = merge(parts, &Decoded::rs41_csv, nthreads);
+    r.rs41_agg = merge(parts, &Decoded::rs41_agg, nthreads);
+    r.mem = merge(parts, &Decoded::mem, nthreads);
+    return r;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static int bench(const std::vector<InputFile>& files, int max_threads)
+{
+    size_t bytes = 0;
+    for (const InputFile& f : files) {
+        bytes += f.bytes;
+    }
+    printf("%zu files, %.1f MB\n", files.size(), bytes / 1e6);
+    printf("%8s %12s %12s %12s %12s\n", "threads", "decode_s", "decode_MB/s", "csv_s", "rows");
+
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(max_threads);
+
+    for (int t : counts) {
+        auto t0 = std::chrono::steady_clock::now();
+        Result r = decodeAll(files, t, false);
+        double decode_s = secondsSince(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        size_t rows = 0;
+        for (const Table* tab : {&r.lpc, &r.rs41_tm, &r.rs41_csv, &r.rs41_agg, &r.mem}) {
+            const size_t block_rows = 16384;
+            size_t nblocks = (tab->rows() + block_rows - 1) / block_rows;
+            std::vector<std::string> text(nblocks);
+            parallelFor(nblocks, t, [&](size_t b) {
+                formatCsvRows(*tab, b * block_rows, std::min(tab->rows(), (b + 1) * block_rows), text[b]);
+            });
+            rows += tab->rows();
+        }
+        double csv_s = secondsSince(t0);
+        printf("%8d %12.3f %12.1f %12.3f %12zu\n", t, decode_s, bytes / 1e6 / decode_s, csv_s, rows);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-j" && i + 1 < argc) {
+            opt.threads = std::max(1, atoi(argv[++i]));
+        } else if (a == "-o" && i + 1 < argc) {
+            opt.out_dir = argv[++i];
+        } else if (a == "-f" && i + 1 < argc) {
+            std::string f = argv[++i];
+            opt.csv = (f == "csv" || f == "both");
+            opt.lcol = (f == "lcol" || f == "both");
+            if (!opt.csv && !opt.lcol) {
+                usage();
+                return 1;
+            }
+        } else if (a == "--bench") {
+            opt.bench = true;
+        } else if (a == "-h" || a == "--help" || a[0] == '-') {
+            usage();
+            return a[0] == '-' && a != "-h" && a != "--help";
+        } else {
+            opt.inputs.push_back(a);
+        }
+    }
+    if (opt.inputs.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<InputFile> files = collectInputs(opt.inputs);
+    if (files.empty()) {
+        fprintf(stderr, "No input files found\n");
+        return 1;
+    }
+    if (opt.bench) {
+        return bench(files, opt.threads);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    Result r = decodeAll(files, opt.threads, true);
+    fprintf(stderr, "Decoded %zu files, %d messages, %d errors in %.3f s\n", files.size(), r.messages, r.errors,
+            secondsSince(t0));
+
+    std::error_code ec;
+    fs::create_directories(opt.out_dir, ec);
+    bool ok = true;
+    for (const Table* t : {&r.lpc, &r.rs41_tm, &r.rs41_csv, &r.rs41_agg, &r.mem}) {
+        std::string base = (fs::path(opt.out_dir) / t->name).string();
+        if (opt.csv) {
+            ok = writeCsv(*t, base + ".csv", opt.threads) && ok;
+        }
+        if (opt.lcol) {
+            ok = writeColumnar(*t, base + ".lcol") && ok;
+        }
+        fprintf(stderr, "%-9s %zu rows\n", t->name.c_str(), t->rows());
+    }
+
+    FILE* index = fopen((fs::path(opt.out_dir) / "files.csv").string().c_str(), "w");
+    if (index) {
+        fprintf(index, "file_id,path\n");
+        for (size_t i = 0; i < files.size(); i++) {
+            fprintf(index, "%zu,%s\n", i, files[i].path.c_str());
+        }
+        ok = (fclose(index) == 0) && ok;
+    } else {
+        ok = false;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Error writing output to %s\n", opt.out_dir.c_str());
+        return 1;
+    }
+    return r.errors ? 2 : 0;
+}
@@ -0,0 +1,255 @@
+/*
+ *  lpc_fmtbench.cpp
+ *  Created: October 2026
+ *
+ *  Host benchmark of src/LPCFormat against the String style of formatting
+ *  it replaced, on RS41 CSV rows (StratoLPC::rs41CsvData()).
+ *
+ *  Three ways of building the same row are timed:
+ *   - string:    a heap string per field, concatenated, as String(float)
+ *                and operator+ did
+ *   - snprintf:  one snprintf() of the whole row, no allocation
+ *   - LPCFormat: the integer-only formatter, as the instrument now does
+ *  and the LPCFormat rows are checked against the snprintf ones.
+ *
+ *  The row timestamps are timed too, for a 1 Hz run of seconds across
+ *  midnight: gmtime() and strftime(), as TimeString() did, against
+ *  src/LPCTimeFormat, whose text is checked against strftime's.
+ *
+ *  Usage: lpc_fmtbench [rows]
+ */
+
+#include "LPCFormat.h"
+#include "LPCTimeFormat.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#else
+static uint64_t cycles() { return 0; }
+#endif
+
+/// The RS41::RS41SensorData_t fields written by rs41CsvData()
+struct Row {
+    uint8_t valid;
+    uint32_t frame_count;
+    float air_temp_degC, humdity_percent, hsensor_temp_degC, pres_mb, internal_temp_degC;
+    uint8_t module_status, module_error;
+    float pcb_supply_V;
+    int16_t lsm303_temp_degC;
+    uint8_t pcb_heater_on;
+    float mag_hdgXY_deg, mag_hdgXZ_deg, mag_hdgYZ_deg, accelX_mG, accelY_mG, accelZ_mG;
+};
+
+static const char* TIME = "20260101120000";
+
+static std::string fixed2(float v)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.2f", (double)v);
+    return buf;
+}
+
+static size_t rowString(const Row& r, char* out)
+{
+    std::string comma(",");
+    std::string s = std::string(TIME) + comma + std::to_string(r.valid) + comma + std::to_string(r.frame_count) +
+                    comma + fixed2(r.air_temp_degC) + comma + fixed2(r.humdity_percent) + comma +
+                    fixed2(r.hsensor_temp_degC) + comma + fixed2(r.pres_mb) + comma + fixed2(r.internal_temp_degC) +
+                    comma + std::to_string(r.module_status) + comma + std::to_string(r.module_error) + comma +
+                    fixed2(r.pcb_supply_V) + comma + std::to_string(r.lsm303_temp_degC) + comma +
+                    std::to_string(r.pcb_heater_on) + comma + fixed2(r.mag_hdgXY_deg) + comma +
+                    fixed2(r.mag_hdgXZ_deg) + comma + fixed2(r.mag_hdgYZ_deg) + comma + fixed2(r.accelX_mG) +
+                    comma + fixed2(r.accelY_mG) + comma + fixed2(r.accelZ_mG);
+    memcpy(out, s.data(), s.size());
+    return s.size();
+}
+
+static size_t rowSnprintf(const Row& r, char* out)
+{
+    return snprintf(out, 512, "%s,%u,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%u,%u,%.2f,%d,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f", TIME,
+                    r.valid, r.frame_count, r.air_temp_degC, r.humdity_percent, r.hsensor_temp_degC, r.pres_mb,
+                    r.internal_temp_degC, r.module_status, r.module_error, r.pcb_supply_V, r.lsm303_temp_degC,
+                    r.pcb_heater_on, r.mag_hdgXY_deg, r.mag_hdgXZ_deg, r.mag_hdgYZ_deg, r.accelX_mG, r.accelY_mG,
+                    r.accelZ_mG);
+}
+
+static size_t rowLPCFormat(const Row& r, char* out)
+{
+    char* p = LPCFormatText(out, TIME);
+    *p++ = ',';
+    p = LPCFormatUInt(p, r.valid);
+    *p++ = ',';
+    p = LPCFormatUInt(p, r.frame_count);
+    for (float v : {r.air_temp_degC, r.humdity_percent, r.hsensor_temp_degC, r.pres_mb, r.internal_temp_degC}) {
+        *p++ = ',';
+        p = LPCFormatFixed(p, v);
+    }
+    *p++ = ',';
+    p = LPCFormatUInt(p, r.module_status);
+    *p++ = ',';
+    p = LPCFormatUInt(p, r.module_error);
+    *p++ = ',';
+    p = LPCFormatFixed(p, r.pcb_supply_V);
+    *p++ = ',';
+    p = LPCFormatInt(p, r.lsm303_temp_degC);
+    *p++ = ',';
+    p = LPCFormatUInt(p, r.pcb_heater_on);
+    for (float v : {r.mag_hdgXY_deg, r.mag_hdgXZ_deg, r.mag_hdgYZ_deg, r.accelX_mG, r.accelY_mG, r.accelZ_mG}) {
+        *p++ = ',';
+        p = LPCFormatFixed(p, v);
+    }
+    return p - out;
+}
+
+/// @brief Whether some field of the row is exactly halfway between two
+/// values of two decimals
+static bool hasTie(const Row& r)
+{
+    for (float v : {r.air_temp_degC, r.humdity_percent, r.hsensor_temp_degC, r.pres_mb, r.internal_temp_degC,
+                    r.pcb_supply_V, r.mag_hdgXY_deg, r.mag_hdgXZ_deg, r.mag_hdgYZ_deg, r.accelX_mG, r.accelY_mG,
+                    r.accelZ_mG}) {
+        double x = (double)v * 200;
+        if (x == (double)(int64_t)x && ((int64_t)x & 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename F>
+static void bench(const char* name, F format, const std::vector<Row>& rows, std::vector<char>& text)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = cycles();
+    size_t pos = 0;
+    for (const Row& r : rows) {
+        pos += format(r, &text[pos]);
+        text[pos++] = '\n';
+    }
+    uint64_t c1 = cycles();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%-10s %8.1f ns/row", name, secs * 1e9 / rows.size());
+    if (c1 != c0) {
+        printf(" %8.0f cycles/row", (double)(c1 - c0) / rows.size());
+    }
+    printf("  (%zu bytes)\n", pos);
+}
+
+static size_t timeStrftime(time_t t, char* out)
+{
+    struct tm* tm_time = gmtime(&t);
+    return strftime(out, 32, "%Y%m%d%H%M%S", tm_time);
+}
+
+static LPCTimeFormat time_format;
+
+static size_t timeLPCTimeFormat(time_t t, char* out)
+{
+    return time_format.Write(out, t) - out;
+}
+
+template <typename F>
+static void benchTime(const char* name, F format, time_t start, size_t n, std::vector<char>& text)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = cycles();
+    size_t pos = 0;
+    for (size_t i = 0; i < n; i++) {
+        pos += format(start + (time_t)i, &text[pos]);
+    }
+    uint64_t c1 = cycles();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%-13s %8.1f ns/time", name, secs * 1e9 / n);
+    if (c1 != c0) {
+        printf(" %8.0f cycles/time", (double)(c1 - c0) / n);
+    }
+    printf("  (%zu bytes)\n", pos);
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    if (!n) {
+        fprintf(stderr, "usage: lpc_fmtbench [rows]\n");
+        return 1;
+    }
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    std::vector<Row> rows(n);
+    for (size_t i = 0; i < n; i++) {
+        Row& r = rows[i];
+        r.valid = 1;
+        r.frame_count = (uint32_t)i;
+        r.air_temp_degC = -55.0f + 10 * noise(rng);
+        r.humdity_percent = 5.0f + noise(rng);
+        r.hsensor_temp_degC = r.air_temp_degC + 1.0f;
+        r.pres_mb = 70.0f + noise(rng);
+        r.internal_temp_degC = 10.0f + noise(rng);
+        r.module_status = 0;
+        r.module_error = (uint8_t)(i % 97 == 0);
+        r.pcb_supply_V = 3.3f + 0.01f * noise(rng);
+        r.lsm303_temp_degC = (int16_t)(-20 + noise(rng));
+        r.pcb_heater_on = (uint8_t)(i % 2);
+        r.mag_hdgXY_deg = 180.0f + 90 * noise(rng);
+        r.mag_hdgXZ_deg = 90.0f + noise(rng);
+        r.mag_hdgYZ_deg = 45.0f + noise(rng);
+        r.accelX_mG = noise(rng);
+        r.accelY_mG = noise(rng);
+        r.accelZ_mG = 1000.0f + noise(rng);
+    }
+
+    // Check LPCFormat against snprintf. snprintf rounds exact ties to even,
+    // and LPCFormat away from zero, so rows with a tie may differ.
+    size_t ties = 0;
+    size_t differ = 0;
+    for (const Row& r : rows) {
+        char a[512];
+        char b[512];
+        size_t la = rowLPCFormat(r, a);
+        size_t lb = rowSnprintf(r, b);
+        if (la != lb || memcmp(a, b, la)) {
+            if (hasTie(r)) {
+                ties++;
+            } else {
+                differ++;
+                fprintf(stderr, "differ:\n  %.*s\n  %.*s\n", (int)la, a, (int)lb, b);
+            }
+        }
+    }
+    printf("%zu rows, %zu differ from snprintf at exact ties, %zu otherwise\n", n, ties, differ);
+
+    std::vector<char> text(n * 512);
+    bench("string", rowString, rows, text);
+    bench("snprintf", rowSnprintf, rows, text);
+    bench("LPCFormat", rowLPCFormat, rows, text);
+
+    // Timestamps, starting an hour before midnight
+    time_t start = 1767225600 - 3600;
+    size_t time_differ = 0;
+    for (size_t i = 0; i < n; i++) {
+        char a[32];
+        char b[32];
+        size_t la = timeLPCTimeFormat(start + (time_t)i, a);
+        size_t lb = timeStrftime(start + (time_t)i, b);
+        time_differ += (la != lb || memcmp(a, b, la));
+    }
+    printf("\n%zu times, %zu differ from strftime\n", n, time_differ);
+    text.resize(n * 32);
+    benchTime("strftime", timeStrftime, start, n, text);
+    benchTime("LPCTimeFormat", timeLPCTimeFormat, start, n, text);
+
+    return differ || time_differ ? 1 : 0;
+}
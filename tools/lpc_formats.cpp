@@ -0,0 +1,762 @@
+/*
+ *  lpc_formats.cpp
+ *  Created: October 2026
+ *
+ *  Host-side decoders and writers for the LPC local storage and TM formats.
+ *  See lpc_formats.h for the layouts.
+ */
+
+#include "lpc_formats.h"
+#include "LPCCompress.h"
+#include "LPCRS41Pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+namespace lpc {
+
+const char* const HK_NAMES[N_HK] = {
+    "elapsed_s",        // HKData[0]: seconds since MeasurementStartTime
+    "ipump1_ma",
+    "ipump2_ma",
+    "idetector_ma",
+    "vdetector_mv",
+    "vpha_mv",
+    "vteensy_mv",
+    "vbat_mv",
+    "flow_ccm",
+    "pump1_pwm",
+    "pump2_pwm",
+    "tpump1_ck",        // Temperatures are Kelvin * 100
+    "tpump2_ck",
+    "tlaser_ck",
+    "tpcb_ck",
+    "tinlet_ck",
+};
+
+size_t colTypeSize(ColType type)
+{
+    switch (type) {
+    case COL_U8:  return 1;
+    case COL_U16: return 2;
+    case COL_U32: return 4;
+    case COL_I64: return 8;
+    case COL_F32: return 4;
+    }
+    return 1;
+}
+
+double Column::asDouble(size_t i) const
+{
+    if (type == COL_F32) {
+        float v;
+        memcpy(&v, &data[i * 4], 4);
+        return v;
+    }
+    return (double)asInt(i);
+}
+
+int64_t Column::asInt(size_t i) const
+{
+    switch (type) {
+    case COL_U8:
+        return data[i];
+    case COL_U16: {
+        uint16_t v;
+        memcpy(&v, &data[i * 2], 2);
+        return v;
+    }
+    case COL_U32: {
+        uint32_t v;
+        memcpy(&v, &data[i * 4], 4);
+        return v;
+    }
+    case COL_I64: {
+        int64_t v;
+        memcpy(&v, &data[i * 8], 8);
+        return v;
+    }
+    case COL_F32:
+        return (int64_t)asDouble(i);
+    }
+    return 0;
+}
+
+void Table::append(const Table& other)
+{
+    for (size_t c = 0; c < cols.size() && c < other.cols.size(); c++) {
+        cols[c].data.insert(cols[c].data.end(), other.cols[c].data.begin(), other.cols[c].data.end());
+    }
+}
+
+Table makeLpcTable()
+{
+    Table t("lpc");
+    t.add("file_id", COL_U32);
+    t.add("start_time", COL_U32);
+    t.add("record", COL_U16);
+    t.add("time", COL_U32);
+    char name[16];
+    for (int i = 0; i < N_BINS / 2; i++) {
+        snprintf(name, sizeof(name), "hg_bin_%02d", i);
+        t.add(name, COL_U16);
+    }
+    for (int i = 0; i < N_BINS / 2; i++) {
+        snprintf(name, sizeof(name), "lg_bin_%02d", i);
+        t.add(name, COL_U16);
+    }
+    for (int i = 0; i < N_HK; i++) {
+        t.add(HK_NAMES[i], COL_U16);
+    }
+    return t;
+}
+
+Table makeRs41TmTable()
+{
+    Table t("rs41_tm");
+    t.add("file_id", COL_U32);
+    t.add("time", COL_U32);
+    t.add("valid", COL_U8);
+    t.add("secs", COL_U32);
+    t.add("air_temp_degC", COL_F32);
+    t.add("humdity_percent", COL_F32);
+    t.add("hsensor_temp_degC", COL_F32);
+    t.add("pres_mb", COL_F32);
+    t.add("error", COL_U16);
+    return t;
+}
+
+/// The RS41A window fields, with the scaling of the rs41TmSample_t fields
+static const struct {
+    const char* name;
+    float scale;
+    float offset;
+} RS41_AGG_FIELD_DEFS[RS41_AGG_FIELDS] = {
+    {"air_temp_degC", 100.0f, -100.0f},
+    {"humdity_percent", 100.0f, 0.0f},
+    {"hsensor_temp_degC", 100.0f, -100.0f},
+    {"pres_mb", 50.0f, 0.0f},
+};
+
+Table makeRs41AggTable()
+{
+    Table t("rs41_agg");
+    t.add("file_id", COL_U32);
+    t.add("time", COL_U32);
+    t.add("window_secs", COL_U16);
+    t.add("n", COL_U8);
+    t.add("n_valid", COL_U8);
+    t.add("error", COL_U16);
+    for (int f = 0; f < RS41_AGG_FIELDS; f++) {
+        for (const char* stat : {"mean", "min", "max"}) {
+            t.add(std::string(RS41_AGG_FIELD_DEFS[f].name) + "_" + stat, COL_F32);
+        }
+    }
+    return t;
+}
+
+/// The fields of the StratoLPC::SendMemoryTelemetry() payload, after time
+static const char* const MEM_FIELDS[] = {
+    "uptime_s", "stack_used", "stack_size", "heap_in_use", "heap_peak", "heap_free",
+    "heap_largest", "allocs", "frees", "alloc_failures", "arena_peak", "arena_size",
+    "reset_cause", "boot_ms",
+};
+static const int N_MEM_FIELDS = sizeof(MEM_FIELDS) / sizeof(MEM_FIELDS[0]);
+/// Fields sent before the boot ones were added; those are 0 when absent
+static const int N_MEM_FIELDS_REQUIRED = 12;
+
+Table makeMemTable()
+{
+    Table t("mem");
+    t.add("file_id", COL_U32);
+    t.add("time", COL_U32);
+    for (int i = 0; i < N_MEM_FIELDS; i++) {
+        t.add(MEM_FIELDS[i], COL_U32);
+    }
+    return t;
+}
+
+/// The fields of StratoLPC::rs41CsvHeader(), after Time
+static const struct {
+    const char* name;
+    ColType type;
+} RS41_CSV_FIELDS[] = {
+    {"valid", COL_U8},
+    {"frame_count", COL_U32},
+    {"air_temp_degC", COL_F32},
+    {"humdity_percent", COL_F32},
+    {"hsensor_temp_degC", COL_F32},
+    {"pres_mb", COL_F32},
+    {"internal_temp_degC", COL_F32},
+    {"module_status", COL_U16},
+    {"module_error", COL_U16},
+    {"pcb_supply_V", COL_F32},
+    {"lsm303_temp_degC", COL_F32},
+    {"pcb_heater_on", COL_U8},
+    {"mag_hdgXY_deg", COL_F32},
+    {"mag_hdgXZ_deg", COL_F32},
+    {"mag_hdgYZ_deg", COL_F32},
+    {"accelX_mG", COL_F32},
+    {"accelY_mG", COL_F32},
+    {"accelZ_mG", COL_F32},
+};
+static const int N_RS41_CSV_FIELDS = sizeof(RS41_CSV_FIELDS) / sizeof(RS41_CSV_FIELDS[0]);
+
+Table makeRs41CsvTable()
+{
+    Table t("rs41_csv");
+    t.add("file_id", COL_U32);
+    t.add("time", COL_I64);
+    for (int i = 0; i < N_RS41_CSV_FIELDS; i++) {
+        t.add(RS41_CSV_FIELDS[i].name, RS41_CSV_FIELDS[i].type);
+    }
+    return t;
+}
+
+// ---------------------------------------------------------------------------
+// TM decoding
+// ---------------------------------------------------------------------------
+
+static inline uint16_t be16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+static inline uint32_t be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static const uint8_t* find(const uint8_t* from, const uint8_t* end, const char* needle)
+{
+    if (from >= end) {
+        return nullptr;
+    }
+    return (const uint8_t*)memmem(from, end - from, needle, strlen(needle));
+}
+
+/// @brief Extract the text between <tag> and </tag> within [from, end)
+static bool tagValue(const uint8_t* from, const uint8_t* end, const char* tag, std::string& value)
+{
+    std::string open = std::string("<") + tag + ">";
+    std::string close = std::string("</") + tag + ">";
+    const uint8_t* b = find(from, end, open.c_str());
+    if (!b) {
+        return false;
+    }
+    b += open.size();
+    const uint8_t* e = find(b, end, close.c_str());
+    if (!e) {
+        return false;
+    }
+    value.assign((const char*)b, e - b);
+    return true;
+}
+
+static void error(Decoded& out, const char* what)
+{
+    out.errors++;
+    if (out.error_text.empty()) {
+        out.error_text = what;
+    }
+}
+
+static const size_t LPC_RECORD_BYTES = (N_BINS + N_HK) * 2;
+
+/// @brief Emit the LPC records that follow a payload header
+static void decodeLpcRecords(const uint8_t* p, size_t header_bytes, size_t len,
+                             uint32_t start_time, uint16_t first_record,
+                             uint32_t file_id, Decoded& out)
+{
+    if ((len - header_bytes) % LPC_RECORD_BYTES) {
+        error(out, "LPC payload is not a whole number of records");
+    }
+
+    const uint8_t* r = p + header_bytes;
+    size_t n_records = (len - header_bytes) / LPC_RECORD_BYTES;
+
+    Table& t = out.lpc;
+    for (size_t rec = 0; rec < n_records; rec++, r += LPC_RECORD_BYTES) {
+        const uint8_t* hk = r + N_BINS * 2;
+        t.cols[0].push<uint32_t>(file_id);
+        t.cols[1].push<uint32_t>(start_time);
+        t.cols[2].push<uint16_t>((uint16_t)(first_record + rec));
+        t.cols[3].push<uint32_t>(start_time + be16(hk));
+        for (int i = 0; i < N_BINS; i++) {
+            t.cols[4 + i].push<uint16_t>(be16(r + 2 * i));
+        }
+        for (int i = 0; i < N_HK; i++) {
+            t.cols[4 + N_BINS + i].push<uint16_t>(be16(hk + 2 * i));
+        }
+    }
+}
+
+/// @brief Decode the PackageTelemetry() payload
+static void decodeLpcPayload(const uint8_t* p, size_t len, uint32_t file_id, Decoded& out)
+{
+    const size_t header_bytes = 4 + N_HK * 2;
+    if (len < header_bytes) {
+        error(out, "LPC payload too short");
+        return;
+    }
+    // The initial HK block repeats the HK of record 0, so it is not emitted.
+    decodeLpcRecords(p, header_bytes, len, be32(p), 0, file_id, out);
+}
+
+/// @brief Decode a streamed PackageTelemetry() chunk payload
+static void decodeLpcChunkPayload(const uint8_t* p, size_t len, uint32_t file_id, Decoded& out)
+{
+    // start time, chunk number, first record, final flag
+    const size_t header_bytes = 4 + 2 + 2 + 1;
+    if (len < header_bytes) {
+        error(out, "LPC chunk payload too short");
+        return;
+    }
+    decodeLpcRecords(p, header_bytes, len, be32(p), be16(p + 6), file_id, out);
+}
+
+/// @brief Decode the rs41SendTelemetry() payload
+static void decodeRs41TmPayload(const uint8_t* p, size_t len, uint32_t file_id, Decoded& out)
+{
+    if (len < 6) {
+        error(out, "RS41 payload too short");
+        return;
+    }
+    uint32_t time_stamp = be32(p);
+    size_t n_samples = be16(p + 4);
+    if (6 + n_samples * RS41_TM_SAMPLE_BYTES > len) {
+        error(out, "RS41 payload shorter than its sample count");
+        n_samples = (len - 6) / RS41_TM_SAMPLE_BYTES;
+    }
+    if (!n_samples) {
+        return;
+    }
+
+    // The time stamp is taken when the last sample is sent, and secs is
+    // counted from the start of the collection.
+    const uint8_t* s = p + 6;
+    uint32_t last_secs = be32(s + (n_samples - 1) * RS41_TM_SAMPLE_BYTES + 1);
+    uint32_t start_time = time_stamp - last_secs;
+
+    Table& t = out.rs41_tm;
+    for (size_t i = 0; i < n_samples; i++, s += RS41_TM_SAMPLE_BYTES) {
+        uint32_t secs = be32(s + 1);
+        t.cols[0].push<uint32_t>(file_id);
+        t.cols[1].push<uint32_t>(start_time + secs);
+        t.cols[2].push<uint8_t>(s[0]);
+        t.cols[3].push<uint32_t>(secs);
+        t.cols[4].push<float>(be16(s + 5) / 100.0f - 100.0f);
+        t.cols[5].push<float>(be16(s + 7) / 100.0f);
+        t.cols[6].push<float>(be16(s + 9) / 100.0f - 100.0f);
+        t.cols[7].push<float>(be16(s + 11) / 50.0f);
+        t.cols[8].push<uint16_t>(be16(s + 13));
+    }
+}
+
+/// @brief Decode the packed rs41SendTelemetry() payload (LPCRS41Pack)
+static void decodeRs41PackedPayload(const uint8_t* p, size_t len, uint32_t file_id, Decoded& out)
+{
+    std::vector<rs41TmSample_t> samples(UINT16_MAX);
+    uint32_t start_time;
+    int n_samples = LPCRS41Unpack(p, len, &start_time, samples.data(), (int)samples.size());
+    if (n_samples < 0) {
+        error(out, "RS41D payload is corrupt");
+        return;
+    }
+
+    Table& t = out.rs41_tm;
+    for (int i = 0; i < n_samples; i++) {
+        const rs41TmSample_t& s = samples[i];
+        t.cols[0].push<uint32_t>(file_id);
+        t.cols[1].push<uint32_t>(start_time + s.secs);
+        t.cols[2].push<uint8_t>(s.valid);
+        t.cols[3].push<uint32_t>(s.secs);
+        t.cols[4].push<float>(s.valid ? s.tdry / 100.0f - 100.0f : 0.0f);
+        t.cols[5].push<float>(s.valid ? s.humidity / 100.0f : 0.0f);
+        t.cols[6].push<float>(s.valid ? s.tsensor / 100.0f - 100.0f : 0.0f);
+        t.cols[7].push<float>(s.valid ? s.pres / 50.0f : 0.0f);
+        t.cols[8].push<uint16_t>(s.error);
+    }
+}
+
+/// @brief Decode the rs41SendAggregateTelemetry() payload
+static void decodeRs41AggPayload(const uint8_t* p, size_t len, uint32_t file_id, Decoded& out)
+{
+    if (len < 8) {
+        error(out, "RS41A payload too short");
+        return;
+    }
+    uint32_t base = be32(p);
+    uint16_t window_secs = be16(p + 4);
+    size_t n_windows = be16(p + 6);
+    if (8 + n_windows * RS41_AGG_BYTES > len) {
+        error(out, "RS41A payload shorter than its window count");
+        n_windows = (len - 8) / RS41_AGG_BYTES;
+    }
+
+    Table& t = out.rs41_agg;
+    const uint8_t* w = p + 8;
+    for (size_t i = 0; i < n_windows; i++, w += RS41_AGG_BYTES) {
+        t.cols[0].push<uint32_t>(file_id);
+        t.cols[1].push<uint32_t>(base + be16(w));
+        t.cols[2].push<uint16_t>(window_secs);
+        t.cols[3].push<uint8_t>(w[2]);
+        t.cols[4].push<uint8_t>(w[3]);
+        t.cols[5].push<uint16_t>(be16(w + 4));
+        for (int f = 0; f < RS41_AGG_FIELDS; f++) {
+            for (int stat = 0; stat < 3; stat++) {
+                float v = be16(w + 6 + 2 * (3 * f + stat)) / RS41_AGG_FIELD_DEFS[f].scale + RS41_AGG_FIELD_DEFS[f].offset;
+                t.cols[6 + 3 * f + stat].push<float>(v);
+            }
+        }
+    }
+}
+
+/// @brief Decode the SendMemoryTelemetry() payload
+static void decodeMemTmPayload(const uint8_t* p, size_t len, uint32_t file_id, Decoded& out)
+{
+    if (len < 4 * (1 + (size_t)N_MEM_FIELDS_REQUIRED)) {
+        error(out, "MEM payload too short");
+        return;
+    }
+    Table& t = out.mem;
+    t.cols[0].push<uint32_t>(file_id);
+    for (int i = 0; i <= N_MEM_FIELDS; i++) {
+        t.cols[1 + i].push<uint32_t>(4 * (size_t)(i + 1) <= len ? be32(p + 4 * i) : 0);
+    }
+}
+
+void decodeTm(const uint8_t* buf, size_t len, uint32_t file_id, Decoded& out)
+{
+    const uint8_t* end = buf + len;
+    const uint8_t* pos = buf;
+
+    while (true) {
+        const uint8_t* tm = find(pos, end, "<TM>");
+        if (!tm) {
+            break;
+        }
+        const uint8_t* tm_end = find(tm, end, "</TM>");
+        if (!tm_end) {
+            error(out, "Truncated TM header");
+            break;
+        }
+
+        std::string length_text;
+        std::string mess2;
+        if (!tagValue(tm, tm_end, "Length", length_text)) {
+            error(out, "TM header has no Length");
+            pos = tm_end;
+            continue;
+        }
+        tagValue(tm, tm_end, "StateMess2", mess2);
+        size_t length = strtoul(length_text.c_str(), nullptr, 10);
+
+        const uint8_t* start = find(tm_end, end, "START");
+        if (!start) {
+            error(out, "TM has no START marker");
+            break;
+        }
+        const uint8_t* payload = start + 5;
+        if (payload + length + 2 + 3 > end) {
+            error(out, "TM payload is truncated");
+            break;
+        }
+        if (memcmp(payload + length + 2, "END", 3)) {
+            error(out, "TM payload is not followed by END");
+        }
+
+        if (mess2 == "RS41") {
+            decodeRs41TmPayload(payload, length, file_id, out);
+        } else if (mess2 == "RS41D") {
+            decodeRs41PackedPayload(payload, length, file_id, out);
+        } else if (mess2 == "RS41A") {
+            decodeRs41AggPayload(payload, length, file_id, out);
+        } else if (mess2 == "MEM") {
+            decodeMemTmPayload(payload, length, file_id, out);
+        } else if (mess2.compare(0, 4, "LPCC") == 0) {
+            decodeLpcChunkPayload(payload, length, file_id, out);
+        } else {
+            decodeLpcPayload(payload, length, file_id, out);
+        }
+        out.messages++;
+        pos = payload + length + 2 + 3;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// RS41 CSV decoding
+// ---------------------------------------------------------------------------
+
+static int64_t daysFromCivil(int y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t)era * 146097 + (int64_t)doe - 719468;
+}
+
+int64_t parseTimeString(const char* s, size_t len)
+{
+    if (len != 14) {
+        return -1;
+    }
+    int v[14];
+    for (int i = 0; i < 14; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return -1;
+        }
+        v[i] = s[i] - '0';
+    }
+    int year = v[0] * 1000 + v[1] * 100 + v[2] * 10 + v[3];
+    int month = v[4] * 10 + v[5];
+    int day = v[6] * 10 + v[7];
+    int hour = v[8] * 10 + v[9];
+    int minute = v[10] * 10 + v[11];
+    int second = v[12] * 10 + v[13];
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        return -1;
+    }
+    return daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+void decodeRs41Csv(const uint8_t* buf, size_t len, uint32_t file_id, Decoded& out)
+{
+    const char* p = (const char*)buf;
+    const char* end = p + len;
+    // A file that was never closed keeps its preallocated size, and the
+    // unwritten part of the extent reads back as erased 0x00 or 0xFF bytes.
+    for (const char* q = p; q < end; q++) {
+        if (*q == '\0' || *q == '\xff') {
+            end = q;
+            break;
+        }
+    }
+    bool header = true;
+    char line[512];
+    Table& t = out.rs41_csv;
+
+    while (p < end) {
+        const char* eol = (const char*)memchr(p, '\n', end - p);
+        if (!eol) {
+            eol = end;
+        }
+        size_t n = eol - p;
+        if (n && p[n - 1] == '\r') {
+            n--;
+        }
+        if (header) {
+            header = false;
+            if (n < 5 || memcmp(p, "Time,", 5)) {
+                error(out, "RS41 CSV header missing");
+                return;
+            }
+        } else if (n) {
+            if (n >= sizeof(line)) {
+                error(out, "RS41 CSV line too long");
+            } else {
+                memcpy(line, p, n);
+                line[n] = '\0';
+
+                char* fields[1 + N_RS41_CSV_FIELDS];
+                int nf = 0;
+                char* f = line;
+                while (nf < 1 + N_RS41_CSV_FIELDS) {
+                    fields[nf++] = f;
+                    char* comma = strchr(f, ',');
+                    if (!comma) {
+                        break;
+                    }
+                    *comma = '\0';
+                    f = comma + 1;
+                }
+                int64_t secs = parseTimeString(fields[0], strlen(fields[0]));
+                if (nf != 1 + N_RS41_CSV_FIELDS || secs < 0) {
+                    error(out, "Malformed RS41 CSV row");
+                } else {
+                    t.cols[0].push<uint32_t>(file_id);
+                    t.cols[1].push<int64_t>(secs);
+                    for (int i = 0; i < N_RS41_CSV_FIELDS; i++) {
+                        Column& c = t.cols[2 + i];
+                        switch (c.type) {
+                        case COL_U8:
+                            c.push<uint8_t>((uint8_t)strtoul(fields[1 + i], nullptr, 10));
+                            break;
+                        case COL_U16:
+                            c.push<uint16_t>((uint16_t)strtoul(fields[1 + i], nullptr, 10));
+                            break;
+                        case COL_U32:
+                            c.push<uint32_t>((uint32_t)strtoul(fields[1 + i], nullptr, 10));
+                            break;
+                        default:
+                            c.push<float>(strtof(fields[1 + i], nullptr));
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        p = eol + 1;
+    }
+    out.messages++;
+}
+
+// ---------------------------------------------------------------------------
+// Compressed files
+// ---------------------------------------------------------------------------
+
+bool decompressLzb(const uint8_t* buf, size_t len, std::vector<uint8_t>& out, std::string& err)
+{
+    const size_t magic_len = strlen(LPC_COMPRESS_MAGIC);
+    if (len < magic_len || memcmp(buf, LPC_COMPRESS_MAGIC, magic_len)) {
+        err = "Missing LZB1 magic";
+        return false;
+    }
+    uint8_t block[LPC_COMPRESS_BLOCK_SIZE];
+    size_t p = magic_len;
+    while (p + LPC_COMPRESS_FRAME_HEADER <= len) {
+        uint16_t raw_len = buf[p] | (buf[p + 1] << 8);
+        uint16_t comp_len = buf[p + 2] | (buf[p + 3] << 8);
+        // Erased sectors past the end of a file that was never closed
+        if (raw_len == 0 || raw_len == 0xFFFF) {
+            return true;
+        }
+        p += LPC_COMPRESS_FRAME_HEADER;
+        if (raw_len > LPC_COMPRESS_BLOCK_SIZE) {
+            err = "Block length out of range";
+            return false;
+        }
+        size_t stored = comp_len ? comp_len : raw_len;
+        if (p + stored > len) {
+            err = "Truncated block";
+            return false;
+        }
+        if (!comp_len) {
+            out.insert(out.end(), buf + p, buf + p + raw_len);
+        } else {
+            int n = LPCDecompressBlock(buf + p, comp_len, block, sizeof(block));
+            if (n != raw_len) {
+                err = "Corrupt block";
+                return false;
+            }
+            out.insert(out.end(), block, block + n);
+        }
+        p += stored;
+    }
+    return true;
+}
+
+void compressLzb(const uint8_t* buf, size_t len, std::vector<uint8_t>& out)
+{
+    LPCCompressStream stream;
+    const uint8_t* frame;
+    out.insert(out.end(), LPC_COMPRESS_MAGIC, LPC_COMPRESS_MAGIC + strlen(LPC_COMPRESS_MAGIC));
+    size_t p = 0;
+    while (p < len) {
+        p += stream.Append(buf + p, len - p);
+        if (stream.Full()) {
+            size_t n = stream.Finish(&frame);
+            out.insert(out.end(), frame, frame + n);
+        }
+    }
+    size_t n = stream.Finish(&frame);
+    out.insert(out.end(), frame, frame + n);
+}
+
+// ---------------------------------------------------------------------------
+// Writers
+// ---------------------------------------------------------------------------
+
+std::string csvHeader(const Table& t)
+{
+    std::string h;
+    for (size_t c = 0; c < t.cols.size(); c++) {
+        if (c) {
+            h += ',';
+        }
+        h += t.cols[c].name;
+    }
+    h += '\n';
+    return h;
+}
+
+void formatCsvRows(const Table& t, size_t first, size_t last, std::string& out)
+{
+    char num[32];
+    for (size_t r = first; r < last; r++) {
+        for (size_t c = 0; c < t.cols.size(); c++) {
+            const Column& col = t.cols[c];
+            int n;
+            if (col.type == COL_F32) {
+                n = snprintf(num, sizeof(num), "%.7g", col.asDouble(r));
+            } else {
+                n = snprintf(num, sizeof(num), "%lld", (long long)col.asInt(r));
+            }
+            if (c) {
+                out += ',';
+            }
+            out.append(num, n);
+        }
+        out += '\n';
+    }
+}
+
+bool writeColumnar(const Table& t, const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    uint32_t version = 1;
+    uint32_t ncols = (uint32_t)t.cols.size();
+    uint64_t nrows = t.rows();
+    bool ok = fwrite("LCOL", 1, 4, f) == 4;
+    ok = ok && fwrite(&version, sizeof(version), 1, f) == 1;
+    ok = ok && fwrite(&ncols, sizeof(ncols), 1, f) == 1;
+    ok = ok && fwrite(&nrows, sizeof(nrows), 1, f) == 1;
+    for (const Column& c : t.cols) {
+        uint8_t type = c.type;
+        uint16_t name_len = (uint16_t)c.name.size();
+        ok = ok && fwrite(&type, 1, 1, f) == 1;
+        ok = ok && fwrite(&name_len, sizeof(name_len), 1, f) == 1;
+        ok = ok && fwrite(c.name.data(), 1, name_len, f) == name_len;
+    }
+    for (const Column& c : t.cols) {
+        ok = ok && fwrite(c.data.data(), 1, c.data.size(), f) == c.data.size();
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+bool readColumnar(const std::string& path, Table& t)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t ncols = 0;
+    uint64_t nrows = 0;
+    bool ok = fread(magic, 1, 4, f) == 4 && !memcmp(magic, "LCOL", 4);
+    ok = ok && fread(&version, sizeof(version), 1, f) == 1 && version == 1;
+    ok = ok && fread(&ncols, sizeof(ncols), 1, f) == 1;
+    ok = ok && fread(&nrows, sizeof(nrows), 1, f) == 1;
+    t.cols.clear();
+    for (uint32_t i = 0; ok && i < ncols; i++) {
+        uint8_t type;
+        uint16_t name_len;
+        ok = fread(&type, 1, 1, f) == 1 && type <= COL_F32;
+        ok = ok && fread(&name_len, sizeof(name_len), 1, f) == 1;
+        std::string name(name_len, '\0');
+        ok = ok && fread(&name[0], 1, name_len, f) == name_len;
+        t.add(name, (ColType)type);
+    }
+    for (size_t i = 0; ok && i < t.cols.size(); i++) {
+        Column& c = t.cols[i];
+        c.data.resize(nrows * colTypeSize(c.type));
+        ok = fread(c.data.data(), 1, c.data.size(), f) == c.data.size();
+    }
+    fclose(f);
+    return ok;
+}
+
+} // namespace lpc
@@ -0,0 +1,167 @@
+/*
+ *  lpc_formats.h
+ *  Created: October 2026
+ *
+ *  Host-side definitions of the LPC local storage and TM formats, and the
+ *  column tables that the ground tools decode them into.
+ *
+ *  The layouts mirror the instrument code exactly:
+ *   - LPC_*.ready_tm  StratoLPC::writeLPCHeaderToSD(), a facsimile of the
+ *                     XMLWriter TM message, with the PackageTelemetry() binary
+ *                     payload. When the cycle is streamed in chunks
+ *                     (StateMess2 starts with "LPCC") the file holds one
+ *                     message per chunk.
+ *   - RS41 TM         StratoLPC::rs41SendTelemetry(), identified by
+ *                     StateMess2 == "RS41".
+ *   - RS41D TM        The packed form of the RS41 TM (src/LPCRS41Pack.h),
+ *                     identified by StateMess2 == "RS41D".
+ *   - RS41A TM        StratoLPC::rs41SendAggregateTelemetry(), aggregated
+ *                     window statistics, identified by StateMess2 == "RS41A".
+ *   - RS41_*.csv      StratoLPC::rs41LocalStorage() / rs41CsvData().
+ *   - MEM TM          StratoLPC::SendMemoryTelemetry(), identified by
+ *                     StateMess2 == "MEM".
+ *
+ *  XMLWriter::addTm() serializes multi-byte values most significant byte
+ *  first, so all binary payload fields are big-endian.
+ */
+
+#ifndef LPC_FORMATS_H
+#define LPC_FORMATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace lpc {
+
+/// Number of aerosol bins in one LPC record (16 high gain + 16 low gain)
+const int N_BINS = 32;
+/// Number of housekeeping channels in one LPC record
+const int N_HK = 16;
+/// Bytes in the RS41 TM sample (valid, secs, tdry, humidity, tsensor, pres, error)
+const int RS41_TM_SAMPLE_BYTES = 1 + 4 + 2 + 2 + 2 + 2 + 2;
+/// Fields with statistics in an RS41A window (tdry, humidity, tsensor, pres)
+const int RS41_AGG_FIELDS = 4;
+/// Bytes in an RS41A window (offset, n, n_valid, error, mean/min/max per field)
+const int RS41_AGG_BYTES = 2 + 1 + 1 + 2 + 3 * 2 * RS41_AGG_FIELDS;
+
+/// Names of the LPC housekeeping channels, in HKData[] order (see StratoLPC::ReadHK)
+extern const char* const HK_NAMES[N_HK];
+
+// ---------------------------------------------------------------------------
+// Columnar tables
+// ---------------------------------------------------------------------------
+
+enum ColType : uint8_t {
+    COL_U8 = 0,
+    COL_U16 = 1,
+    COL_U32 = 2,
+    COL_I64 = 3,
+    COL_F32 = 4,
+};
+
+/// @brief Size in bytes of one element of a column type
+size_t colTypeSize(ColType type);
+
+/// @brief One typed column. Values are kept in host byte order.
+struct Column {
+    std::string name;
+    ColType type;
+    std::vector<uint8_t> data;
+
+    size_t rows() const { return data.size() / colTypeSize(type); }
+
+    template <typename T> void push(T value) {
+        size_t n = data.size();
+        data.resize(n + sizeof(T));
+        memcpy(&data[n], &value, sizeof(T));
+    }
+    /// @brief Fetch element i, widened to double (used for CSV output)
+    double asDouble(size_t i) const;
+    /// @brief Fetch element i, widened to int64 (used for CSV output)
+    int64_t asInt(size_t i) const;
+};
+
+/// @brief A set of equal length columns
+struct Table {
+    std::string name;
+    std::vector<Column> cols;
+
+    Table() {}
+    Table(const std::string& table_name) : name(table_name) {}
+
+    void add(const std::string& col_name, ColType type) { cols.push_back(Column{col_name, type, {}}); }
+    size_t rows() const { return cols.empty() ? 0 : cols[0].rows(); }
+    /// @brief Append all rows of other (which must have the same schema)
+    void append(const Table& other);
+};
+
+/// @brief Empty tables with the schema for each decoded product
+Table makeLpcTable();
+Table makeRs41TmTable();
+Table makeRs41CsvTable();
+Table makeRs41AggTable();
+Table makeMemTable();
+
+/// @brief The decoded contents of one input file
+struct Decoded {
+    Table lpc = makeLpcTable();
+    Table rs41_tm = makeRs41TmTable();
+    Table rs41_csv = makeRs41CsvTable();
+    Table rs41_agg = makeRs41AggTable();
+    Table mem = makeMemTable();
+    int messages = 0;
+    int errors = 0;
+    std::string error_text;
+};
+
+// ---------------------------------------------------------------------------
+// Decoders
+// ---------------------------------------------------------------------------
+
+/// @brief Decode a buffer containing one or more TM messages.
+/// This covers LPC_*.ready_tm files, and raw TM captures that may hold
+/// a sequence of LPC and RS41 messages.
+void decodeTm(const uint8_t* buf, size_t len, uint32_t file_id, Decoded& out);
+
+/// @brief Decode an RS41_*.csv local storage file
+void decodeRs41Csv(const uint8_t* buf, size_t len, uint32_t file_id, Decoded& out);
+
+/// @brief Expand an LPCCompress (LZB1) file image
+/// @return false, with err set, if the stream is corrupt. out holds
+/// everything decoded up to the error.
+bool decompressLzb(const uint8_t* buf, size_t len, std::vector<uint8_t>& out, std::string& err);
+
+/// @brief Compress a buffer into an LZB1 file image, as the instrument would
+void compressLzb(const uint8_t* buf, size_t len, std::vector<uint8_t>& out);
+
+/// @brief Convert a YYYYMMDDHHmmSS string (StratoLPC::TimeString) to seconds since 1970.
+/// @return -1 if the text is malformed
+int64_t parseTimeString(const char* s, size_t len);
+
+// ---------------------------------------------------------------------------
+// Writers
+// ---------------------------------------------------------------------------
+
+/// @brief Render rows [first, last) of a table as CSV text (no header)
+void formatCsvRows(const Table& t, size_t first, size_t last, std::string& out);
+
+/// @brief The CSV header line for a table
+std::string csvHeader(const Table& t);
+
+/// @brief Write a table in the LCOL binary columnar format.
+///
+/// Layout (little-endian):
+///   "LCOL" u32 version u32 ncols u64 nrows
+///   ncols x { u8 type, u16 name_len, name bytes }
+///   ncols x { nrows * sizeof(type) column values }
+bool writeColumnar(const Table& t, const std::string& path);
+
+/// @brief Read an LCOL file back into a table
+bool readColumnar(const std::string& path, Table& t);
+
+} // namespace lpc
+
+#endif /* LPC_FORMATS_H */
@@ -0,0 +1,109 @@
+/*
+ *  lpc_logdump.cpp
+ *  Created: October 2026
+ *
+ *  Expands a capture of the instrument's debug port (see src/LPCLog.h).
+ *  Binary log records become "[seconds] L text" lines, using the message
+ *  table the firmware was built with; text written directly by StratoCore
+ *  is passed through unchanged. Reads the named files, or stdin.
+ *
+ *  Usage: lpc_logdump [file...]
+ */
+
+#include "LPCLogTable.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+class LogDumper {
+public:
+    void Feed(int c)
+    {
+        if (record.empty()) {
+            if (c == LPC_LOG_SYNC) {
+                record.push_back((uint8_t)c);
+            } else {
+                putchar(c);
+            }
+            return;
+        }
+
+        record.push_back((uint8_t)c);
+        if (record.size() == 3 && (record[1] >= LPC_LOG_NUM_IDS || record[2] > LPC_LOG_MAX_ARGS)) {
+            // not a record after all
+            Flush();
+            return;
+        }
+        if (record.size() >= LPC_LOG_HEADER_BYTES && record.size() == LPC_LOG_HEADER_BYTES + 4u * record[2]) {
+            Print();
+            record.clear();
+        }
+    }
+
+    /// @brief Pass an incomplete record through as it was
+    void Flush()
+    {
+        fwrite(record.data(), 1, record.size(), stdout);
+        record.clear();
+    }
+
+private:
+    void Print()
+    {
+        uint32_t ms = le32(&record[3]);
+        uint32_t args[LPC_LOG_MAX_ARGS];
+        for (uint8_t i = 0; i < record[2]; i++) {
+            args[i] = le32(&record[LPC_LOG_HEADER_BYTES + 4 * i]);
+        }
+
+        char text[256];
+        LPCLogExpand(text, sizeof(text), record[1], args, record[2]);
+        printf("[%u.%03u] %c %s\n", ms / 1000, ms % 1000,
+               LPCLogLevelName(LPCLogLevel((LPCLogId)record[1])), text);
+    }
+
+    static uint32_t le32(const uint8_t* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    std::vector<uint8_t> record;
+};
+
+static void dump(FILE* f)
+{
+    LogDumper dumper;
+    int c;
+    while ((c = getc(f)) != EOF) {
+        dumper.Feed(c);
+    }
+    dumper.Flush();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        dump(stdin);
+        return 0;
+    }
+
+    int rc = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a[0] == '-') {
+            fprintf(stderr, "usage: lpc_logdump [file...]\n");
+            return 1;
+        }
+        FILE* f = fopen(a.c_str(), "rb");
+        if (!f) {
+            fprintf(stderr, "%s: unable to read\n", a.c_str());
+            rc = 1;
+            continue;
+        }
+        dump(f);
+        fclose(f);
+    }
+    return rc;
+}
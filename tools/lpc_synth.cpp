@@ -0,0 +1,328 @@
+/*
+ *  lpc_synth.cpp
+ *  Created: October 2026
+ *
+ *  Generates a synthetic flight's worth of LPC local storage files and TM
+ *  captures, byte-for-byte in the formats written by StratoLPC, for
+ *  exercising and benchmarking the ground tools.
+ *
+ *  Per simulated day this produces:
+ *   - one LPC_*.ready_tm per measurement cycle (writeLPCHeaderToSD), holding
+ *     one TM message, or one per chunk with -k (LPC_STREAM_CHUNK_RECORDS)
+ *   - one RS41_*.csv per RS41_N_SAMPLES_TO_REPORT seconds (rs41LocalStorage)
+ *   - one TM_*.tm capture holding the LPC, RS41 and hourly MEM TM messages
+ *     of the day
+ *
+ *  With -a, the RS41 TM is the aggregated RS41A window statistics
+ *  (rs41SendAggregateTelemetry) over windows of the given length, computed
+ *  from the same 1 Hz samples.
+ *
+ *  With -p, the RS41 TM is packed as RS41D (LPCRS41Pack), as with
+ *  RS41_TM_FORMAT 2.
+ *
+ *  Usage: lpc_synth [-d days] [-c cycle_minutes] [-n samples] [-k chunk] [-a window_secs] [-p] [-o outdir]
+ */
+
+#include "LPCRS41Pack.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/// Matches RS41_N_SAMPLES_TO_REPORT in StratoLPC.h
+static const int RS41_N_SAMPLES = 300;
+/// Flight start: 2026-01-01T00:00:00Z
+static const time_t FLIGHT_START = 1767225600;
+
+static std::string timeString(time_t t)
+{
+    char buf[32];
+    struct tm tm_time;
+    gmtime_r(&t, &tm_time);
+    strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", &tm_time);
+    return buf;
+}
+
+/// @brief Big-endian payload builder, matching XMLWriter::addTm()
+struct Payload {
+    std::vector<uint8_t> b;
+    void add(uint8_t v) { b.push_back(v); }
+    void add(uint16_t v)
+    {
+        b.push_back(v >> 8);
+        b.push_back(v & 0xFF);
+    }
+    void add(uint32_t v)
+    {
+        add((uint16_t)(v >> 16));
+        add((uint16_t)(v & 0xFFFF));
+    }
+};
+
+/// @brief The XML header, as built by StratoLPC::writeLPCHeaderToSD()
+static std::string tmHeader(const std::string& mess1, const std::string& mess2, size_t length)
+{
+    std::string xml = "<TM>\n";
+    xml += "\t<Msg>0</Msg>\n";
+    xml += "\t<Inst>LPC</Inst>\n";
+    xml += "\t<StateFlag1>FINE</StateFlag1>\n";
+    xml += "\t<StateMess1>" + mess1 + "</StateMess1>\n";
+    xml += "\t<StateFlag2>FINE</StateFlag2>\n";
+    xml += "\t<StateMess2>" + mess2 + "</StateMess2>\n";
+    xml += "\t<Length>" + std::to_string(length) + "</Length>";
+    xml += "</TM>\n";
+    xml += "<CRC>00000</CRC>\n";
+    return xml;
+}
+
+static void appendMessage(std::vector<uint8_t>& out, const std::string& header, const Payload& p)
+{
+    out.insert(out.end(), header.begin(), header.end());
+    out.insert(out.end(), {'S', 'T', 'A', 'R', 'T'});
+    out.insert(out.end(), p.b.begin(), p.b.end());
+    out.insert(out.end(), {0, 0, 'E', 'N', 'D'});
+}
+
+static bool writeFile(const fs::path& path, const void* data, size_t len)
+{
+    FILE* f = fopen(path.string().c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(data, 1, len, f) == len;
+    return (fclose(f) == 0) && ok;
+}
+
+int main(int argc, char** argv)
+{
+    int days = 3;
+    int cycle_minutes = 15;
+    int n_samples = 60;
+    int chunk_records = 0;
+    int agg_secs = 0;
+    bool packed = false;
+    std::string out_dir = "synth_flight";
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-d" && i + 1 < argc) {
+            days = atoi(argv[++i]);
+        } else if (a == "-c" && i + 1 < argc) {
+            cycle_minutes = atoi(argv[++i]);
+        } else if (a == "-n" && i + 1 < argc) {
+            n_samples = atoi(argv[++i]);
+        } else if (a == "-k" && i + 1 < argc) {
+            chunk_records = atoi(argv[++i]);
+        } else if (a == "-a" && i + 1 < argc) {
+            agg_secs = atoi(argv[++i]);
+        } else if (a == "-p") {
+            packed = true;
+        } else if (a == "-o" && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: lpc_synth [-d days] [-c cycle_minutes] [-n samples] [-k chunk] [-a window_secs] [-p] [-o outdir]\n");
+            return 1;
+        }
+    }
+    if (days < 1 || cycle_minutes < 1 || n_samples < 1 || n_samples > 300 || chunk_records < 0 || agg_secs < 0 || (agg_secs && RS41_N_SAMPLES % agg_secs)) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    std::error_code ec;
+    fs::create_directories(out_dir, ec);
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> counts(0, 400);
+    std::normal_distribution<float> noise(0.0f, 0.2f);
+
+    size_t total_bytes = 0;
+    size_t total_files = 0;
+
+    for (int day = 0; day < days; day++) {
+        time_t day_start = FLIGHT_START + (time_t)day * 86400;
+        std::vector<uint8_t> capture;
+
+        // LPC measurement cycles
+        for (time_t t = day_start; t < day_start + 86400; t += cycle_minutes * 60) {
+            uint32_t start = (uint32_t)(t + 20);
+            Payload p;
+            p.add(start);
+            if (chunk_records) {
+                // chunk 0 header; the records follow as for a whole cycle
+                p.add((uint16_t)0);
+                p.add((uint16_t)0);
+                p.add((uint8_t)0);
+            }
+            std::vector<uint16_t> hk(16);
+            for (int r = 0; r < n_samples; r++) {
+                hk[0] = (uint16_t)(2 * r);
+                hk[1] = 800 + r % 7;
+                hk[2] = 810 + r % 5;
+                hk[3] = 120;
+                hk[4] = 12000;
+                hk[5] = 3300;
+                hk[6] = 3300;
+                hk[7] = 16000;
+                hk[8] = 666;
+                hk[9] = 64;
+                hk[10] = 64;
+                for (int i = 11; i < 16; i++) {
+                    hk[i] = (uint16_t)((273.15f + 20.0f + noise(rng)) * 100.0f);
+                }
+                if (r == 0 && !chunk_records) {
+                    for (uint16_t v : hk) {
+                        p.add(v);
+                    }
+                }
+                for (int bin = 0; bin < 32; bin++) {
+                    p.add((uint16_t)(counts(rng) >> (bin % 16 / 2)));
+                }
+                for (uint16_t v : hk) {
+                    p.add(v);
+                }
+            }
+            std::vector<uint8_t> msg;
+            if (!chunk_records) {
+                std::string header = tmHeader("20.00,21.00,-5.00,100.00,0,23668", "45.10,5.20,19500.00", p.b.size());
+                appendMessage(msg, header, p);
+            } else {
+                // Split the records into chunks as StratoLPC::QueueRecords()
+                // does, ending with an empty final chunk when they divide evenly
+                const size_t record_bytes = 48 * 2;
+                const uint8_t* records = p.b.data() + 9;
+                for (int first = 0, chunk = 0; ; first += chunk_records, chunk++) {
+                    int n = std::min(chunk_records, n_samples - first);
+                    bool final = (n < chunk_records);
+                    Payload c;
+                    c.add(start);
+                    c.add((uint16_t)chunk);
+                    c.add((uint16_t)first);
+                    c.add((uint8_t)final);
+                    c.b.insert(c.b.end(), records + first * record_bytes, records + (first + n) * record_bytes);
+                    appendMessage(msg, tmHeader("20.00,21.00,-5.00,100.00,0,23668", "LPCC,45.10,5.20,19500.00", c.b.size()), c);
+                    if (final) {
+                        break;
+                    }
+                }
+            }
+            writeFile(fs::path(out_dir) / ("LPC_" + timeString(t + 20 + 2 * n_samples) + ".ready_tm"), msg.data(),
+                      msg.size());
+            capture.insert(capture.end(), msg.begin(), msg.end());
+            total_bytes += msg.size();
+            total_files++;
+        }
+
+        // RS41 local storage and TM, one file/message per RS41_N_SAMPLES seconds
+        for (time_t t = day_start; t < day_start + 86400; t += RS41_N_SAMPLES) {
+            std::string csv =
+                "Time,valid,frame_count,air_temp_degC,humdity_percent,hsensor_temp_degC,pres_mb,internal_temp_degC,"
+                "module_status,module_error,pcb_supply_V,lsm303_temp_degC,pcb_heater_on,mag_hdgXY_deg,mag_hdgXZ_deg,"
+                "mag_hdgYZ_deg,accelX_mG,accelY_mG,accelZ_mG\n";
+            Payload p;
+            p.add((uint32_t)(t + RS41_N_SAMPLES));
+            p.add((uint16_t)RS41_N_SAMPLES);
+            Payload agg;
+            agg.add((uint32_t)t);
+            agg.add((uint16_t)agg_secs);
+            agg.add((uint16_t)(agg_secs ? RS41_N_SAMPLES / agg_secs : 0));
+            std::vector<rs41TmSample_t> samples;
+            uint32_t sum[4] = {};
+            uint16_t lo[4];
+            uint16_t hi[4];
+            char row[512];
+            for (int s = 0; s < RS41_N_SAMPLES; s++) {
+                time_t ts = t + s;
+                float tdry = -55.0f + 10.0f * std::sin(ts / 3600.0f) + noise(rng);
+                float rh = 5.0f + noise(rng);
+                float tsens = tdry + 1.0f;
+                float pres = 70.0f + noise(rng);
+                snprintf(row, sizeof(row), "%s,1,%ld,%.2f,%.2f,%.2f,%.2f,%.2f,0,0,3.30,-20,0,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                         timeString(ts).c_str(), (long)(ts - FLIGHT_START), tdry, rh, tsens, pres, 10.0f + noise(rng),
+                         180.0f + noise(rng), 90.0f, 45.0f, noise(rng), noise(rng), 1000.0f + noise(rng));
+                csv += row;
+                p.add((uint8_t)1);
+                p.add((uint32_t)(s + 1));
+                p.add((uint16_t)((tdry + 100) * 100));
+                p.add((uint16_t)(rh * 100));
+                p.add((uint16_t)((tsens + 100) * 100));
+                p.add((uint16_t)(pres * 50));
+                p.add((uint16_t)0);
+                samples.push_back({1, (uint32_t)(s + 1), (uint16_t)((tdry + 100) * 100), (uint16_t)(rh * 100),
+                                   (uint16_t)((tsens + 100) * 100), (uint16_t)(pres * 50), 0});
+
+                if (agg_secs) {
+                    // LPCRS41Window over the scaled TM fields
+                    const uint16_t fields[4] = {(uint16_t)((tdry + 100) * 100), (uint16_t)(rh * 100),
+                                                (uint16_t)((tsens + 100) * 100), (uint16_t)(pres * 50)};
+                    if (s % agg_secs == 0) {
+                        for (int f = 0; f < 4; f++) {
+                            sum[f] = 0;
+                            lo[f] = UINT16_MAX;
+                            hi[f] = 0;
+                        }
+                    }
+                    for (int f = 0; f < 4; f++) {
+                        sum[f] += fields[f];
+                        lo[f] = std::min(lo[f], fields[f]);
+                        hi[f] = std::max(hi[f], fields[f]);
+                    }
+                    if (s % agg_secs == agg_secs - 1) {
+                        agg.add((uint16_t)(s + 1 - agg_secs));
+                        agg.add((uint8_t)agg_secs);
+                        agg.add((uint8_t)agg_secs);
+                        agg.add((uint16_t)0);
+                        for (int f = 0; f < 4; f++) {
+                            agg.add((uint16_t)((sum[f] + agg_secs / 2) / agg_secs));
+                            agg.add(lo[f]);
+                            agg.add(hi[f]);
+                        }
+                    }
+                }
+            }
+            writeFile(fs::path(out_dir) / ("RS41_" + timeString(t) + ".csv"), csv.data(), csv.size());
+            if (packed && !agg_secs) {
+                Payload d;
+                d.b.resize(p.b.size());
+                d.b.resize(LPCRS41Pack(samples.data(), RS41_N_SAMPLES, (uint32_t)t, d.b.data(), d.b.size()));
+                appendMessage(capture, tmHeader("", d.b.empty() ? "RS41" : "RS41D", d.b.empty() ? p.b.size() : d.b.size()),
+                              d.b.empty() ? p : d);
+            } else if (agg_secs) {
+                appendMessage(capture, tmHeader("", "RS41A", agg.b.size()), agg);
+            } else {
+                appendMessage(capture, tmHeader("", "RS41", p.b.size()), p);
+            }
+            total_bytes += csv.size();
+            total_files++;
+        }
+
+        // Memory housekeeping TM (SendMemoryTelemetry), hourly
+        for (time_t t = day_start + 3600; t <= day_start + 86400; t += 3600) {
+            Payload p;
+            uint32_t uptime = (uint32_t)(t - FLIGHT_START);
+            uint32_t in_use = 3000 + (uint32_t)(counts(rng) % 500);
+            for (uint32_t v : {(uint32_t)t, uptime, 6200u, 409600u, in_use, 3600u, 520000u - in_use, 500000u,
+                               uptime / 2, uptime / 2 - 12, 0u, 29130u, 75276u, 0x1u, 640u}) {
+                p.add(v);
+            }
+            appendMessage(capture, tmHeader("6200,409600", "MEM", p.b.size()), p);
+        }
+
+        writeFile(fs::path(out_dir) / ("TM_" + timeString(day_start) + ".tm"), capture.data(), capture.size());
+        total_bytes += capture.size();
+        total_files++;
+    }
+
+    printf("Wrote %zu files, %.1f MB to %s\n", total_files, total_bytes / 1e6, out_dir.c_str());
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ *  lpc_unlzb.cpp
+ *  Created: October 2026
+ *
+ *  Expands local storage files written with SD_COMPRESS (LPCCompress,
+ *  LZB1 format). Each input name.lzb is written to name, or to stdout
+ *  with -c. With -z, compresses instead, as the instrument would.
+ *
+ *  Usage: lpc_unlzb [-c] [-z] file...
+ */
+
+#include "lpc_formats.h"
+#include "LPCCompress.h"
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    bool to_stdout = false;
+    bool compress = false;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-c") {
+            to_stdout = true;
+        } else if (a == "-z") {
+            compress = true;
+        } else if (a[0] == '-') {
+            inputs.clear();
+            break;
+        } else {
+            inputs.push_back(a);
+        }
+    }
+    if (inputs.empty()) {
+        fprintf(stderr, "usage: lpc_unlzb [-c] [-z] file...\n");
+        return 1;
+    }
+
+    const std::string suffix = LPC_COMPRESS_SUFFIX;
+    int rc = 0;
+    for (const std::string& in : inputs) {
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> out;
+        if (!readFile(in, data)) {
+            fprintf(stderr, "%s: unable to read\n", in.c_str());
+            rc = 1;
+            continue;
+        }
+
+        std::string out_path;
+        if (compress) {
+            lpc::compressLzb(data.data(), data.size(), out);
+            out_path = in + suffix;
+        } else {
+            std::string err;
+            if (!lpc::decompressLzb(data.data(), data.size(), out, err)) {
+                fprintf(stderr, "%s: %s after %zu bytes\n", in.c_str(), err.c_str(), out.size());
+                rc = 1;
+            }
+            bool has_suffix = in.size() > suffix.size() && in.compare(in.size() - suffix.size(), suffix.size(), suffix) == 0;
+            out_path = has_suffix ? in.substr(0, in.size() - suffix.size()) : in + ".out";
+        }
+
+        FILE* f = to_stdout ? stdout : fopen(out_path.c_str(), "wb");
+        if (!f || fwrite(out.data(), 1, out.size(), f) != out.size()) {
+            fprintf(stderr, "%s: unable to write\n", out_path.c_str());
+            rc = 1;
+        }
+        if (f && !to_stdout) {
+            fclose(f);
+        }
+        if (!to_stdout) {
+            fprintf(stderr, "%s: %zu -> %zu bytes\n", in.c_str(), data.size(), out.size());
+        }
+    }
+    return rc;
+}